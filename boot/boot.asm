@@ -1,6 +1,12 @@
 [BITS 16]
 [ORG 0x7C00]
 
+; Stage 1: грузит stage2 и заголовок образа одним расширенным чтением
+; (INT 13h AH=42h), дальше вся работа в stage2.asm
+%define STAGE2_ADDR     0x0600
+%define STAGE2_LBA      1
+%define STAGE2_SECTORS  5       ; 4 сектора stage2 + 1 сектор заголовка
+
 start:
     cli
     xor ax, ax
@@ -10,6 +16,8 @@ start:
     mov sp, 0x7C00
     sti
 
+    mov [boot_drive], dl
+
     ; Очистка экрана
     mov ax, 0x0003
     int 0x10
@@ -17,85 +25,27 @@ start:
     mov si, msg_loading
     call print_string
 
-    ; Загружаем BIOS код (64 сектора = 32KB)
-    mov ax, 0x0240      ; 64 сектора
-    mov cx, 0x0002      ; цилиндр 0, сектор 2
-    mov dh, 0x00        ; головка 0
-    mov dl, 0x80        ; диск
-    mov bx, 0x7E00      ; загружаем по адресу 0x7E00
+    ; Проверяем поддержку расширений INT 13h (LBA)
+    mov ah, 0x41
+    mov bx, 0x55AA
+    mov dl, [boot_drive]
+    int 0x13
+    jc disk_error
+    cmp bx, 0xAA55
+    jne disk_error
+    test cl, 1          ; поддержка AH=42h
+    jz disk_error
+
+    ; Загружаем stage2 + заголовок
+    mov si, dap
+    mov ah, 0x42
+    mov dl, [boot_drive]
     int 0x13
     jc disk_error
 
-    ; Переходим в защищенный режим
-    call switch_to_protected_mode
-
-; Включаем A20 линию
-enable_a20:
-    in al, 0x92
-    or al, 2
-    out 0x92, al
-    ret
-
-; Загружаем GDT
-load_gdt:
-    lgdt [gdt_descriptor]
-    ret
-
-; Переключаемся в защищенный режим
-switch_to_protected_mode:
-    cli
-    call enable_a20
-    call load_gdt
-    
-    mov eax, cr0
-    or eax, 1
-    mov cr0, eax
-    
-    jmp CODE_SEG:init_pm
-
-[BITS 32]
-init_pm:
-    ; Настраиваем сегменты
-    mov ax, DATA_SEG
-    mov ds, ax
-    mov es, ax
-    mov fs, ax
-    mov gs, ax
-    mov ss, ax
-    mov esp, 0x90000
-    
-    ; Вызываем главную C функцию BIOS
-    call 0x7E00
-    
-    jmp $
-
-; GDT
-gdt_start:
-    gdt_null:
-        dd 0x0
-        dd 0x0
-    gdt_code:
-        dw 0xFFFF
-        dw 0x0
-        db 0x0
-        db 10011010b
-        db 11001111b
-        db 0x0
-    gdt_data:
-        dw 0xFFFF
-        dw 0x0
-        db 0x0
-        db 10010010b
-        db 11001111b
-        db 0x0
-gdt_end:
-
-gdt_descriptor:
-    dw gdt_end - gdt_start - 1
-    dd gdt_start
-
-CODE_SEG equ gdt_code - gdt_start
-DATA_SEG equ gdt_data - gdt_start
+    ; Передаем управление stage2 (DL = загрузочный диск)
+    mov dl, [boot_drive]
+    jmp 0x0000:STAGE2_ADDR
 
 ; Функции реального режима
 print_string:
@@ -114,10 +64,20 @@ disk_error:
     call print_string
     jmp $
 
+; Disk Address Packet для AH=42h
+dap:
+    db 0x10             ; размер пакета
+    db 0
+    dw STAGE2_SECTORS   ; количество секторов
+    dw STAGE2_ADDR      ; смещение
+    dw 0x0000           ; сегмент
+    dq STAGE2_LBA       ; начальный LBA
+
+boot_drive db 0
+
 ; Сообщения
 msg_loading db "Loading BIOS...", 0x0D, 0x0A, 0
 msg_error db "Disk Error! The main BIOS firmware is damaged or not found! Try to reboot if it doesn't work then reflash to an older BIOS firmware current version 4.51 Firmware can be downloaded here https://github.com/mydak538/WexIB Instructions for flashing this device are available here: https://github.com/mydak538/WexIB/blob/main/flashing.md", 0
 
 times 510-($-$$) db 0
 dw 0xAA55
-
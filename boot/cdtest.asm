@@ -0,0 +1,75 @@
+[BITS 16]
+[ORG 0]
+
+; Проверочный образ El Torito без эмуляции (make iso, make run-cdrom).
+; Грузится по 07C0:0000 целиком (4 виртуальных сектора = 1 сектор CD);
+; сообщение лежит в последнем секторе образа - если прошивка прочитала
+; не весь образ, вместо него будет ошибка. Вывод - на экран и в порт 0xE9
+%define IMAGE_SIZE      2048
+%define DEBUGCON_PORT   0xE9
+
+start:
+    cli
+    mov ax, cs
+    mov ds, ax
+    xor ax, ax
+    mov ss, ax
+    mov sp, 0x7C00
+    sti
+
+    mov [boot_drive], dl
+
+    mov si, msg_error
+    cmp word [image_tail], 0xC0DE
+    jne .print
+    mov si, msg_ok
+.print:
+    call print_string
+
+    ; Номер привода в DL
+    mov al, [boot_drive]
+    shr al, 4
+    call print_hex_digit
+    mov al, [boot_drive]
+    call print_hex_digit
+    mov si, msg_newline
+    call print_string
+
+.halt:
+    hlt
+    jmp .halt
+
+; Строка DS:SI до нуля
+print_string:
+    lodsb
+    test al, al
+    jz .done
+    call print_char
+    jmp print_string
+.done:
+    ret
+
+print_hex_digit:
+    and al, 0x0F
+    add al, '0'
+    cmp al, '9'
+    jbe print_char
+    add al, 'A' - '9' - 1
+print_char:
+    out DEBUGCON_PORT, al
+    mov ah, 0x0E
+    mov bx, 0x0007
+    int 0x10
+    ret
+
+msg_error   db "El Torito: boot image truncated", 13, 10, 0
+boot_drive  db 0
+
+    times IMAGE_SIZE - 512 - ($ - $$) db 0
+
+; Последний сектор образа
+msg_ok      db "El Torito: no-emulation image loaded, DL=", 0
+msg_newline db 13, 10, 0
+
+    times IMAGE_SIZE - 2 - ($ - $$) db 0
+image_tail  dw 0xC0DE
@@ -0,0 +1,487 @@
+[BITS 16]
+[ORG 0x0600]
+
+; Stage 2: читает заголовок образа, загружает payload расширенными
+; чтениями INT 13h AH=42h крупными блоками, проверяет контрольную сумму
+; и передает управление в защищенном режиме.
+;
+; Payload ниже 1 МБ читается сразу по месту, выше 1 МБ - через
+; буфер BOUNCE_SEG и копирование INT 15h AH=87h.
+;
+; Сжатый (LZ4) payload читается в конец своего буфера и распаковывается
+; на место уже в защищенном режиме. Время загрузки в тактах TSC выводится
+; в отладочный порт 0xE9 (QEMU -debugcon) для tools/bench_boot.sh.
+;
+; Перед загрузкой собирается карта памяти INT 15h E820: в защищенном
+; режиме ее уже не получить, а она нужна загрузчику Linux (boot_params).
+
+%define STAGE2_SECTORS  4
+%define HEADER          0x0E00  ; сектор заголовка сразу за stage2
+%define PAYLOAD_LBA     6
+
+; Смещения полей image_header_t (include/image.h)
+%define HDR_MAGIC       HEADER + 0x00
+%define HDR_FLAGS       HEADER + 0x06
+%define HDR_LOAD        HEADER + 0x08
+%define HDR_ENTRY       HEADER + 0x0C
+%define HDR_FILE_SIZE   HEADER + 0x10
+%define HDR_MEM_SIZE    HEADER + 0x14
+%define HDR_SECTORS     HEADER + 0x18
+%define HDR_CHECKSUM    HEADER + 0x1C
+%define HDR_PACKED_SIZE HEADER + 0x20
+%define HDR_PACKED_OFF  HEADER + 0x24
+
+%define FLAG_LZ4        0x0001
+
+; boot_handoff_t (include/image.h)
+%define HANDOFF             0x0500
+%define HANDOFF_MAGIC       0x4F485857
+%define HO_MAGIC            HANDOFF + 0x00
+%define HO_CHECKSUM         HANDOFF + 0x04
+%define HO_TSC_STAGE2       HANDOFF + 0x08
+%define HO_TSC_PM           HANDOFF + 0x10
+%define HO_TSC_PAYLOAD      HANDOFF + 0x18
+%define HO_BOOT_DRIVE       HANDOFF + 0x20
+%define HO_E820_COUNT       HANDOFF + 0x21
+
+; Карта памяти E820 (BOOT_E820_ADDR в include/image.h)
+%define E820_MAP        0x1000
+%define E820_MAX        128
+%define E820_ENTRY_SIZE 20
+%define E820_SMAP       0x534D4150  ; "SMAP"
+
+%define DEBUG_PORT      0xE9
+
+%define IMAGE_MAGIC     0x42495857
+%define MAX_CHUNK       127     ; максимум секторов за один вызов AH=42h
+%define BOUNCE_SEG      0x1000  ; 0x10000 - буфер для загрузки выше 1 МБ
+%define HIGH_MEM        0x100000
+%define LOW_LIMIT       0x90000 ; стек защищенного режима
+
+stage2:
+    mov [boot_drive], dl
+
+    rdtsc
+    mov [tsc_start], eax
+    mov [tsc_start + 4], edx
+
+    ; Проверяем заголовок
+    cmp dword [HDR_MAGIC], IMAGE_MAGIC
+    jne bad_header
+
+    call detect_e820
+
+    mov eax, [HDR_LOAD]
+    cmp eax, HIGH_MEM
+    jae .high
+
+    ; Ниже 1 МБ образ должен целиком поместиться до стека
+    mov byte [high_load], 0
+    mov ebx, [HDR_MEM_SIZE]
+    mov ecx, [HDR_SECTORS]
+    shl ecx, 9
+    add ecx, [HDR_PACKED_OFF]
+    cmp ebx, ecx
+    jae .span_ok
+    mov ebx, ecx
+.span_ok:
+    add ebx, eax
+    jc too_large
+    cmp ebx, LOW_LIMIT
+    ja too_large
+    jmp .setup
+
+.high:
+    mov byte [high_load], 1
+
+.setup:
+    add eax, [HDR_PACKED_OFF]   ; 0 для несжатого образа
+    mov [dest_addr], eax
+    mov eax, [HDR_SECTORS]
+    mov [remaining], eax
+    mov dword [cur_lba], PAYLOAD_LBA
+    mov dword [sum], 0
+
+.read_loop:
+    mov eax, [remaining]
+    test eax, eax
+    jz .read_done
+    cmp eax, MAX_CHUNK
+    jbe .count_ok
+    mov eax, MAX_CHUNK
+.count_ok:
+    mov [dap_count], ax
+
+    cmp byte [high_load], 0
+    jne .to_bounce
+
+    ; Нормализуем линейный адрес в сегмент:смещение (смещение < 16)
+    mov eax, [dest_addr]
+    mov bx, ax
+    and bx, 0x000F
+    mov [dap_off], bx
+    shr eax, 4
+    mov [dap_seg], ax
+    jmp .do_read
+
+.to_bounce:
+    mov word [dap_off], 0
+    mov word [dap_seg], BOUNCE_SEG
+
+.do_read:
+    mov eax, [cur_lba]
+    mov [dap_lba], eax
+    mov si, dap
+    mov ah, 0x42
+    mov dl, [boot_drive]
+    int 0x13
+    jc disk_error
+
+    ; Контрольная сумма прочитанного блока
+    push es
+    mov es, [dap_seg]
+    mov di, [dap_off]
+    mov cx, [dap_count]
+    shl cx, 7               ; 128 двойных слов на сектор
+    mov eax, [sum]
+.sum_loop:
+    add eax, [es:di]
+    add di, 4
+    loop .sum_loop
+    mov [sum], eax
+    pop es
+
+    cmp byte [high_load], 0
+    je .advance
+    call copy_high
+
+.advance:
+    movzx eax, word [dap_count]
+    add [cur_lba], eax
+    sub [remaining], eax
+    shl eax, 9
+    add [dest_addr], eax
+    jmp .read_loop
+
+.read_done:
+    mov eax, [sum]
+    cmp eax, [HDR_CHECKSUM]
+    jne checksum_error
+
+    ; Переходим в защищенный режим
+    cli
+    call enable_a20
+    lgdt [gdt_descriptor]
+
+    mov eax, cr0
+    or eax, 1
+    mov cr0, eax
+
+    jmp CODE_SEG:init_pm
+
+; Копирование блока из BOUNCE_SEG по адресу dest_addr (INT 15h AH=87h)
+copy_high:
+    mov eax, [dest_addr]
+    mov [move_dst + 2], ax      ; база 0..15
+    shr eax, 16
+    mov [move_dst + 4], al      ; база 16..23
+    mov [move_dst + 7], ah      ; база 24..31
+
+    mov cx, [dap_count]
+    shl cx, 8                   ; количество слов
+    mov si, move_gdt
+    mov ah, 0x87
+    int 0x15
+    jc disk_error
+    ret
+
+; Карта памяти: записи по 20 байт в E820_MAP, число - в e820_count.
+; Пустые записи пропускаются; без поддержки E820 карта остается пустой
+detect_e820:
+    xor ebx, ebx
+    mov di, E820_MAP
+.next:
+    mov eax, 0xE820
+    mov edx, E820_SMAP
+    mov ecx, E820_ENTRY_SIZE
+    int 0x15
+    jc .done
+    cmp eax, E820_SMAP
+    jne .done
+    mov eax, [di + 8]
+    or eax, [di + 12]
+    jz .skip
+    add di, E820_ENTRY_SIZE
+    inc byte [e820_count]
+    cmp byte [e820_count], E820_MAX
+    jae .done
+.skip:
+    test ebx, ebx
+    jnz .next
+.done:
+    ret
+
+; Включаем A20 линию
+enable_a20:
+    in al, 0x92
+    or al, 2
+    out 0x92, al
+    ret
+
+; Функции реального режима
+print_string:
+    mov ah, 0x0E
+.loop:
+    lodsb
+    test al, al
+    jz .done
+    int 0x10
+    jmp .loop
+.done:
+    ret
+
+bad_header:
+    mov si, msg_bad_header
+    jmp fatal
+
+too_large:
+    mov si, msg_too_large
+    jmp fatal
+
+checksum_error:
+    mov si, msg_checksum
+    jmp fatal
+
+disk_error:
+    mov si, msg_disk
+
+fatal:
+    call print_string
+    mov si, msg_reflash
+    call print_string
+    jmp $
+
+[BITS 32]
+init_pm:
+    ; Настраиваем сегменты
+    mov ax, DATA_SEG
+    mov ds, ax
+    mov es, ax
+    mov fs, ax
+    mov gs, ax
+    mov ss, ax
+    mov esp, 0x90000
+
+    ; Отметки времени для timeline.c
+    rdtsc
+    mov [HO_TSC_PM], eax
+    mov [HO_TSC_PM + 4], edx
+    mov eax, [tsc_start]
+    mov [HO_TSC_STAGE2], eax
+    mov eax, [tsc_start + 4]
+    mov [HO_TSC_STAGE2 + 4], eax
+    mov eax, [HDR_CHECKSUM]
+    mov [HO_CHECKSUM], eax
+    mov al, [boot_drive]
+    mov [HO_BOOT_DRIVE], al
+    mov al, [e820_count]
+    mov [HO_E820_COUNT], al
+    mov dword [HO_MAGIC], HANDOFF_MAGIC
+
+    ; Распаковка LZ4 на место
+    test word [HDR_FLAGS], FLAG_LZ4
+    jz .unpacked
+    mov edi, [HDR_LOAD]
+    mov esi, edi
+    add esi, [HDR_PACKED_OFF]
+    mov ebx, esi
+    add ebx, [HDR_PACKED_SIZE]
+    call lz4_decompress
+.unpacked:
+
+    ; Время загрузки payload - в отладочный порт
+    rdtsc
+    mov [HO_TSC_PAYLOAD], eax
+    mov [HO_TSC_PAYLOAD + 4], edx
+    sub eax, [tsc_start]
+    sbb edx, [tsc_start + 4]
+    push eax
+    mov esi, msg_load_tsc
+    call debug_string
+    pop eax
+    call debug_hex
+    mov esi, msg_crlf
+    call debug_string
+
+    ; Обнуляем .bss - objcopy не включает его в payload
+    mov edi, [HDR_LOAD]
+    add edi, [HDR_FILE_SIZE]
+    mov ecx, [HDR_MEM_SIZE]
+    sub ecx, [HDR_FILE_SIZE]
+    jbe .no_bss
+    xor eax, eax
+    cld
+    rep stosb
+.no_bss:
+
+    ; Вызываем главную C функцию BIOS
+    mov eax, [HDR_ENTRY]
+    call eax
+
+    jmp $
+
+; Распаковка LZ4 block format
+; esi = вход, ebx = конец входа, edi = выход
+lz4_decompress:
+    cld
+.sequence:
+    cmp esi, ebx
+    jae .done
+    movzx edx, byte [esi]       ; токен
+    inc esi
+
+    ; Длина литералов
+    mov ecx, edx
+    shr ecx, 4
+    cmp ecx, 15
+    jne .copy_literals
+.literal_length:
+    movzx eax, byte [esi]
+    inc esi
+    add ecx, eax
+    cmp eax, 255
+    je .literal_length
+.copy_literals:
+    rep movsb
+    cmp esi, ebx                ; последняя последовательность без матча
+    jae .done
+
+    ; Смещение и длина матча
+    movzx eax, word [esi]
+    add esi, 2
+    mov ecx, edx
+    and ecx, 0x0F
+    cmp ecx, 15
+    jne .copy_match
+.match_length:
+    movzx edx, byte [esi]
+    inc esi
+    add ecx, edx
+    cmp edx, 255
+    je .match_length
+.copy_match:
+    add ecx, 4
+    push esi
+    mov esi, edi
+    sub esi, eax
+    rep movsb                   ; побайтно - перекрытие допустимо
+    pop esi
+    jmp .sequence
+.done:
+    ret
+
+; Вывод строки esi в отладочный порт
+debug_string:
+    lodsb
+    test al, al
+    jz .done
+    out DEBUG_PORT, al
+    jmp debug_string
+.done:
+    ret
+
+; Вывод eax в hex в отладочный порт
+debug_hex:
+    mov edx, eax
+    mov ecx, 8
+.digit:
+    rol edx, 4
+    mov al, dl
+    and al, 0x0F
+    add al, '0'
+    cmp al, '9'
+    jbe .out
+    add al, 'A' - '9' - 1
+.out:
+    out DEBUG_PORT, al
+    loop .digit
+    ret
+
+; GDT
+gdt_start:
+    gdt_null:
+        dd 0x0
+        dd 0x0
+    gdt_code:
+        dw 0xFFFF
+        dw 0x0
+        db 0x0
+        db 10011010b
+        db 11001111b
+        db 0x0
+    gdt_data:
+        dw 0xFFFF
+        dw 0x0
+        db 0x0
+        db 10010010b
+        db 11001111b
+        db 0x0
+gdt_end:
+
+gdt_descriptor:
+    dw gdt_end - gdt_start - 1
+    dd gdt_start
+
+CODE_SEG equ gdt_code - gdt_start
+DATA_SEG equ gdt_data - gdt_start
+
+; Таблица дескрипторов для INT 15h AH=87h
+move_gdt:
+    dq 0                        ; пустой
+    dq 0                        ; заполняет BIOS
+move_src:
+    dw 0xFFFF                   ; лимит
+    db 0x00, 0x00, 0x01         ; база = BOUNCE_SEG * 16
+    db 0x93                     ; данные, чтение/запись
+    db 0x00, 0x00               ; база 24..31
+move_dst:
+    dw 0xFFFF
+    db 0x00, 0x00, 0x00
+    db 0x93
+    db 0x00, 0x00
+    dq 0                        ; CS BIOS
+    dq 0                        ; SS BIOS
+
+; Disk Address Packet для AH=42h
+dap:
+    db 0x10
+    db 0
+dap_count:
+    dw 0
+dap_off:
+    dw 0
+dap_seg:
+    dw 0
+dap_lba:
+    dd 0
+    dd 0
+
+boot_drive  db 0
+e820_count  db 0
+high_load   db 0
+dest_addr   dd 0
+remaining   dd 0
+cur_lba     dd 0
+sum         dd 0
+tsc_start   dq 0
+
+; Сообщения
+msg_bad_header db "Bad firmware image header! ", 0
+msg_too_large  db "Firmware image too large! ", 0
+msg_checksum   db "Firmware checksum error! ", 0
+msg_disk       db "Disk Error! ", 0
+msg_load_tsc   db "WexIB stage2: payload loaded in 0x", 0
+msg_crlf       db " TSC ticks", 0x0D, 0x0A, 0
+msg_reflash    db "Reflash the BIOS firmware: https://github.com/mydak538/WexIB/blob/main/flashing.md", 0
+
+times STAGE2_SECTORS*512-($-$$) db 0
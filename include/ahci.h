@@ -0,0 +1,106 @@
+#ifndef AHCI_H
+#define AHCI_H
+
+#include <stdint.h>
+
+// HBA: класс 01h (накопители), подкласс 06h (SATA), интерфейс 01h (AHCI)
+#define AHCI_PCI_CLASS      0x01
+#define AHCI_PCI_SUBCLASS   0x06
+#define AHCI_PCI_PROG_IF    0x01
+#define AHCI_ABAR           5       // BAR5 - регистры HBA в памяти
+
+// Общие регистры HBA
+#define AHCI_CAP            0x00
+#define AHCI_GHC            0x04
+#define AHCI_IS             0x08
+#define AHCI_PI             0x0C
+
+#define AHCI_CAP_SNCQ       0x40000000
+#define AHCI_GHC_AE         0x80000000
+#define AHCI_GHC_IE         0x00000002
+
+// Регистры порта: ABAR + 0x100 + порт * 0x80
+#define AHCI_PORT_BASE      0x100
+#define AHCI_PORT_SIZE      0x80
+#define PX_CLB              0x00
+#define PX_CLBU             0x04
+#define PX_FB               0x08
+#define PX_FBU              0x0C
+#define PX_IS               0x10
+#define PX_IE               0x14
+#define PX_CMD              0x18
+#define PX_TFD              0x20
+#define PX_SIG              0x24
+#define PX_SSTS             0x28
+#define PX_SERR             0x30
+#define PX_SACT             0x34
+#define PX_CI               0x38
+
+#define PX_CMD_ST           0x0001
+#define PX_CMD_FRE          0x0010
+#define PX_CMD_FR           0x4000
+#define PX_CMD_CR           0x8000
+#define PX_IS_TFES          0x40000000
+#define PX_TFD_ERR          0x01
+#define PX_TFD_DRQ          0x08
+#define PX_TFD_BSY          0x80
+
+// SStatus: DET = 3 (устройство и связь), IPM = 1 (активно)
+#define PX_SSTS_DET_PRESENT 0x3
+#define PX_SSTS_IPM_ACTIVE  0x1
+#define AHCI_SIG_ATA        0x00000101
+
+// FIS и команды
+#define FIS_TYPE_REG_H2D    0x27
+#define FIS_H2D_COMMAND     0x80
+#define AHCI_CMD_READ_FPDMA_QUEUED 0x60
+#define AHCI_CMD_READ_DMA       0xC8
+#define AHCI_CMD_READ_DMA_EXT   0x25
+#define AHCI_CMD_IDENTIFY       0xEC
+
+#define AHCI_MAX_SLOTS      32
+#define AHCI_MAX_DISKS      4
+// Секторов на одну команду очереди (одна запись PRDT)
+#define AHCI_CMD_SECTORS    64
+
+#define AHCI_TIMEOUT_MS     1000
+
+// Заголовок команды (список команд порта - 32 заголовка, выравнивание 1 КБ)
+typedef struct {
+    uint32_t flags;         // биты 0-4 - длина CFIS в dword, 16-31 - записей PRDT
+    uint32_t prdbc;         // передано байт
+    uint32_t ctba;          // таблица команды, выравнивание 128
+    uint32_t ctbau;
+    uint32_t reserved[4];
+} __attribute__((packed)) ahci_cmd_header_t;
+
+typedef struct {
+    uint32_t dba;
+    uint32_t dbau;
+    uint32_t reserved;
+    uint32_t dbc;           // байт - 1, бит 0 всегда 1
+} __attribute__((packed)) ahci_prd_t;
+
+typedef struct {
+    uint8_t cfis[64];
+    uint8_t acmd[16];
+    uint8_t reserved[48];
+    ahci_prd_t prdt[1];
+} __attribute__((aligned(128))) ahci_cmd_table_t;
+
+// Области одного порта
+typedef struct {
+    ahci_cmd_header_t headers[AHCI_MAX_SLOTS];
+    uint8_t fis[256];                       // принятые FIS, выравнивание 256
+    ahci_cmd_table_t tables[AHCI_MAX_SLOTS];
+} __attribute__((aligned(1024))) ahci_port_mem_t;
+
+// Поиск HBA, запуск портов с дисками SATA; диски регистрируются в
+// blockdev как "AHCI<порт>". Чтения с NCQ держат до 32 команд в очереди.
+uint8_t ahci_init(void);
+uint8_t ahci_disk_count(void);
+// Порты обратно к настройке BIOS (списки команд, FIS, PxCMD) перед
+// передачей управления в реальный режим
+void ahci_shutdown(void);
+
+#endif // AHCI_H
@@ -0,0 +1,183 @@
+#ifndef ATA_H
+#define ATA_H
+
+#include <stdint.h>
+
+// Каналы IDE в режиме совместимости: порты команд, регистр управления, IRQ
+#define ATA_PRIMARY_IO      0x1F0
+#define ATA_PRIMARY_CTL     0x3F6
+#define ATA_PRIMARY_IRQ     14
+#define ATA_SECONDARY_IO    0x170
+#define ATA_SECONDARY_CTL   0x376
+#define ATA_SECONDARY_IRQ   15
+
+#define ATA_CHANNELS        2
+// Диск n: канал n / 2, n % 2 - ведомый
+#define ATA_MAX_DRIVES      4
+
+// Регистры канала (смещения от порта команд)
+#define ATA_REG_DATA        0
+#define ATA_REG_ERROR       1
+#define ATA_REG_SECTOR_COUNT 2
+#define ATA_REG_LBA_LOW     3
+#define ATA_REG_LBA_MID     4
+#define ATA_REG_LBA_HIGH    5
+#define ATA_REG_DRIVE_HEAD  6
+#define ATA_REG_COMMAND     7
+#define ATA_REG_STATUS      7
+// Порт управления: чтение - альтернативный статус, запись - регистр управления
+
+// Биты статуса
+#define ATA_SR_ERR          0x01
+#define ATA_SR_DRQ          0x08
+#define ATA_SR_DF           0x20
+#define ATA_SR_DRDY         0x40
+#define ATA_SR_BSY          0x80
+
+// Регистр управления: запрет IRQ канала (без DMA обмен идет опросом)
+#define ATA_CTL_NIEN        0x02
+
+// Команды
+#define ATA_CMD_READ            0x20    // READ SECTORS
+#define ATA_CMD_READ_MULTIPLE   0xC4
+#define ATA_CMD_SET_MULTIPLE    0xC6
+#define ATA_CMD_IDENTIFY        0xEC
+#define ATA_CMD_READ_DMA        0xC8
+#define ATA_CMD_READ_DMA_EXT    0x25
+#define ATA_CMD_READ_EXT        0x24    // READ SECTORS EXT
+#define ATA_CMD_READ_MULTIPLE_EXT 0x29
+#define ATA_CMD_PACKET          0xA0
+
+// Сигнатура ATAPI в LBA_MID/LBA_HIGH после отвергнутого IDENTIFY
+#define ATAPI_SIGNATURE_MID 0x14
+#define ATAPI_SIGNATURE_HIGH 0xEB
+
+// ATAPI: пакет SCSI из 12 байт, сектор CD/DVD - 2048 байт
+#define ATAPI_PACKET_SIZE   12
+#define ATAPI_SECTOR_SIZE   2048
+#define ATAPI_CMD_REQUEST_SENSE 0x03
+#define ATAPI_CMD_READ_CAPACITY 0x25
+#define ATAPI_CMD_READ_10   0x28
+#define ATAPI_SENSE_BYTES   18
+// Байт на блок DRQ (LBA_MID/HIGH при отправке команды), кратно сектору
+#define ATAPI_BYTE_LIMIT    0xF800
+// Секторов на одну READ(10): счетчик в пакете 16-битный
+#define ATAPI_MAX_SECTORS   0xFFFF
+// Привод раскручивает диск и после смены носителя отвечает UNIT ATTENTION
+#define ATAPI_TIMEOUT_MS    5000
+#define ATAPI_RETRIES       3
+
+// IDE-контроллер PCI (PIIX3/PIIX4): класс 01h, подкласс 01h, BAR4 - регистры bus master
+#define ATA_PCI_CLASS       0x01
+#define ATA_PCI_SUBCLASS    0x01
+#define ATA_PROG_IF_BUSMASTER 0x80
+#define ATA_BM_BAR          4
+
+// Регистры bus master канала (смещения от BAR4, второй канал - еще + 8)
+#define BM_CHANNEL_STRIDE   0x08
+#define BM_COMMAND          0x00
+#define BM_STATUS           0x02
+#define BM_PRDT             0x04
+
+#define BM_CMD_START        0x01
+#define BM_CMD_READ         0x08    // направление: устройство -> память
+#define BM_SR_ACTIVE        0x01
+#define BM_SR_ERROR         0x02
+#define BM_SR_IRQ           0x04
+#define BM_SR_DRIVE0_DMA    0x20
+#define BM_SR_DRIVE1_DMA    0x40
+
+// Physical Region Descriptor: область не пересекает границу 64 КБ,
+// счетчик 0 означает 64 КБ, бит 15 флагов - последняя запись
+#define PRD_EOT             0x8000
+#define PRD_MAX_ENTRIES     8
+#define PRD_BOUNDARY        0x10000
+
+// LBA28 - адреса ниже 2^28 (128 ГБ), дальше команды EXT, если диск умеет LBA48
+#define ATA_LBA28_LIMIT     0x10000000
+
+#define ATA_SECTOR_SIZE     512
+// Счетчик секторов 0 означает 256
+#define ATA_MAX_SECTORS     256
+
+// Таймаут каждой фазы ожидания (BSY, затем DRDY или DRQ)
+#define ATA_TIMEOUT_MS      100
+// Общий срок опроса всех четырех позиций при поиске дисков
+#define ATA_PROBE_TIMEOUT_MS 500
+// Завершение DMA (256 секторов)
+#define ATA_DMA_TIMEOUT_MS  1000
+
+// Объем бенчмарка, читается в общий буфер SCRATCH_ADDR (memmap.h)
+#define ATA_BENCH_BYTES     (4 * 1024 * 1024)
+
+typedef struct {
+    uint8_t drive;              // первый найденный диск
+    uint32_t bytes;             // прочитано в каждом проходе
+    uint32_t single_us;         // READ SECTORS по сектору, inw на слово
+    uint32_t multi_us;          // READ MULTIPLE, rep insw на блок DRQ
+    uint32_t dma_us;            // READ DMA по IRQ14
+    uint32_t single_mbps_x10;
+    uint32_t multi_mbps_x10;
+    uint32_t dma_mbps_x10;
+    uint16_t multiple;          // секторов на блок DRQ
+} ata_bench_result_t;
+
+// Режим передачи не поддерживается
+#define ATA_MODE_NONE       0xFF
+
+// Разобранный ответ IDENTIFY DEVICE
+typedef struct {
+    char model[41];             // слова 27-46, без хвостовых пробелов
+    uint8_t lba48;              // слово 83, бит 10
+    uint8_t max_multiple;       // слово 47: секторов на блок DRQ, 0 - нет
+    uint8_t pio_mode;           // 0-4: слово 64 (режимы 3, 4) или слово 51
+    uint8_t mdma_mode;          // слово 63, старший поддерживаемый режим
+    uint8_t udma_mode;          // слово 88, если слово 53 бит 2
+    uint64_t sectors;           // слова 100-103 при LBA48, иначе 60-61
+} ata_identify_t;
+
+typedef struct {
+    uint32_t address;
+    uint16_t bytes;
+    uint16_t flags;
+} __attribute__((packed)) ata_prd_t;
+
+// Поиск дисков на обоих каналах: выбор и IDENTIFY уходят на оба канала
+// сразу, ответы собираются до одного общего срока ATA_PROBE_TIMEOUT_MS
+// (ведущий и ведомый делят регистры канала и опрашиваются по очереди).
+// Затем SET MULTIPLE MODE на максимум из слова 47 и bus master DMA, если
+// есть контроллер PCI и диск его поддерживает; вызывать после
+// interrupts_init() - завершение DMA приходит по IRQ14/IRQ15.
+// Диски регистрируются в blockdev как "IDE<n>"; возвращает число дисков
+uint8_t ata_init(void);
+// Есть хотя бы один диск ATA
+uint8_t ata_present(void);
+uint8_t ata_drive_present(uint8_t drive);
+// На позиции ответило устройство ATAPI (привод CD/DVD)
+uint8_t ata_drive_atapi(uint8_t drive);
+uint8_t ata_dma_available(uint8_t drive);
+// Секторов на прерывание DRQ; 0 - READ MULTIPLE не поддерживается
+uint16_t ata_multiple_sectors(uint8_t drive);
+// Для blockdev емкость ограничена 2^32 - 1 секторами (2 ТБ)
+uint32_t ata_total_sectors(uint8_t drive);
+// Данные IDENTIFY; 0, если диска нет
+const ata_identify_t* ata_identify(uint8_t drive);
+// "Primary master" и т.п.
+const char* ata_drive_position(uint8_t drive);
+
+// Чтение count секторов (до 256 за команду, дальше - следующими командами).
+// С DMA процессор спит до IRQ канала; иначе PIO: статус проверяется один раз
+// на блок DRQ, блок забирается одной rep insw. За границей LBA28 -
+// READ DMA EXT / READ MULTIPLE EXT / READ SECTORS EXT.
+uint8_t ata_read_sectors(uint8_t drive, uint32_t lba, uint32_t count, void* buffer);
+
+// ATAPI (PIO, опросом). Емкость по READ CAPACITY: секторов и байт на сектор
+uint8_t atapi_read_capacity(uint8_t drive, uint32_t* sectors, uint32_t* block_size);
+// count секторов по 2048 байт одной командой READ(10) (до ATAPI_MAX_SECTORS),
+// данные идут блоками DRQ по ATAPI_BYTE_LIMIT
+uint8_t atapi_read_sectors(uint8_t drive, uint32_t lba, uint32_t count, void* buffer);
+
+// Бенчмарк первого найденного диска: старый путь по сектору, READ MULTIPLE и DMA
+uint8_t ata_benchmark(ata_bench_result_t* result);
+
+#endif // ATA_H
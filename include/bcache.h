@@ -0,0 +1,33 @@
+#ifndef BCACHE_H
+#define BCACHE_H
+
+#include <stdint.h>
+#include "blockdev.h"
+
+// Кэш секторов: 16 наборов по 4 строки, по сектору в строке (32 КБ в .bss).
+// Ключ - (диск, LBA); в наборе вытесняется строка, которой дольше всех
+// не пользовались
+#define BCACHE_SETS         16
+#define BCACHE_WAYS         4
+// Чтения длиннее идут мимо кэша (загрузка ядра не вытесняет метаданные)
+#define BCACHE_MAX_REQUEST  8
+
+typedef struct {
+    uint32_t hits;          // секторов отдано из кэша
+    uint32_t misses;        // секторов прочитано с диска
+    uint32_t bypassed;      // длинных чтений мимо кэша
+    uint32_t evictions;
+    uint32_t lines_used;
+} bcache_stats_t;
+
+// Чтение через кэш (вызывается из blockdev_read после проверки границ);
+// при промахе весь запрос уходит в драйвер одной командой
+uint8_t bcache_read(blockdev_t* dev, uint32_t lba, uint32_t count, void* buffer);
+
+// Для путей записи: сбросить сектора диска (или весь диск)
+void bcache_invalidate(blockdev_t* dev, uint32_t lba, uint32_t count);
+void bcache_invalidate_device(blockdev_t* dev);
+
+void bcache_get_stats(bcache_stats_t* stats);
+
+#endif // BCACHE_H
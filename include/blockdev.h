@@ -0,0 +1,51 @@
+#ifndef BLOCKDEV_H
+#define BLOCKDEV_H
+
+#include <stdint.h>
+
+#define BLOCKDEV_MAX        8
+#define BLOCKDEV_SECTOR_SIZE 512
+
+// Типы контроллеров
+#define BLOCKDEV_ATA        0
+#define BLOCKDEV_AHCI       1
+#define BLOCKDEV_NVME       2
+#define BLOCKDEV_VIRTIO     3
+
+typedef struct blockdev blockdev_t;
+
+// Драйвер заполняет структуру и регистрирует ее; структура живет в драйвере
+struct blockdev {
+    char name[12];          // "IDE0", "AHCI2" - для меню и журнала
+    uint8_t type;
+    uint8_t unit;           // номер порта/диска внутри драйвера
+    uint32_t sectors;       // 0 - размер неизвестен
+    uint8_t (*read)(blockdev_t* dev, uint32_t lba, uint32_t count, void* buffer);
+};
+
+uint8_t blockdev_register(blockdev_t* dev);
+uint8_t blockdev_count(void);
+blockdev_t* blockdev_get(uint8_t index);
+// index - номер совпадения среди дисков типа type
+blockdev_t* blockdev_find_type(uint8_t type, uint8_t index);
+
+// Загрузочный диск: первый, на котором нет самой прошивки (заголовок
+// образа в LBA 5); если такого нет - первый зарегистрированный
+blockdev_t* blockdev_boot(void);
+// На диске сама прошивка (заголовок образа в LBA 5)
+uint8_t blockdev_holds_firmware(blockdev_t* dev);
+// Явный выбор загрузочного диска (порядок загрузки в настройках)
+void blockdev_select_boot(blockdev_t* dev);
+
+// Номер диска BIOS (DL) для загружаемого кода. Нижележащая прошивка
+// нумерует диски сама; считаем, что в том же порядке, с 0x80
+uint8_t blockdev_bios_drive(blockdev_t* dev);
+
+// Короткие чтения проходят через кэш секторов (bcache.h)
+uint8_t blockdev_read(blockdev_t* dev, uint32_t lba, uint32_t count, void* buffer);
+
+// Чтение с загрузочного диска
+uint8_t read_disk_sectors(uint32_t lba, uint32_t count, void* buffer);
+uint8_t read_disk_sector(uint32_t lba, uint16_t* buffer);
+
+#endif // BLOCKDEV_H
@@ -20,13 +20,25 @@ void debug_console(void);
 void show_system_registers(void);
 void dump_memory_map(void);
 void dump_cmos_registers(void);
+void show_screen_stats(void);
+void run_graphics_benchmark(void);
+void show_trace_buffer(void);
+void run_disk_benchmark(void);
+void show_block_cache_stats(void);
 void log_debug_message(const char* message, uint8_t color);
 void log_debug_hex(const char* label, uint32_t value, uint8_t color);
+// printf-style line (kprintf.h formats)
+void log_debugf(uint8_t color, const char* fmt, ...);
 void clear_debug_screen(void);
+uint8_t debug_console_scroll(uint8_t scancode);
+uint8_t debug_console_wait_key(void);
+void debug_console_release(void);
 
 extern void print_string(const char* str, uint8_t x, uint8_t y, uint8_t color);
+extern void print_char(char c, uint8_t x, uint8_t y, uint8_t color);
 extern void clear_screen(uint8_t color);
 extern uint8_t keyboard_read(void);
-extern void delay(uint32_t count);
+extern uint8_t keyboard_wait(void);
+extern uint8_t keyboard_wait_press(void);
 
 #endif
@@ -68,8 +68,18 @@ typedef struct {
     uint8_t cores;
 } cpu_info_t;
 
+// Счетчик тактов процессора (Pentium и выше)
+static inline uint64_t cpu_read_tsc(void) {
+    uint32_t lo, hi;
+    __asm__ volatile ("rdtsc" : "=a" (lo), "=d" (hi));
+    return ((uint64_t)hi << 32) | lo;
+}
+
 // Прототипы функций
 void cpu_detect(cpu_info_t* info);
 void cpu_print_info(const cpu_info_t* info, uint8_t x, uint8_t y, uint8_t color);
+uint32_t cpu_signature(void);
+uint8_t cpu_has_mwait(uint32_t* substates);
+uint8_t cpu_enable_sse2(void);
 
 #endif // CPU_H
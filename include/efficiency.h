@@ -21,6 +21,8 @@ typedef struct {
     uint8_t hdd_timeout;    // сек до отключения HDD
     uint8_t screen_timeout; // сек до отключения экрана
     uint8_t performance_boost; // 0-1
+    uint16_t idle_tick_hz;  // частота пробуждения из простоя (IRQ0)
+    uint8_t idle_cstate;    // целевое C-состояние для MWAIT (1 = как HLT)
 } power_settings_t;
 
 // Статистика энергопотребления
@@ -47,6 +49,10 @@ void show_power_info(uint8_t x, uint8_t y);
 void power_management_menu(void);
 void auto_power_management(void);
 
+// Простой: HLT/MWAIT до прерывания. Вызывать с запрещенными прерываниями,
+// возвращается с разрешенными.
+void power_idle(void);
+
 // Аппаратные функции
 void set_cpu_speed(uint8_t percent);
 void set_screen_brightness(uint8_t percent);
@@ -54,7 +60,10 @@ void control_fan_speed(uint8_t percent);
 void toggle_usb_power(uint8_t enable);
 void enable_performance_boost(uint8_t enable);
 
-// CMOS сохранение настроек
+// CMOS сохранение настроек. 0x30/0x31 - размер расширенной памяти,
+// их читают отпечаток POST и memmap
+#define CMOS_POWER_MODE 0x2A
+
 void save_power_settings_to_cmos(void);
 void load_power_settings_from_cmos(void);
 
@@ -0,0 +1,79 @@
+#ifndef ELTORITO_H
+#define ELTORITO_H
+
+#include <stdint.h>
+
+// Boot Record Volume Descriptor в секторе 17 (сектора CD по 2048 байт)
+#define ELTORITO_BRVD_LBA       17
+#define ELTORITO_CATALOG_OFFSET 0x47    // LBA каталога загрузки
+
+// Каталог загрузки: записи по 32 байта, первая - проверочная
+#define ELTORITO_ENTRY_SIZE     32
+#define ELTORITO_HEADER_ID      0x01
+#define ELTORITO_KEY            0xAA55
+#define ELTORITO_BOOTABLE       0x88
+#define ELTORITO_SECTION        0x90
+#define ELTORITO_SECTION_LAST   0x91
+#define ELTORITO_EXTENSION      0x44
+#define ELTORITO_PLATFORM_X86   0x00
+#define ELTORITO_MEDIA_MASK     0x0F
+#define ELTORITO_MEDIA_NOEMU    0x00
+#define ELTORITO_DEFAULT_SEGMENT 0x07C0
+// Пустой счетчик в записи - один сектор CD
+#define ELTORITO_DEFAULT_SECTORS 4
+
+// DL для образа без эмуляции: так нумерует приводы CD нижележащая прошивка
+#define ELTORITO_BIOS_DRIVE     0xE0
+
+// Образ читается целиком в SCRATCH_ADDR (memmap.h); в низкую память его
+// переносит realmode_jump (место загрузки обычно 0x7C00 - поверх payload)
+
+typedef struct {
+    uint8_t header_id;
+    uint8_t platform;
+    uint16_t reserved;
+    char id[24];
+    uint16_t checksum;          // сумма 16-битных слов записи = 0
+    uint16_t key;
+} __attribute__((packed)) eltorito_validation_t;
+
+typedef struct {
+    uint8_t indicator;          // 0x88 - загрузочная
+    uint8_t media;              // младшие 4 бита: 0 - без эмуляции
+    uint16_t load_segment;      // 0 - ELTORITO_DEFAULT_SEGMENT
+    uint8_t system_type;
+    uint8_t unused;
+    uint16_t sectors;           // виртуальных секторов по 512 байт
+    uint32_t load_rba;          // LBA образа (по 2048)
+    uint8_t reserved[20];
+} __attribute__((packed)) eltorito_entry_t;
+
+typedef struct {
+    uint8_t indicator;          // 0x90, у последней секции 0x91
+    uint8_t platform;
+    uint16_t entries;
+    char id[28];
+} __attribute__((packed)) eltorito_section_t;
+
+typedef struct {
+    uint8_t drive;              // позиция ATA (ata.h)
+    uint32_t catalog_lba;
+    uint16_t load_segment;
+    uint16_t sectors;
+    uint32_t load_rba;
+    uint32_t bytes;             // после eltorito_load
+} eltorito_boot_t;
+
+// Каталог El Torito на приводе ATAPI: первая загрузочная запись x86 без
+// эмуляции (запись по умолчанию, затем секции). Образы с эмуляцией
+// дискеты или диска не поддерживаются
+uint8_t eltorito_probe(uint8_t drive, eltorito_boot_t* boot);
+// Первый привод ATAPI с загрузочным диском
+uint8_t eltorito_find(eltorito_boot_t* boot);
+// Образ целиком одной командой READ(10) в SCRATCH_ADDR
+uint8_t eltorito_load(eltorito_boot_t* boot);
+// Перенос образа на место, CS:IP = сегмент:0, DL = ELTORITO_BIOS_DRIVE.
+// Перед вызовом - interrupts_shutdown(); не возвращается
+void eltorito_jump(const eltorito_boot_t* boot);
+
+#endif // ELTORITO_H
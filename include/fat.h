@@ -0,0 +1,128 @@
+#ifndef FAT_H
+#define FAT_H
+
+#include <stdint.h>
+#include "blockdev.h"
+#include "partition.h"
+
+#define FAT_SECTOR_SIZE     512
+
+// Тип определяется по числу кластеров, как в спецификации Microsoft
+#define FAT_TYPE_12         12
+#define FAT_TYPE_16         16
+#define FAT_TYPE_32         32
+#define FAT12_MAX_CLUSTERS  4085
+#define FAT16_MAX_CLUSTERS  65525
+
+// Конец цепочки (и все значения выше) для FAT32 после маски 0x0FFFFFFF
+#define FAT_CLUSTER_MASK    0x0FFFFFFF
+#define FAT_FIRST_CLUSTER   2
+
+// Атрибуты записи каталога
+#define FAT_ATTR_READ_ONLY  0x01
+#define FAT_ATTR_HIDDEN     0x02
+#define FAT_ATTR_SYSTEM     0x04
+#define FAT_ATTR_VOLUME_ID  0x08
+#define FAT_ATTR_DIRECTORY  0x10
+#define FAT_ATTR_ARCHIVE    0x20
+#define FAT_ATTR_LFN        0x0F
+
+#define FAT_DIR_ENTRY_SIZE  32
+#define FAT_ENTRY_FREE      0xE5
+#define FAT_ENTRY_END       0x00
+#define FAT_LFN_LAST        0x40
+// Длинное имя: 20 записей по 13 символов
+#define FAT_LFN_MAX         255
+#define FAT_PATH_MAX        128
+
+// Окно FAT: столько секторов таблицы читается одной командой
+#define FAT_WINDOW_SECTORS  16
+// Одна команда чтения данных - не больше стольких секторов слитной цепочки
+#define FAT_MAX_RUN_SECTORS 2048
+
+typedef struct {
+    uint8_t jump[3];
+    char oem[8];
+    uint16_t bytes_per_sector;
+    uint8_t sectors_per_cluster;
+    uint16_t reserved_sectors;
+    uint8_t fat_count;
+    uint16_t root_entries;
+    uint16_t total_sectors16;
+    uint8_t media;
+    uint16_t fat_size16;
+    uint16_t sectors_per_track;
+    uint16_t heads;
+    uint32_t hidden_sectors;
+    uint32_t total_sectors32;
+    // Дальше - только FAT32
+    uint32_t fat_size32;
+    uint16_t flags;
+    uint16_t version;
+    uint32_t root_cluster;
+} __attribute__((packed)) fat_bpb_t;
+
+typedef struct {
+    char name[11];
+    uint8_t attributes;
+    uint8_t reserved;
+    uint8_t create_tenths;
+    uint16_t create_time;
+    uint16_t create_date;
+    uint16_t access_date;
+    uint16_t cluster_high;
+    uint16_t write_time;
+    uint16_t write_date;
+    uint16_t cluster_low;
+    uint32_t size;
+} __attribute__((packed)) fat_dirent_t;
+
+typedef struct {
+    blockdev_t* dev;
+    uint32_t start;             // LBA загрузочного сектора тома
+    uint8_t type;
+    uint8_t sectors_per_cluster;
+    uint32_t fat_start;         // дальше все LBA абсолютные
+    uint32_t fat_sectors;
+    uint32_t root_start;        // FAT12/16: корневой каталог фиксированного размера
+    uint32_t root_sectors;
+    uint32_t root_cluster;      // FAT32: корневой каталог - цепочка кластеров
+    uint32_t data_start;
+    uint32_t clusters;
+} fat_volume_t;
+
+typedef struct {
+    uint32_t size;
+    uint32_t first_cluster;
+    uint8_t attributes;
+} fat_stat_t;
+
+typedef struct {
+    fat_volume_t* vol;
+    uint32_t first_cluster;
+    uint32_t size;
+    uint32_t position;
+    // Позиция в цепочке: кластер с номером cluster_index (для чтения подряд
+    // цепочка не проходится заново с начала)
+    uint32_t cluster;
+    uint32_t cluster_index;
+    uint8_t attributes;
+} fat_file_t;
+
+// Том в разделе или на диске без таблицы разделов (start = 0)
+uint8_t fat_mount(fat_volume_t* vol, blockdev_t* dev, uint32_t start);
+uint8_t fat_mount_partition(fat_volume_t* vol, const partition_t* part);
+// Первый том FAT на диске: его разделы из индекса, затем диск целиком
+uint8_t fat_mount_device(fat_volume_t* vol, blockdev_t* dev);
+// Первый том FAT: разделы из индекса partition_scan(), затем диски целиком
+uint8_t fat_mount_first(fat_volume_t* vol);
+
+// Пути от корня через '/', регистр не важен; длинные имена (LFN) и 8.3
+uint8_t fat_stat(fat_volume_t* vol, const char* path, fat_stat_t* stat);
+uint8_t fat_open(fat_volume_t* vol, const char* path, fat_file_t* file);
+// Слитные участки цепочки кластеров читаются одной командой на участок.
+// Возвращает прочитанное число байт (меньше bytes - конец файла или ошибка)
+uint32_t fat_read(fat_file_t* file, void* buffer, uint32_t bytes);
+uint8_t fat_seek(fat_file_t* file, uint32_t position);
+
+#endif // FAT_H
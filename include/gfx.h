@@ -0,0 +1,63 @@
+#ifndef GFX_H
+#define GFX_H
+
+#include <stdint.h>
+
+// Bochs/QEMU VBE DISPI
+#define VBE_DISPI_IOPORT_INDEX  0x01CE
+#define VBE_DISPI_IOPORT_DATA   0x01CF
+#define VBE_DISPI_INDEX_ID      0
+#define VBE_DISPI_INDEX_XRES    1
+#define VBE_DISPI_INDEX_YRES    2
+#define VBE_DISPI_INDEX_BPP     3
+#define VBE_DISPI_INDEX_ENABLE  4
+#define VBE_DISPI_INDEX_VIRT_WIDTH 6
+#define VBE_DISPI_ID0           0xB0C0
+#define VBE_DISPI_ID5           0xB0C5
+#define VBE_DISPI_ENABLED       0x01
+#define VBE_DISPI_LFB_ENABLED   0x40
+
+// PCI-адаптер Bochs VGA (QEMU -vga std); BAR0 - линейный буфер
+#define BOCHS_VGA_VENDOR        0x1234
+#define BOCHS_VGA_DEVICE        0x1111
+#define BOCHS_DEFAULT_LFB       0xE0000000
+
+// Режим: 640x480x32, текстовая сетка 80x25 ячеек 8x16 по центру
+#define GFX_WIDTH               640
+#define GFX_HEIGHT              480
+#define GFX_BPP                 32
+#define GFX_CELL_WIDTH          8
+#define GFX_CELL_HEIGHT         16
+#define GFX_TEXT_TOP            ((GFX_HEIGHT - 25 * GFX_CELL_HEIGHT) / 2)
+
+typedef struct {
+    uint32_t fill_mpps_x10;     // заливка, мегапикселей/с * 10
+    uint32_t blit_mpps_x10;     // копирование из ОЗУ
+    uint32_t glyph_mpps_x10;    // отрисовка символов
+    uint32_t redraw_us;         // полная перерисовка 80x25
+    uint8_t sse2;
+} gfx_bench_result_t;
+
+// Проверка DISPI; шрифт из плоскости 2 VGA захватывается при первом gfx_enter
+uint8_t gfx_init(void);
+uint8_t gfx_available(void);
+uint8_t gfx_active(void);
+uint8_t gfx_sse2(void);
+
+// Переключение режимов; при возврате в текст шрифт восстанавливается
+uint8_t gfx_enter(void);
+void gfx_leave(void);
+
+// Примитивы (цвет 0x00RRGGBB)
+void gfx_fill_rect(uint32_t x, uint32_t y, uint32_t w, uint32_t h, uint32_t color);
+void gfx_blit(uint32_t x, uint32_t y, uint32_t w, uint32_t h, const uint32_t* src, uint32_t src_pitch);
+void gfx_draw_glyph(uint32_t x, uint32_t y, uint8_t ch, uint32_t fg, uint32_t bg);
+// Ячейка текстового режима (символ + атрибут) в сетке 80x25
+void gfx_draw_cell(uint8_t col, uint8_t row, uint16_t cell);
+// Завершение потоковых записей (sfence)
+void gfx_sync(void);
+
+// Бенчмарк; use_sse2 = 0 - скалярные версии для сравнения
+void gfx_benchmark(uint8_t use_sse2, gfx_bench_result_t* result);
+
+#endif // GFX_H
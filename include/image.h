@@ -0,0 +1,68 @@
+#ifndef IMAGE_H
+#define IMAGE_H
+
+#include <stdint.h>
+
+// Раскладка загрузочного образа (сектора по 512 байт):
+//   LBA 0        - boot.asm (MBR, stage 1)
+//   LBA 1..4     - stage2.asm
+//   LBA 5        - заголовок образа (image_header_t)
+//   LBA 6..      - payload (biosmenu.bin, при IMAGE_FLAG_LZ4 - сжатый)
+//
+// Сжатый payload читается в конец собственного буфера (load_addr +
+// packed_offset) и распаковывается на место вперед, без второго буфера.
+#define IMAGE_SECTOR_SIZE    512
+#define IMAGE_STAGE2_LBA     1
+#define IMAGE_STAGE2_SECTORS 4
+#define IMAGE_HEADER_LBA     5
+#define IMAGE_PAYLOAD_LBA    6
+
+#define IMAGE_MAGIC          0x42495857  // "WXIB"
+#define IMAGE_VERSION        2
+
+// Флаги заголовка
+#define IMAGE_FLAG_LZ4       0x0001      // payload сжат LZ4 (block format)
+
+// Заголовок образа. Смещения полей продублированы в boot/stage2.asm -
+// при изменении структуры правим оба места.
+typedef struct {
+    uint32_t magic;        // 0x00 IMAGE_MAGIC
+    uint16_t version;      // 0x04
+    uint16_t flags;        // 0x06
+    uint32_t load_addr;    // 0x08 куда грузить payload (может быть выше 1 МБ)
+    uint32_t entry;        // 0x0C точка входа (адрес main)
+    uint32_t file_size;    // 0x10 размер payload в байтах
+    uint32_t mem_size;     // 0x14 размер в памяти вместе с .bss
+    uint32_t sectors;      // 0x18 секторов payload на диске
+    uint32_t checksum;     // 0x1C сумма 32-битных слов payload на диске (с выравниванием до сектора)
+    uint32_t packed_size;  // 0x20 размер сжатого потока LZ4
+    uint32_t packed_offset;// 0x24 смещение от load_addr, куда читается сжатый payload
+} __attribute__((packed)) image_header_t;
+
+// Данные, которые stage2 оставляет для C кода по фиксированному адресу
+#define BOOT_HANDOFF_ADDR    0x0500
+#define BOOT_HANDOFF_MAGIC   0x4F485857  // "WXHO"
+
+typedef struct {
+    uint32_t magic;              // 0x00 BOOT_HANDOFF_MAGIC
+    uint32_t image_checksum;     // 0x04 контрольная сумма образа (идентификатор сборки)
+    uint64_t tsc_stage2;         // 0x08 TSC при входе в stage2
+    uint64_t tsc_protected_mode; // 0x10 TSC после перехода в защищенный режим
+    uint64_t tsc_payload;        // 0x18 TSC после загрузки и распаковки payload
+    uint8_t  boot_drive;         // 0x20 номер загрузочного диска BIOS
+    uint8_t  e820_count;         // 0x21 записей в карте BOOT_E820_ADDR
+} __attribute__((packed)) boot_handoff_t;
+
+// Карта памяти INT 15h E820, собранная stage2 в реальном режиме
+#define BOOT_E820_ADDR       0x1000
+#define BOOT_E820_MAX        128
+
+#define E820_TYPE_RAM        1
+
+typedef struct {
+    uint64_t base;
+    uint64_t length;
+    uint32_t type;
+} __attribute__((packed)) e820_entry_t;
+
+#endif // IMAGE_H
@@ -0,0 +1,38 @@
+#ifndef INTERRUPTS_H
+#define INTERRUPTS_H
+
+#include <stdint.h>
+
+// Векторы после перепрограммирования 8259
+#define IRQ_BASE_MASTER 0x20
+#define IRQ_BASE_SLAVE  0x28
+
+// Линии IRQ
+#define IRQ_TIMER       0
+#define IRQ_KEYBOARD    1
+#define IRQ_CASCADE     2
+#define IRQ_COUNT       16
+
+// Размер очереди скан-кодов (степень двойки)
+#define KBD_QUEUE_SIZE  64
+
+typedef void (*irq_handler_t)(void);
+
+// IDT, перенастройка PIC, запуск тиков и клавиатуры по IRQ1
+void interrupts_init(void);
+// Возврат PIC и IVT к раскладке BIOS перед передачей управления ОС
+void interrupts_shutdown(void);
+uint8_t interrupts_active(void);
+
+// Обработчик IRQ; линия размаскируется автоматически
+void irq_install(uint8_t irq, irq_handler_t handler);
+
+// Очередь скан-кодов: IRQ1 пишет, меню читают
+void kbd_queue_push(uint8_t scancode);
+uint8_t kbd_queue_pop(uint8_t* scancode);
+uint8_t kbd_queue_wait(void);
+
+// Останов до следующего прерывания, если очередь клавиатуры пуста
+void interrupts_idle(void);
+
+#endif // INTERRUPTS_H
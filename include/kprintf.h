@@ -0,0 +1,27 @@
+#ifndef KPRINTF_H
+#define KPRINTF_H
+
+#include <stdint.h>
+#include <stdarg.h>
+
+// Форматы: %d %i %u %x %X %c %s %%, флаги '-' и '0', ширина (число или *),
+// точность для %s (%.3s). Модификатор 'l' допускается и игнорируется.
+// %C берет цвет из аргументов и меняет атрибут для следующих символов
+// (для строковых приемников не выводит ничего).
+
+// Приемник вывода: получает куски исходной строки, разряды и заполнители
+// напрямую, без сборки промежуточной строки
+typedef void (*ksink_t)(void* ctx, const char* str, uint32_t len, uint8_t color);
+
+// Возвращают количество выведенных символов
+int kvprintf(ksink_t sink, void* ctx, uint8_t color, const char* fmt, va_list args);
+
+// Вывод в теневой буфер экрана с позиции (x, y), с переносом, обрезка по концу экрана
+int kprintf(uint8_t x, uint8_t y, uint8_t color, const char* fmt, ...);
+
+// Строка всегда завершается нулем; возвращается полная длина результата
+// (больше size - 1, если строка обрезана)
+int ksnprintf(char* buffer, uint32_t size, const char* fmt, ...);
+int kvsnprintf(char* buffer, uint32_t size, const char* fmt, va_list args);
+
+#endif // KPRINTF_H
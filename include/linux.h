@@ -0,0 +1,90 @@
+#ifndef LINUX_H
+#define LINUX_H
+
+#include <stdint.h>
+#include "blockdev.h"
+#include "fat.h"
+
+// Конфигурация в корне тома FAT загрузочного диска, строки в духе syslinux:
+//   kernel /bzImage
+//   initrd /initrd.img
+//   append console=ttyS0 quiet
+#define LINUX_CONFIG_PATH   "/LINUX.CFG"
+#define LINUX_CONFIG_MAX    1024
+#define LINUX_CMDLINE_MAX   512
+
+// Размещение в низкой памяти: zero page и командная строка ниже
+// загрузочного сектора, карта E820 (BOOT_E820_ADDR) - перед ними
+#define LINUX_BOOT_PARAMS_ADDR  0x2000
+#define LINUX_BOOT_PARAMS_SIZE  4096
+#define LINUX_CMDLINE_ADDR      0x3000
+// Первые сектора bzImage: загрузочный сектор и заголовок настройки
+#define LINUX_HEADER_BYTES      1024
+
+// Заголовок настройки (Documentation/x86/boot.rst), смещения от начала bzImage
+// и одновременно в boot_params
+#define LINUX_SETUP_SECTS       0x1F1
+#define LINUX_BOOT_FLAG         0x1FE
+#define LINUX_JUMP_OFFSET       0x201   // конец заголовка: 0x202 + этот байт
+#define LINUX_HEADER            0x202
+#define LINUX_VERSION           0x206
+#define LINUX_TYPE_OF_LOADER    0x210
+#define LINUX_LOADFLAGS         0x211
+#define LINUX_CODE32_START      0x214
+#define LINUX_RAMDISK_IMAGE     0x218
+#define LINUX_RAMDISK_SIZE      0x21C
+#define LINUX_CMD_LINE_PTR      0x228
+#define LINUX_INITRD_ADDR_MAX   0x22C
+#define LINUX_CMDLINE_SIZE      0x238
+#define LINUX_INIT_SIZE         0x260
+
+#define LINUX_HDR_MAGIC         0x53726448  // "HdrS"
+#define LINUX_DEFAULT_SETUP_SECTS 4
+#define LINUX_LOADED_HIGH       0x01
+#define LINUX_LOADER_UNDEFINED  0xFF
+// 2.03: initrd_addr_max; с 2.06 - cmdline_size, 2.10 - init_size
+#define LINUX_MIN_VERSION       0x0203
+#define LINUX_OLD_CMDLINE_MAX   255
+#define LINUX_DEFAULT_INITRD_MAX 0x37FFFFFF
+
+// Поля boot_params вне заголовка настройки
+#define LINUX_BP_EXT_MEM_K      0x002
+#define LINUX_BP_VIDEO_MODE     0x006
+#define LINUX_BP_VIDEO_COLS     0x007
+#define LINUX_BP_VIDEO_LINES    0x00E
+#define LINUX_BP_VIDEO_IS_VGA   0x00F
+#define LINUX_BP_VIDEO_POINTS   0x010
+#define LINUX_BP_ALT_MEM_K      0x1E0
+#define LINUX_BP_E820_ENTRIES   0x1E8
+#define LINUX_BP_E820_TABLE     0x2D0
+
+// 32-битный вход: CS = __BOOT_CS, DS/ES/SS = __BOOT_DS, ESI - boot_params
+#define LINUX_BOOT_CS           0x10
+#define LINUX_BOOT_DS           0x18
+
+// Результат linux_load
+#define LINUX_OK                0
+#define LINUX_ERR_KERNEL        1   // ядра нет или не читается
+#define LINUX_ERR_FORMAT        2   // не bzImage или протокол старше 2.03
+#define LINUX_ERR_MEMORY        3   // ядро или initrd не помещаются в RAM
+#define LINUX_ERR_INITRD        4
+#define LINUX_ERR_CMDLINE       5
+
+typedef struct {
+    char kernel[FAT_PATH_MAX];
+    char initrd[FAT_PATH_MAX];      // пустая строка - без initrd
+    char cmdline[LINUX_CMDLINE_MAX];
+} linux_config_t;
+
+// Том FAT диска dev с LINUX_CONFIG_PATH; 0 - конфигурации нет
+uint8_t linux_find_config(blockdev_t* dev, fat_volume_t* vol, linux_config_t* config);
+// Ядро - по code32_start, initrd - под верх памяти из карты E820,
+// boot_params с командной строкой и картой памяти; LINUX_OK или код ошибки
+uint8_t linux_load(fat_volume_t* vol, const linux_config_t* config);
+const char* linux_error_name(uint8_t error);
+uint32_t linux_entry_point(void);
+// Переход на 32-битную точку входа ядра. Перед вызовом -
+// interrupts_shutdown(); не возвращается
+void linux_jump(void);
+
+#endif // LINUX_H
@@ -0,0 +1,31 @@
+#ifndef MEMMAP_H
+#define MEMMAP_H
+
+#include <stdint.h>
+
+// Общий временный буфер выше payload: бенчмарки диска и графики, образ
+// обновления, загрузочный образ CD. Операции не пересекаются, поэтому
+// буфер один; перед использованием - memmap_scratch()
+#define SCRATCH_ADDR            0x00400000
+#define SCRATCH_SIZE            0x00400000  // до 8 МБ
+
+// CMOS: расширенная память над 1 МБ в КБ (до 64 МБ)
+// и над 16 МБ блоками по 64 КБ
+#define CMOS_EXT_MEM_LOW        0x30
+#define CMOS_EXT_MEM_HIGH       0x31
+#define CMOS_EXT_MEM2_LOW       0x34
+#define CMOS_EXT_MEM2_HIGH      0x35
+
+// Конец непрерывной RAM, в которой лежит start: по карте E820 из stage2,
+// без нее - по размеру из CMOS. Не выше 4 ГБ; 0 - адрес не в RAM
+uint32_t memmap_ram_end(uint32_t start);
+// 1 - весь диапазон [start, start + size) в RAM
+uint8_t memmap_is_ram(uint32_t start, uint32_t size);
+// 1 - диапазон задевает сам payload: от адреса загрузки до конца .bss
+// (_payload_start и _end из linker.ld, LOAD_ADDR может быть и 0x100000)
+uint8_t memmap_overlaps_payload(uint32_t start, uint32_t size);
+// SCRATCH_ADDR, если size байт помещаются в буфер, за ним есть RAM и он
+// не пересекается с payload; иначе 0
+void* memmap_scratch(uint32_t size);
+
+#endif // MEMMAP_H
@@ -0,0 +1,93 @@
+#ifndef NVME_H
+#define NVME_H
+
+#include <stdint.h>
+
+// Контроллер: класс 01h, подкласс 08h (NVM), интерфейс 02h (NVMe), BAR0
+#define NVME_PCI_CLASS      0x01
+#define NVME_PCI_SUBCLASS   0x08
+#define NVME_PCI_PROG_IF    0x02
+
+// Регистры контроллера
+#define NVME_REG_CAP        0x00    // 64 бита
+#define NVME_REG_VS         0x08
+#define NVME_REG_INTMS      0x0C
+#define NVME_REG_CC         0x14
+#define NVME_REG_CSTS       0x1C
+#define NVME_REG_AQA        0x24
+#define NVME_REG_ASQ        0x28    // 64 бита
+#define NVME_REG_ACQ        0x30    // 64 бита
+#define NVME_REG_DOORBELL   0x1000
+
+#define NVME_CC_EN          0x00000001
+#define NVME_CC_IOSQES      (6 << 16)   // 64 байта
+#define NVME_CC_IOCQES      (4 << 20)   // 16 байт
+#define NVME_CSTS_RDY       0x00000001
+#define NVME_CSTS_CFS       0x00000002
+
+// Команды администратора
+#define NVME_ADMIN_CREATE_SQ    0x01
+#define NVME_ADMIN_CREATE_CQ    0x05
+#define NVME_ADMIN_IDENTIFY     0x06
+#define NVME_IDENTIFY_NAMESPACE  0
+#define NVME_IDENTIFY_CONTROLLER 1
+
+// Команды ввода-вывода
+#define NVME_CMD_READ       0x02
+
+// Страница памяти контроллера (CC.MPS = 0)
+#define NVME_PAGE_SIZE      4096
+
+#define NVME_ADMIN_QUEUE_SIZE 16
+#define NVME_IO_QUEUE_SIZE  32
+#define NVME_IO_QUEUE_ID    1
+
+// Секторов на одну команду Read; остаток страниц - в списке PRP
+#define NVME_MAX_SECTORS    256
+#define NVME_PRP_ENTRIES    32
+
+#define NVME_MAX_NAMESPACES 4
+// Сколько номеров пространств имен опрашивать
+#define NVME_SCAN_NAMESPACES 16
+
+#define NVME_TIMEOUT_MS     1000
+
+// Команда очереди отправки (64 байта)
+typedef struct {
+    uint8_t opcode;
+    uint8_t flags;
+    uint16_t cid;
+    uint32_t nsid;
+    uint32_t reserved[2];
+    uint32_t mptr[2];
+    uint32_t prp1[2];
+    uint32_t prp2[2];
+    uint32_t cdw10;
+    uint32_t cdw11;
+    uint32_t cdw12;
+    uint32_t cdw13;
+    uint32_t cdw14;
+    uint32_t cdw15;
+} nvme_sqe_t;
+
+// Запись очереди завершения (16 байт); бит 0 status - фаза
+typedef struct {
+    uint32_t result;
+    uint32_t reserved;
+    uint16_t sq_head;
+    uint16_t sq_id;
+    uint16_t cid;
+    uint16_t status;
+} nvme_cqe_t;
+
+// Сброс и запуск контроллера, очередь администратора, одна пара очередей
+// ввода-вывода. Пространства имен с секторами по 512 байт регистрируются
+// в blockdev как "NVME<nsid>". Завершения опрашиваются по биту фазы.
+uint8_t nvme_init(void);
+uint8_t nvme_namespace_count(void);
+// Перед переходом в реальный режим: контроллер выключается, регистры
+// очереди администратора BIOS возвращаются. Его очереди ввода-вывода не
+// пересоздаются, поэтому цепная загрузка с NVMe запрещена
+void nvme_shutdown(void);
+
+#endif // NVME_H
@@ -0,0 +1,110 @@
+#ifndef PARTITION_H
+#define PARTITION_H
+
+#include <stdint.h>
+#include "blockdev.h"
+
+// MBR: таблица из 4 записей по смещению 446, сигнатура 0xAA55
+#define MBR_TABLE_OFFSET    446
+#define MBR_ENTRIES         4
+#define MBR_SIGNATURE       0xAA55
+#define MBR_ACTIVE          0x80
+
+// Типы MBR
+#define MBR_TYPE_EMPTY      0x00
+#define MBR_TYPE_EXTENDED   0x05
+#define MBR_TYPE_EXTENDED_LBA 0x0F
+#define MBR_TYPE_EXTENDED_LINUX 0x85
+#define MBR_TYPE_GPT        0xEE    // защитный MBR перед GPT
+
+// Цепочка EBR: не больше стольких логических разделов
+#define MBR_MAX_LOGICAL     32
+
+// GPT: заголовок в LBA 1, копия - в последнем секторе диска
+#define GPT_HEADER_LBA      1
+#define GPT_SIGNATURE_LOW   0x20494645  // "EFI "
+#define GPT_SIGNATURE_HIGH  0x54524150  // "PART"
+#define GPT_HEADER_MIN_SIZE 92
+#define GPT_MIN_ENTRY_SIZE  128
+// Массив записей читается кусками по столько секторов за команду
+#define GPT_READ_SECTORS    32
+// Больше массив не читаем (обычно 128 записей по 128 байт - 32 сектора)
+#define GPT_MAX_ARRAY_SECTORS 256
+// Атрибут записи: бит 2 - "legacy BIOS bootable"
+#define GPT_ATTR_LEGACY_BOOT 0x00000004
+
+// Сколько разделов помнит индекс (все диски вместе)
+#define PARTITION_MAX       32
+
+// Флаги раздела
+#define PARTITION_ACTIVE    0x01    // MBR 0x80 или атрибут GPT legacy boot
+#define PARTITION_BOOTABLE  0x02    // в первом секторе есть сигнатура 0xAA55
+#define PARTITION_LOGICAL   0x04    // логический раздел в расширенном
+
+#define PARTITION_SCHEME_MBR 0
+#define PARTITION_SCHEME_GPT 1
+
+typedef struct {
+    uint8_t status;
+    uint8_t chs_first[3];
+    uint8_t type;
+    uint8_t chs_last[3];
+    uint32_t lba_first;
+    uint32_t sectors;
+} __attribute__((packed)) mbr_entry_t;
+
+typedef struct {
+    uint32_t signature[2];
+    uint32_t revision;
+    uint32_t header_size;
+    uint32_t header_crc32;
+    uint32_t reserved;
+    uint64_t my_lba;
+    uint64_t alternate_lba;
+    uint64_t first_usable;
+    uint64_t last_usable;
+    uint8_t disk_guid[16];
+    uint64_t entries_lba;
+    uint32_t entry_count;
+    uint32_t entry_size;
+    uint32_t entries_crc32;
+} __attribute__((packed)) gpt_header_t;
+
+typedef struct {
+    uint8_t type_guid[16];
+    uint8_t unique_guid[16];
+    uint64_t first_lba;
+    uint64_t last_lba;
+    uint64_t attributes;
+    uint16_t name[36];      // UTF-16LE
+} __attribute__((packed)) gpt_entry_t;
+
+typedef struct {
+    blockdev_t* dev;
+    uint8_t number;         // 1-4 - основные MBR, 5+ - логические; в GPT - номер записи + 1
+    uint8_t scheme;
+    uint8_t type;           // тип MBR; для GPT - 0
+    uint8_t flags;
+    uint32_t start;
+    uint32_t sectors;
+    char name[20];          // имя раздела GPT или название типа
+    mbr_entry_t entry;      // запись MBR для DS:SI при передаче управления
+} partition_t;
+
+// Разбор таблиц разделов всех дисков blockdev: MBR с цепочкой EBR, GPT
+// с проверкой CRC32 заголовка и массива записей (при порче основной
+// копии - резервная в конце диска). Массив записей GPT читается за один
+// проход крупными кусками; первый сектор каждого раздела проверяется
+// на сигнатуру 0xAA55. Возвращает число разделов в индексе
+uint8_t partition_scan(void);
+uint8_t partition_count(void);
+const partition_t* partition_get(uint8_t index);
+// Разделов с загрузочным сектором (пункты меню выбора ОС)
+uint8_t partition_bootable_count(void);
+const char* partition_scheme_name(const partition_t* part);
+
+// CRC-32 (IEEE 802.3), как в zlib: начальное значение 0, можно продолжать
+// с результата предыдущего куска
+uint32_t crc32(uint32_t crc, const void* data, uint32_t length);
+
+#endif // PARTITION_H
@@ -0,0 +1,66 @@
+#ifndef PCI_H
+#define PCI_H
+
+#include <stdint.h>
+
+// Механизм конфигурации #1
+#define PCI_CONFIG_ADDRESS  0xCF8
+#define PCI_CONFIG_DATA     0xCFC
+
+// Регистры конфигурационного пространства
+#define PCI_VENDOR_ID       0x00
+#define PCI_DEVICE_ID       0x02
+#define PCI_COMMAND         0x04
+#define PCI_STATUS          0x06
+#define PCI_PROG_IF         0x09
+#define PCI_SUBCLASS        0x0A
+#define PCI_CLASS           0x0B
+#define PCI_HEADER_TYPE     0x0E
+#define PCI_BAR0            0x10
+#define PCI_CAPABILITIES    0x34
+#define PCI_INTERRUPT_LINE  0x3C
+
+// Биты регистра команд
+#define PCI_COMMAND_IO      0x0001
+#define PCI_COMMAND_MEMORY  0x0002
+#define PCI_COMMAND_MASTER  0x0004
+
+// Бит регистра состояния: есть список capabilities
+#define PCI_STATUS_CAP_LIST 0x0010
+
+#define PCI_MAX_DEVICES     64
+
+typedef struct {
+    uint8_t bus;
+    uint8_t slot;
+    uint8_t func;
+    uint16_t vendor_id;
+    uint16_t device_id;
+    uint8_t class_code;
+    uint8_t subclass;
+    uint8_t prog_if;
+    uint8_t irq_line;
+} pci_device_t;
+
+uint32_t pci_read32(const pci_device_t* dev, uint8_t offset);
+uint16_t pci_read16(const pci_device_t* dev, uint8_t offset);
+uint8_t pci_read8(const pci_device_t* dev, uint8_t offset);
+void pci_write32(const pci_device_t* dev, uint8_t offset, uint32_t value);
+void pci_write16(const pci_device_t* dev, uint8_t offset, uint16_t value);
+
+// Перечисление выполняется один раз, дальше поиск идет по таблице
+uint8_t pci_device_count(void);
+const pci_device_t* pci_get_device(uint8_t index);
+const pci_device_t* pci_find_device(uint16_t vendor_id, uint16_t device_id);
+// index - номер совпадения (0 - первое устройство класса)
+const pci_device_t* pci_find_class(uint8_t class_code, uint8_t subclass, uint8_t index);
+
+// Адрес BAR без флагов; для IO BAR - номер порта
+uint32_t pci_bar(const pci_device_t* dev, uint8_t bar);
+void pci_enable(const pci_device_t* dev, uint16_t command_bits);
+
+// Смещение следующей capability с заданным ID после offset (0 - с начала
+// списка); 0 - не найдена
+uint8_t pci_find_capability(const pci_device_t* dev, uint8_t id, uint8_t offset);
+
+#endif // PCI_H
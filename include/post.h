@@ -12,6 +12,10 @@
 #define POST_DISK_FAIL 5
 #define POST_CMOS_FAIL 6
 
+// Флаги быстрой загрузки (CMOS 0x24)
+#define POST_FAST_BOOT_ENABLED 0x01
+#define POST_FORCE_FULL        0x02
+
 // Функции POST
 uint8_t run_post(void);
 void post_cpu_test(void);
@@ -22,6 +26,13 @@ void post_disk_test(void);
 void post_cmos_test(void);
 void show_post_error(uint8_t error_code);
 void beep(uint32_t frequency, uint32_t duration);
-void post_delay(uint32_t count); // Изменено имя для избежания конфликтов
+void post_delay(uint32_t milliseconds); // Изменено имя для избежания конфликтов
+
+// Быстрая загрузка: сокращенный POST при неизменном отпечатке оборудования
+uint8_t post_fast_boot_active(void);
+uint8_t post_get_fast_boot(void);
+void post_set_fast_boot(uint8_t enabled);
+void post_force_full_next_boot(void);
+void post_invalidate_fingerprint(void);
 
 #endif // POST_H
@@ -0,0 +1,58 @@
+#ifndef REALMODE_H
+#define REALMODE_H
+
+#include <stdint.h>
+
+// Низкая память для возврата в реальный режим. Занята только stage2,
+// который к моменту передачи управления уже не нужен. 0x0600-0x07FF не
+// трогаем: там копия MBR, на запись таблицы разделов в ней указывает DS:SI
+#define REALMODE_GDT_ADDR       0x0540  // 16-битные код и данные, 32-битный код
+#define REALMODE_GDTR_ADDR      0x0568
+#define REALMODE_REGS_ADDR      0x0570  // realmode_regs_t
+#define REALMODE_STUB_ADDR      0x0800
+#define REALMODE_STUB_MAX       0x0100
+
+#define REALMODE_CODE_SEL       0x08
+#define REALMODE_DATA_SEL       0x10
+#define REALMODE_FLAT_CODE_SEL  0x18
+
+// Загружаемый код не может лежать ниже конца заглушки и выше базовой
+// памяти: над ней EBDA, которую использует BIOS, вызываемый образом
+#define REALMODE_LOAD_MIN       (REALMODE_STUB_ADDR + REALMODE_STUB_MAX)
+#define REALMODE_LOW_MEM_END    0xA0000
+#define REALMODE_BDA_BASE_MEM   0x0413  // слово BDA: базовая память в КБ
+
+// Запись раздела для загрузочного сектора раздела (как у стандартного MBR)
+#define REALMODE_PART_ENTRY     0x07BE
+
+// Регистры при входе в загруженный код. Смещения полей продублированы
+// в заглушке realmode.c
+typedef struct {
+    uint16_t ip;            // 0x00
+    uint16_t cs;            // 0x02
+    uint16_t ss;            // 0x04
+    uint16_t sp;            // 0x06
+    uint16_t ds;            // 0x08
+    uint16_t es;            // 0x0A
+    uint16_t si;            // 0x0C
+    uint16_t di;            // 0x0E
+    uint32_t ebx;           // 0x10
+    uint32_t edx;           // 0x14 DL - номер диска BIOS
+    // Перенос образа в низкую память перед переходом (move_bytes = 0 - нет).
+    // Делает заглушка: место назначения может накрывать сам payload
+    uint32_t move_src;      // 0x18
+    uint32_t move_dest;     // 0x1C
+    uint32_t move_bytes;    // 0x20
+} __attribute__((packed)) realmode_regs_t;
+
+// Верхняя граница загрузки: базовая память из BDA, не выше 640 КБ
+uint32_t realmode_load_max(void);
+
+// Переход из защищенного режима в реальный и дальний переход на cs:ip.
+// Перед вызовом - interrupts_shutdown() (PIC и IVT BIOS); не возвращается
+void realmode_jump(const realmode_regs_t* regs);
+
+// Загрузочный сектор уже лежит по 0x7C00: CS:IP = 0:7C00, стек под ним
+void realmode_boot_sector(uint8_t bios_drive, uint16_t part_entry);
+
+#endif // REALMODE_H
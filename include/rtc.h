@@ -15,6 +15,10 @@
 #define CMOS_STATUS_A    0x0A
 #define CMOS_STATUS_B    0x0B
 
+// Таймауты часов
+#define CMOS_UPDATE_TIMEOUT_MS  10
+#define CMOS_DISPLAY_PERIOD_MS  500
+
 // Структура для хранения времени
 typedef struct {
     uint8_t second;
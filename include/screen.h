@@ -0,0 +1,42 @@
+#ifndef SCREEN_H
+#define SCREEN_H
+
+#include <stdint.h>
+
+// Текстовый режим 80x25
+#define SCREEN_WIDTH        80
+#define SCREEN_HEIGHT       25
+#define SCREEN_VIDEO_MEMORY 0xB8000
+
+// Неизмененные ячейки между изменениями, которые еще склеиваются в один отрезок
+#define SCREEN_SPAN_MERGE_GAP 4
+
+// Статистика вывода теневого буфера
+typedef struct {
+    uint32_t frames;        // вызовов screen_flush() с изменениями
+    uint32_t cells_last;    // ячеек скопировано в последнем кадре
+    uint32_t cells_peak;    // максимум ячеек за кадр
+    uint32_t cells_total;   // всего скопировано ячеек
+    uint32_t cells_drawn;   // всего записей print_*/clear_screen в теневой буфер
+} screen_stats_t;
+
+// print_string/print_char/clear_screen (console.h) пишут в теневой буфер,
+// screen_flush() переносит в видеопамять только изменившиеся ячейки.
+void screen_flush(void);
+// Видеопамять изменена в обход буфера - следующий flush перепишет все
+void screen_invalidate(void);
+const screen_stats_t* screen_get_stats(void);
+// Запись len символов с позиции y * SCREEN_WIDTH + x (обрезка по концу экрана)
+void screen_write(uint32_t pos, const char* str, uint32_t len, uint8_t color);
+
+// Прямой доступ к видеопамяти (отладочная консоль со скроллингом):
+// пока вывод приостановлен, flush ничего не пишет
+void screen_set_start(uint16_t cell_offset);
+void screen_suspend(void);
+void screen_resume(void);
+
+// Текстовая сетка через DISPI (gfx.h) или обычный текстовый режим;
+// 0 - графика недоступна
+uint8_t screen_use_graphics(uint8_t enable);
+
+#endif // SCREEN_H
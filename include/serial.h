@@ -0,0 +1,43 @@
+#ifndef SERIAL_H
+#define SERIAL_H
+
+#include <stdint.h>
+
+// Порты 16550 и их линии IRQ
+#define SERIAL_COM1         0x3F8
+#define SERIAL_COM2         0x2F8
+#define SERIAL_COM1_IRQ     4
+#define SERIAL_COM2_IRQ     3
+
+// 115200 бод: делитель от 1.8432 МГц / 16
+#define SERIAL_BAUD         115200
+#define SERIAL_DIVISOR      (115200 / SERIAL_BAUD)
+
+// Кольцо передачи (степень двойки) и глубина FIFO передатчика
+#define SERIAL_TX_RING_SIZE 8192
+#define SERIAL_FIFO_DEPTH   16
+
+// Одиночный ESC отличается от начала последовательности по паузе
+#define SERIAL_ESC_TIMEOUT_MS 50
+
+// Поиск COM1, затем COM2; FIFO, 8N1, IRQ на прием и опустошение передатчика.
+// До interrupts_init() передача идет опросом блоками по глубине FIFO.
+uint8_t serial_init(void);
+uint8_t serial_available(void);
+uint16_t serial_port(void);
+
+// Данные в кольцо; байты уходят из обработчика IRQ
+void serial_write(const char* data, uint32_t len);
+// Дождаться отправки кольца и отключить IRQ порта (перед передачей управления ОС)
+void serial_shutdown(void);
+// Из цикла простоя: одиночный ESC по истечении паузы
+void serial_poll(void);
+
+// Зеркало текстового экрана в ANSI/VT100: выводятся только переданные ячейки,
+// курсор и атрибуты переставляются только при необходимости
+void serial_console_clear(void);
+void serial_console_cells(uint32_t pos, const uint16_t* cells, uint32_t count);
+// Строка журнала отладочной консоли (прокрутка средствами терминала)
+void serial_console_line(const char* text, uint8_t color);
+
+#endif // SERIAL_H
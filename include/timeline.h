@@ -0,0 +1,37 @@
+#ifndef TIMELINE_H
+#define TIMELINE_H
+
+#include <stdint.h>
+
+// Контрольные точки загрузки. Каждая отметка ставится по завершении
+// этапа, длительность этапа - разница с предыдущей отметкой.
+typedef enum {
+    TL_STAGE2 = 0,          // вход в stage2 (boot/stage2.asm)
+    TL_PROTECTED_MODE,      // переход в защищенный режим
+    TL_PAYLOAD,             // payload загружен и распакован
+    TL_MAIN,                // вход в main()
+    TL_POST_CPU,
+    TL_POST_MEMORY,
+    TL_POST_VIDEO,
+    TL_POST_KEYBOARD,
+    TL_POST_DISK,
+    TL_POST_CMOS,
+    TL_POST_DONE,           // финальные сигналы POST
+    TL_BOOT_SCREEN,
+    TL_LOAD_SETTINGS,
+    TL_WATCH_INIT,
+    TL_EFFICIENCY_INIT,
+    TL_AUTO_BOOT_CHECK,
+    TL_BOOT_HANDOFF,        // передача управления загрузчику ОС
+    TL_POINT_COUNT
+} timeline_point_t;
+
+// Сколько прошлых загрузок хранится в CMOS
+#define TIMELINE_HISTORY 4
+
+void timeline_init(void);
+void timeline_mark(timeline_point_t point);
+void timeline_commit(void);
+void timeline_show(void);
+
+#endif // TIMELINE_H
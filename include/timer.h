@@ -0,0 +1,38 @@
+#ifndef TIMER_H
+#define TIMER_H
+
+#include <stdint.h>
+
+// Частота PIT 8254
+#define PIT_FREQUENCY 1193182
+
+// Частота системного тика (IRQ0) по умолчанию
+#define TIMER_TICK_HZ 100
+
+// Крайний срок в тактах TSC
+typedef uint64_t deadline_t;
+
+// Калибровка TSC по каналу 2 PIT, вызывается первой в main()
+void timer_init(void);
+uint32_t timer_tsc_khz(void);
+
+// Монотонное время с момента timer_init()
+uint64_t now_ns(void);
+uint32_t timer_cycles_to_us(uint64_t cycles);
+uint32_t timer_cycles_to_ms(uint64_t cycles);
+
+// Задержки реального времени
+void udelay(uint32_t us);
+void mdelay(uint32_t ms);
+
+// Периодический тик на канале 0 PIT (IRQ0)
+void timer_start_tick(uint32_t hz);
+void timer_stop_tick(void);
+uint32_t timer_ticks(void);
+
+// Крайние сроки для ожиданий с таймаутом
+deadline_t deadline_after_us(uint32_t us);
+deadline_t deadline_after_ms(uint32_t ms);
+uint8_t deadline_expired(deadline_t deadline);
+
+#endif // TIMER_H
@@ -0,0 +1,128 @@
+#ifndef TRACE_H
+#define TRACE_H
+
+#include <stdint.h>
+
+// Кольцо записей фиксированного размера (степень двойки)
+#define TRACE_RING_SIZE     1024
+#define TRACE_FORMAT_VERSION 1
+
+// Порт debugcon QEMU/Bochs (-debugcon file:trace.log)
+#define TRACE_DEBUGCON_PORT 0xE9
+
+// Подсистемы (номер бита в trace_mask)
+#define TRACE_SYS_CORE      0
+#define TRACE_SYS_POST      1
+#define TRACE_SYS_IDE       2
+#define TRACE_SYS_USB       3
+#define TRACE_SYS_CMOS      4
+#define TRACE_SYS_BOOT      5
+#define TRACE_SYS_AHCI      6
+#define TRACE_SYS_NVME      7
+#define TRACE_SYS_VIRTIO    8
+#define TRACE_SYS_COUNT     9
+
+// Уровни
+#define TRACE_ERROR         0
+#define TRACE_WARN          1
+#define TRACE_INFO          2
+#define TRACE_DEBUG         3
+
+// События по подсистемам; tools/trace_decode.py берет имена отсюда
+#define TRACE_CORE_DRAIN        0x0001  // arg0 = записей, arg1 = потеряно
+
+#define TRACE_POST_BEGIN        0x0001  // arg0 = быстрая загрузка
+#define TRACE_POST_TEST         0x0002  // arg0 = точка timeline, arg1 = результат
+
+#define TRACE_IDE_READ          0x0001  // arg0 = LBA, arg1 = секторов
+#define TRACE_IDE_READ_DONE     0x0002  // arg0 = LBA, arg1 = статус
+#define TRACE_IDE_READ_ERROR    0x0003  // arg0 = LBA, arg1 = статус
+#define TRACE_IDE_TIMEOUT       0x0004  // arg0 = фаза (0 - BSY, 1 - DRDY, 2 - поиск), arg1 = статус или диск
+#define TRACE_IDE_DMA           0x0005  // arg0 = порт bus master, arg1 = IRQ
+#define TRACE_IDE_DMA_ERROR     0x0006  // arg0 = LBA, arg1 = статус BM << 8 | статус
+#define TRACE_IDE_IDENTIFY      0x0007  // arg0 = секторов (младшие 32 бита), arg1 = диск << 24 | LBA48 << 16 | UDMA << 8 | PIO
+#define TRACE_IDE_PROBE         0x0008  // arg0 = маска дисков | ATAPI << 4, arg1 = мкс
+#define TRACE_IDE_PACKET        0x0009  // arg0 = диск << 8 | опкод, arg1 = принято байт
+#define TRACE_IDE_PACKET_ERROR  0x000A  // arg0 = диск << 8 | опкод, arg1 = ошибка << 8 | статус
+
+#define TRACE_USB_FOUND         0x0001  // arg0 = порт контроллера
+#define TRACE_USB_INIT          0x0002  // arg0 = порт, arg1 = успех
+#define TRACE_USB_READ          0x0003  // arg0 = порт, arg1 = LBA
+
+#define TRACE_CMOS_READ         0x0001  // arg0 = регистр, arg1 = значение
+#define TRACE_CMOS_WRITE        0x0002  // arg0 = регистр, arg1 = значение
+
+#define TRACE_BOOT_SIGNATURE    0x0001  // arg0 = устройство, arg1 = сигнатура
+#define TRACE_BOOT_HANDOFF      0x0002  // arg0 = устройство, arg1 = адрес перехода
+#define TRACE_BOOT_PARTITION    0x0003  // arg0 = первый LBA, arg1 = схема << 16 | флаги << 8 | тип
+#define TRACE_BOOT_PART_ERROR   0x0004  // arg0 = LBA таблицы, arg1 = CRC32 или 0
+#define TRACE_BOOT_ELTORITO     0x0005  // arg0 = LBA образа (2048), arg1 = сегмент << 16 | секторов (512)
+#define TRACE_BOOT_LINUX        0x0006  // arg0 = байт ядра, arg1 = байт initrd
+
+#define TRACE_AHCI_FOUND        0x0001  // arg0 = порт, arg1 = секторов
+#define TRACE_AHCI_READ         0x0002  // arg0 = LBA, arg1 = секторов
+#define TRACE_AHCI_ERROR        0x0003  // arg0 = порт, arg1 = PxTFD
+#define TRACE_AHCI_TIMEOUT      0x0004  // arg0 = порт, arg1 = незавершенные слоты
+
+#define TRACE_NVME_FOUND        0x0001  // arg0 = nsid, arg1 = секторов (0 - сектор не 512 байт)
+#define TRACE_NVME_READ         0x0002  // arg0 = LBA, arg1 = секторов
+#define TRACE_NVME_ERROR        0x0003  // arg0 = опкод или cid, arg1 = статус
+#define TRACE_NVME_TIMEOUT      0x0004  // arg0 = опкод, arg1 = команд в работе
+
+#define TRACE_VIRTIO_FOUND      0x0001  // arg0 = modern, arg1 = секторов
+#define TRACE_VIRTIO_READ       0x0002  // arg0 = LBA, arg1 = секторов
+#define TRACE_VIRTIO_ERROR      0x0003  // arg0 = запрос в пакете, arg1 = статус
+#define TRACE_VIRTIO_TIMEOUT    0x0004  // arg0 = avail idx, arg1 = used idx
+
+// Устройства для событий BOOT
+#define TRACE_DEV_DISK      0
+#define TRACE_DEV_USB       1
+#define TRACE_DEV_PARTITION 2
+#define TRACE_DEV_CDROM     3
+#define TRACE_DEV_LINUX     4
+
+// Получатели выгрузки
+#define TRACE_OUT_SERIAL    0x01
+#define TRACE_OUT_DEBUGCON  0x02
+
+// Запись - 24 байта, формат выгрузки описан в tools/trace_decode.py
+typedef struct {
+    uint64_t tsc;
+    uint32_t seq;
+    uint16_t event;
+    uint8_t subsystem;
+    uint8_t level;
+    uint32_t arg0;
+    uint32_t arg1;
+} __attribute__((packed)) trace_record_t;
+
+extern uint32_t trace_mask;
+extern uint8_t trace_level;
+
+// Запись в кольцо: резервирование слота xadd, без запрета прерываний
+void trace_event(uint8_t subsystem, uint8_t level, uint16_t event, uint32_t arg0, uint32_t arg1);
+
+// Фильтр проверяется до вызова - отключенная подсистема стоит пару сравнений
+#define TRACE_AT(level, sys, ev, a0, a1) \
+    do { \
+        if (((trace_mask >> TRACE_SYS_##sys) & 1) && (level) <= trace_level) \
+            trace_event(TRACE_SYS_##sys, (level), TRACE_##sys##_##ev, (a0), (a1)); \
+    } while (0)
+
+#define TRACE(sys, ev, a0, a1)       TRACE_AT(TRACE_INFO, sys, ev, a0, a1)
+#define TRACE_WARNING(sys, ev, a0, a1) TRACE_AT(TRACE_WARN, sys, ev, a0, a1)
+#define TRACE_VERBOSE(sys, ev, a0, a1) TRACE_AT(TRACE_DEBUG, sys, ev, a0, a1)
+
+// Всего записано событий (номер следующей записи)
+uint32_t trace_count(void);
+// Копия записи с номером seq; 0 - уже перезаписана или еще не сделана
+uint8_t trace_get(uint32_t seq, trace_record_t* record);
+const char* trace_subsystem_name(uint8_t subsystem);
+
+// Выгрузка новых записей с прошлого вызова; возвращает количество.
+// Перед передачей управления ОС - только TRACE_OUT_DEBUGCON: вывод в COM1
+// на 115200 бод добавил бы к загрузке секунды. В COM1 кольцо выгружает
+// страница трассировки консоли отладки
+uint32_t trace_drain(uint8_t targets);
+
+#endif // TRACE_H
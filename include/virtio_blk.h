@@ -0,0 +1,113 @@
+#ifndef VIRTIO_BLK_H
+#define VIRTIO_BLK_H
+
+#include <stdint.h>
+
+// PCI: переходное (legacy + modern) и только modern устройство
+#define VIRTIO_VENDOR_ID        0x1AF4
+#define VIRTIO_BLK_LEGACY_ID    0x1001
+#define VIRTIO_BLK_MODERN_ID    0x1042
+
+// Legacy: регистры в IO BAR0
+#define VIRTIO_LEGACY_DEVICE_FEATURES   0x00
+#define VIRTIO_LEGACY_GUEST_FEATURES    0x04
+#define VIRTIO_LEGACY_QUEUE_PFN         0x08
+#define VIRTIO_LEGACY_QUEUE_SIZE        0x0C
+#define VIRTIO_LEGACY_QUEUE_SELECT      0x0E
+#define VIRTIO_LEGACY_QUEUE_NOTIFY      0x10
+#define VIRTIO_LEGACY_STATUS            0x12
+#define VIRTIO_LEGACY_CONFIG            0x14    // без MSI-X
+#define VIRTIO_LEGACY_ALIGN             4096
+
+// Modern: vendor capabilities указывают на области в BAR
+#define VIRTIO_PCI_CAP_ID       0x09
+#define VIRTIO_PCI_CAP_COMMON   1
+#define VIRTIO_PCI_CAP_NOTIFY   2
+#define VIRTIO_PCI_CAP_DEVICE   4
+
+// Общая конфигурация modern
+#define VIRTIO_COMMON_DFSELECT  0x00
+#define VIRTIO_COMMON_DF        0x04
+#define VIRTIO_COMMON_GFSELECT  0x08
+#define VIRTIO_COMMON_GF        0x0C
+#define VIRTIO_COMMON_STATUS    0x14
+#define VIRTIO_COMMON_Q_SELECT  0x16
+#define VIRTIO_COMMON_Q_SIZE    0x18
+#define VIRTIO_COMMON_Q_ENABLE  0x1C
+#define VIRTIO_COMMON_Q_NOFF    0x1E
+#define VIRTIO_COMMON_Q_DESC    0x20
+#define VIRTIO_COMMON_Q_DRIVER  0x28
+#define VIRTIO_COMMON_Q_DEVICE  0x30
+
+// Статус устройства
+#define VIRTIO_STATUS_ACKNOWLEDGE   0x01
+#define VIRTIO_STATUS_DRIVER        0x02
+#define VIRTIO_STATUS_DRIVER_OK     0x04
+#define VIRTIO_STATUS_FEATURES_OK   0x08
+#define VIRTIO_STATUS_FAILED        0x80
+
+// VIRTIO_F_VERSION_1 - бит 32 (бит 0 второго слова)
+#define VIRTIO_F_VERSION_1_HIGH 0x00000001
+
+// Split virtqueue
+#define VRING_DESC_F_NEXT       1
+#define VRING_DESC_F_WRITE      2
+#define VRING_USED_F_NO_NOTIFY  1
+#define VIRTIO_QUEUE_MAX        256
+
+// Запрос virtio-blk: заголовок, данные, байт статуса - цепочка из 3 дескрипторов
+#define VIRTIO_BLK_T_IN         0
+#define VIRTIO_BLK_S_OK         0
+#define VIRTIO_BLK_DESCS        3
+#define VIRTIO_BLK_REQ_SECTORS  256
+#define VIRTIO_BLK_BATCH        32
+
+#define VIRTIO_BLK_MAX_DISKS    2
+#define VIRTIO_TIMEOUT_MS       1000
+
+typedef struct {
+    uint32_t addr;
+    uint32_t addr_high;
+    uint32_t len;
+    uint16_t flags;
+    uint16_t next;
+} vring_desc_t;
+
+typedef struct {
+    uint16_t flags;
+    uint16_t idx;
+    uint16_t ring[];
+} vring_avail_t;
+
+typedef struct {
+    uint32_t id;
+    uint32_t len;
+} vring_used_elem_t;
+
+typedef struct {
+    uint16_t flags;
+    uint16_t idx;
+    vring_used_elem_t ring[];
+} vring_used_t;
+
+// Раскладка legacy для размера очереди N: дескрипторы (16N), avail (6 + 2N),
+// used - со следующей границы 4 КБ (6 + 8N). При N = 256 - три страницы.
+#define VIRTIO_RING_BYTES       (3 * VIRTIO_LEGACY_ALIGN)
+
+typedef struct {
+    uint32_t type;
+    uint32_t reserved;
+    uint32_t sector;
+    uint32_t sector_high;
+} virtio_blk_req_t;
+
+// Поиск устройств virtio-blk (modern, если есть capabilities, иначе legacy),
+// одна очередь запросов; диски регистрируются в blockdev как "VIRTIO<n>".
+// Чтение пакетами до VIRTIO_BLK_BATCH запросов с одним уведомлением.
+uint8_t virtio_blk_init(void);
+uint8_t virtio_blk_count(void);
+// Перед переходом в реальный режим: сброс устройств и возврат настройки
+// очереди BIOS без DRIVER_OK. Цепная загрузка с virtio-blk запрещена
+void virtio_blk_shutdown(void);
+
+#endif // VIRTIO_BLK_H
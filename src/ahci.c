@@ -0,0 +1,330 @@
+#include "ahci.h"
+#include "blockdev.h"
+#include "pci.h"
+#include "timer.h"
+#include "trace.h"
+#include "kprintf.h"
+
+typedef struct {
+    blockdev_t dev;
+    uint8_t port;
+    uint8_t ncq;
+    uint8_t depth;          // команд в очереди одновременно
+    uint8_t lba48;
+    ahci_port_mem_t* mem;
+    // Настройка порта нижележащим BIOS: его INT 13h работает через эти
+    // списки команд, поэтому перед передачей управления они возвращаются
+    uint32_t saved_clb, saved_clbu;
+    uint32_t saved_fb, saved_fbu;
+    uint32_t saved_ie, saved_cmd;
+} ahci_disk_t;
+
+static volatile uint8_t* abar = 0;
+static uint32_t saved_ghc = 0;
+static uint8_t slots = 1;
+static ahci_disk_t disks[AHCI_MAX_DISKS];
+static uint8_t disk_count = 0;
+
+static ahci_port_mem_t port_mem[AHCI_MAX_DISKS];
+static uint16_t identify_data[256];
+
+static uint32_t hba_read(uint32_t reg) {
+    return *(volatile uint32_t*)(abar + reg);
+}
+
+static void hba_write(uint32_t reg, uint32_t value) {
+    // Таблицы команд должны лечь в память до записи в регистры
+    __asm__ volatile ("" : : : "memory");
+    *(volatile uint32_t*)(abar + reg) = value;
+}
+
+static uint32_t port_read(uint8_t port, uint32_t reg) {
+    return hba_read(AHCI_PORT_BASE + port * AHCI_PORT_SIZE + reg);
+}
+
+static void port_write(uint8_t port, uint32_t reg, uint32_t value) {
+    hba_write(AHCI_PORT_BASE + port * AHCI_PORT_SIZE + reg, value);
+}
+
+// Ждем, пока биты mask в регистре порта не сбросятся
+static uint8_t port_wait_clear(uint8_t port, uint32_t reg, uint32_t mask) {
+    deadline_t deadline = deadline_after_ms(AHCI_TIMEOUT_MS);
+
+    while (port_read(port, reg) & mask) {
+        if (deadline_expired(deadline)) return 0;
+    }
+    return 1;
+}
+
+static void port_stop(uint8_t port) {
+    port_write(port, PX_CMD, port_read(port, PX_CMD) & ~PX_CMD_ST);
+    port_wait_clear(port, PX_CMD, PX_CMD_CR);
+    port_write(port, PX_CMD, port_read(port, PX_CMD) & ~PX_CMD_FRE);
+    port_wait_clear(port, PX_CMD, PX_CMD_FR);
+}
+
+static uint8_t port_start(uint8_t port) {
+    port_write(port, PX_SERR, 0xFFFFFFFF);
+    port_write(port, PX_IS, 0xFFFFFFFF);
+    port_write(port, PX_CMD, port_read(port, PX_CMD) | PX_CMD_FRE);
+
+    // Устройство должно закончить сброс до установки ST
+    if (!port_wait_clear(port, PX_TFD, PX_TFD_BSY | PX_TFD_DRQ)) return 0;
+    port_write(port, PX_CMD, port_read(port, PX_CMD) | PX_CMD_ST);
+    return 1;
+}
+
+// Остановка порта и возврат сохраненной настройки BIOS
+static void port_restore(ahci_disk_t* disk) {
+    uint8_t port = disk->port;
+
+    port_stop(port);
+    port_write(port, PX_CLB, disk->saved_clb);
+    port_write(port, PX_CLBU, disk->saved_clbu);
+    port_write(port, PX_FB, disk->saved_fb);
+    port_write(port, PX_FBU, disk->saved_fbu);
+    port_write(port, PX_IS, 0xFFFFFFFF);
+    port_write(port, PX_IE, disk->saved_ie);
+    if (disk->saved_cmd & PX_CMD_FRE) {
+        port_write(port, PX_CMD, port_read(port, PX_CMD) | PX_CMD_FRE);
+    }
+    if (disk->saved_cmd & PX_CMD_ST) {
+        port_write(port, PX_CMD, port_read(port, PX_CMD) | PX_CMD_ST);
+    }
+}
+
+// Сброс ошибки: перезапуск движка команд порта
+static void port_recover(ahci_disk_t* disk) {
+    TRACE_WARNING(AHCI, ERROR, disk->port, port_read(disk->port, PX_TFD));
+    port_stop(disk->port);
+    port_start(disk->port);
+}
+
+// FIS и PRDT команды в слоте; буфер - физический адрес, выравнивание 2
+static void build_command(ahci_disk_t* disk, uint8_t slot, uint8_t command,
+                          uint32_t lba, uint32_t count, void* buffer, uint32_t bytes) {
+    ahci_cmd_header_t* header = &disk->mem->headers[slot];
+    ahci_cmd_table_t* table = &disk->mem->tables[slot];
+    uint8_t* fis = table->cfis;
+
+    for (int i = 0; i < 16; i++) fis[i] = 0;
+    fis[0] = FIS_TYPE_REG_H2D;
+    fis[1] = FIS_H2D_COMMAND;
+    fis[2] = command;
+    fis[4] = lba & 0xFF;
+    fis[5] = (lba >> 8) & 0xFF;
+    fis[6] = (lba >> 16) & 0xFF;
+    fis[7] = 0x40;                      // LBA
+    fis[8] = (lba >> 24) & 0xFF;
+
+    if (command == AHCI_CMD_READ_FPDMA_QUEUED) {
+        // Счетчик секторов в регистре features, тег - в счетчике
+        fis[3] = count & 0xFF;
+        fis[11] = (count >> 8) & 0xFF;
+        fis[12] = slot << 3;
+    } else if (command == AHCI_CMD_READ_DMA) {
+        fis[7] = 0xE0 | ((lba >> 24) & 0x0F);
+        fis[8] = 0;
+        fis[12] = count & 0xFF;
+    } else {
+        fis[12] = count & 0xFF;
+        fis[13] = (count >> 8) & 0xFF;
+    }
+    if (command == AHCI_CMD_IDENTIFY) fis[7] = 0;
+
+    table->prdt[0].dba = (uint32_t)buffer;
+    table->prdt[0].dbau = 0;
+    table->prdt[0].reserved = 0;
+    table->prdt[0].dbc = bytes - 1;
+
+    header->flags = 5 | (1 << 16);      // CFIS 20 байт, одна запись PRDT
+    header->prdbc = 0;
+    header->ctba = (uint32_t)table;
+    header->ctbau = 0;
+}
+
+// Одна команда без очереди (IDENTIFY, диски без NCQ)
+static uint8_t run_command(ahci_disk_t* disk, uint8_t command,
+                           uint32_t lba, uint32_t count, void* buffer, uint32_t bytes) {
+    deadline_t deadline = deadline_after_ms(AHCI_TIMEOUT_MS);
+
+    build_command(disk, 0, command, lba, count, buffer, bytes);
+    port_write(disk->port, PX_IS, 0xFFFFFFFF);
+    port_write(disk->port, PX_CI, 1);
+
+    while (port_read(disk->port, PX_CI) & 1) {
+        if ((port_read(disk->port, PX_IS) & PX_IS_TFES) || deadline_expired(deadline)) {
+            if (!(port_read(disk->port, PX_IS) & PX_IS_TFES)) TRACE_WARNING(AHCI, TIMEOUT, disk->port, 1);
+            port_recover(disk);
+            return 0;
+        }
+    }
+    if (port_read(disk->port, PX_TFD) & PX_TFD_ERR) {
+        port_recover(disk);
+        return 0;
+    }
+    return 1;
+}
+
+// Глубокая очередь: свободные слоты сразу заполняются следующими кусками,
+// завершение видно по сбросу битов SACT (уведомление Set Device Bits)
+static uint8_t read_queued(ahci_disk_t* disk, uint32_t lba, uint32_t count, uint8_t* dest) {
+    uint8_t port = disk->port;
+    uint32_t busy = 0;
+    deadline_t deadline = deadline_after_ms(AHCI_TIMEOUT_MS);
+
+    port_write(port, PX_IS, 0xFFFFFFFF);
+
+    while (count || busy) {
+        for (uint8_t slot = 0; slot < disk->depth && count; slot++) {
+            uint32_t sectors = count < AHCI_CMD_SECTORS ? count : AHCI_CMD_SECTORS;
+
+            if (busy & (1u << slot)) continue;
+            build_command(disk, slot, AHCI_CMD_READ_FPDMA_QUEUED, lba, sectors,
+                          dest, sectors * BLOCKDEV_SECTOR_SIZE);
+            port_write(port, PX_SACT, 1u << slot);
+            port_write(port, PX_CI, 1u << slot);
+            busy |= 1u << slot;
+            lba += sectors;
+            dest += sectors * BLOCKDEV_SECTOR_SIZE;
+            count -= sectors;
+        }
+
+        if (port_read(port, PX_IS) & PX_IS_TFES) {
+            port_recover(disk);
+            return 0;
+        }
+
+        uint32_t pending = busy & (port_read(port, PX_SACT) | port_read(port, PX_CI));
+        if (pending != busy) {
+            busy = pending;
+            deadline = deadline_after_ms(AHCI_TIMEOUT_MS);
+        } else if (deadline_expired(deadline)) {
+            TRACE_WARNING(AHCI, TIMEOUT, port, busy);
+            port_recover(disk);
+            return 0;
+        }
+    }
+    return 1;
+}
+
+static uint8_t disk_read(blockdev_t* dev, uint32_t lba, uint32_t count, void* buffer) {
+    ahci_disk_t* disk = &disks[dev->unit];
+    uint8_t* dest = (uint8_t*)buffer;
+
+    // PRDT требует четного адреса
+    if ((uint32_t)buffer & 1) return 0;
+
+    TRACE(AHCI, READ, lba, count);
+    if (disk->ncq) return read_queued(disk, lba, count, dest);
+
+    while (count) {
+        uint32_t sectors = count < AHCI_CMD_SECTORS ? count : AHCI_CMD_SECTORS;
+
+        if (!run_command(disk, disk->lba48 ? AHCI_CMD_READ_DMA_EXT : AHCI_CMD_READ_DMA,
+                         lba, sectors, dest, sectors * BLOCKDEV_SECTOR_SIZE)) {
+            return 0;
+        }
+        lba += sectors;
+        dest += sectors * BLOCKDEV_SECTOR_SIZE;
+        count -= sectors;
+    }
+    return 1;
+}
+
+static void probe_port(uint8_t port) {
+    uint32_t ssts = port_read(port, PX_SSTS);
+    ahci_disk_t* disk = &disks[disk_count];
+
+    if ((ssts & 0x0F) != PX_SSTS_DET_PRESENT || ((ssts >> 8) & 0x0F) != PX_SSTS_IPM_ACTIVE) return;
+    if (port_read(port, PX_SIG) != AHCI_SIG_ATA) return;
+
+    disk->port = port;
+    disk->mem = &port_mem[disk_count];
+    disk->saved_clb = port_read(port, PX_CLB);
+    disk->saved_clbu = port_read(port, PX_CLBU);
+    disk->saved_fb = port_read(port, PX_FB);
+    disk->saved_fbu = port_read(port, PX_FBU);
+    disk->saved_ie = port_read(port, PX_IE);
+    disk->saved_cmd = port_read(port, PX_CMD);
+
+    port_stop(port);
+    port_write(port, PX_CLB, (uint32_t)disk->mem->headers);
+    port_write(port, PX_CLBU, 0);
+    port_write(port, PX_FB, (uint32_t)disk->mem->fis);
+    port_write(port, PX_FBU, 0);
+    port_write(port, PX_IE, 0);
+    // Без остановки порта при ошибке следующий порт получит тот же
+    // port_mem, и оба будут писать в один список команд
+    if (!port_start(port) ||
+        !run_command(disk, AHCI_CMD_IDENTIFY, 0, 0, identify_data, sizeof(identify_data))) {
+        port_restore(disk);
+        return;
+    }
+
+    // Слово 83 бит 10 - LBA48; слово 76 бит 8 - NCQ, слово 75 - глубина очереди - 1
+    disk->lba48 = (identify_data[83] >> 10) & 1;
+    disk->ncq = (hba_read(AHCI_CAP) & AHCI_CAP_SNCQ) && (identify_data[76] & 0x0100);
+    disk->depth = 1;
+    if (disk->ncq) {
+        disk->depth = (identify_data[75] & 0x1F) + 1;
+        if (disk->depth > slots) disk->depth = slots;
+    }
+
+    // Счетчик blockdev 32-битный: большие диски видны до 2 ТБ
+    disk->dev.sectors = identify_data[60] | ((uint32_t)identify_data[61] << 16);
+    if (disk->lba48 && (identify_data[102] || identify_data[103])) {
+        disk->dev.sectors = 0xFFFFFFFF;
+    } else if (disk->lba48) {
+        disk->dev.sectors = identify_data[100] | ((uint32_t)identify_data[101] << 16);
+    }
+
+    ksnprintf(disk->dev.name, sizeof(disk->dev.name), "AHCI%u", port);
+    disk->dev.type = BLOCKDEV_AHCI;
+    disk->dev.unit = disk_count;
+    disk->dev.read = disk_read;
+
+    TRACE(AHCI, FOUND, port, disk->dev.sectors);
+    if (blockdev_register(&disk->dev)) {
+        disk_count++;
+    } else {
+        port_restore(disk);
+    }
+}
+
+uint8_t ahci_init(void) {
+    const pci_device_t* dev = 0;
+
+    for (uint8_t i = 0; (dev = pci_find_class(AHCI_PCI_CLASS, AHCI_PCI_SUBCLASS, i)) != 0; i++) {
+        if (dev->prog_if == AHCI_PCI_PROG_IF) break;
+    }
+    if (!dev) return 0;
+
+    abar = (volatile uint8_t*)pci_bar(dev, AHCI_ABAR);
+    if (!abar) return 0;
+    pci_enable(dev, PCI_COMMAND_MEMORY | PCI_COMMAND_MASTER);
+
+    // Режим AHCI, без прерываний - завершение команд опрашивается
+    saved_ghc = hba_read(AHCI_GHC);
+    hba_write(AHCI_GHC, (hba_read(AHCI_GHC) | AHCI_GHC_AE) & ~AHCI_GHC_IE);
+    slots = ((hba_read(AHCI_CAP) >> 8) & 0x1F) + 1;
+
+    uint32_t implemented = hba_read(AHCI_PI);
+    for (uint8_t port = 0; port < 32 && disk_count < AHCI_MAX_DISKS; port++) {
+        if (implemented & (1u << port)) probe_port(port);
+    }
+    return disk_count;
+}
+
+void ahci_shutdown(void) {
+    if (!abar) return;
+
+    for (uint8_t i = 0; i < disk_count; i++) {
+        port_restore(&disks[i]);
+    }
+    hba_write(AHCI_GHC, (hba_read(AHCI_GHC) & ~AHCI_GHC_IE) | (saved_ghc & AHCI_GHC_IE));
+}
+
+uint8_t ahci_disk_count(void) {
+    return disk_count;
+}
@@ -0,0 +1,747 @@
+#include "ata.h"
+#include "blockdev.h"
+#include "cpu.h"
+#include "timer.h"
+#include "trace.h"
+#include "kprintf.h"
+#include "pci.h"
+#include "interrupts.h"
+#include "efficiency.h"
+#include "ports.h"
+#include "memmap.h"
+
+// Состояние канала при поиске дисков
+#define PROBE_DONE          0
+#define PROBE_WAIT          1   // IDENTIFY отправлен, ждем DRQ или ошибку
+
+typedef struct {
+    uint16_t io;
+    uint16_t control;
+    uint8_t irq;
+    uint8_t probe_state;
+    uint8_t probe_slave;        // позиция, которой отправлен IDENTIFY
+    // Bus master DMA
+    uint16_t bm_base;
+    volatile uint8_t dma_irq;
+    uint8_t dma_irq_installed;
+} ata_channel_t;
+
+typedef struct {
+    uint8_t present;
+    uint8_t atapi;
+    uint8_t dma_enabled;
+    uint16_t multiple;
+    uint32_t total_sectors;
+    uint16_t identify_data[256];
+    ata_identify_t info;
+    blockdev_t dev;
+} ata_drive_t;
+
+static ata_channel_t channels[ATA_CHANNELS] = {
+    {ATA_PRIMARY_IO, ATA_PRIMARY_CTL, ATA_PRIMARY_IRQ, PROBE_DONE, 0, 0, 0, 0},
+    {ATA_SECONDARY_IO, ATA_SECONDARY_CTL, ATA_SECONDARY_IRQ, PROBE_DONE, 0, 0, 0, 0},
+};
+static ata_drive_t drives[ATA_MAX_DRIVES];
+static uint8_t drive_count = 0;
+
+// Таблица PRD на канал: 64 байта с выравниванием 64 - не пересекает границу 64 КБ
+static ata_prd_t prd_tables[ATA_CHANNELS][PRD_MAX_ENTRIES] __attribute__((aligned(64)));
+
+static const char* positions[ATA_MAX_DRIVES] = {
+    "Primary master", "Primary slave", "Secondary master", "Secondary slave"
+};
+
+static uint8_t disk_read(blockdev_t* dev, uint32_t lba, uint32_t count, void* buffer);
+
+static ata_channel_t* channel_of(uint8_t drive) {
+    return &channels[drive / 2];
+}
+
+// Блок DRQ одной строковой командой вместо цикла вызовов inw
+static inline void ata_insw(uint16_t port, uint16_t* buffer, uint32_t words) {
+    __asm__ volatile ("cld; rep insw"
+                      : "+D" (buffer), "+c" (words)
+                      : "d" (port)
+                      : "memory");
+}
+
+static inline void ata_outsw(uint16_t port, const uint16_t* buffer, uint32_t words) {
+    __asm__ volatile ("cld; rep outsw"
+                      : "+S" (buffer), "+c" (words)
+                      : "d" (port)
+                      : "memory");
+}
+
+// 400 нс после выбора диска или команды: статус еще старый
+static void ata_delay(ata_channel_t* channel) {
+    for (int i = 0; i < 4; i++) inb(channel->control);
+}
+
+// Ждем снятия BSY, затем одного из битов ready (или ошибки); возвращает статус
+static uint8_t ata_wait(ata_channel_t* channel, uint8_t ready) {
+    uint8_t status;
+    deadline_t deadline = deadline_after_ms(ATA_TIMEOUT_MS);
+
+    do {
+        status = inb(channel->io + ATA_REG_STATUS);
+    } while ((status & ATA_SR_BSY) && !deadline_expired(deadline));
+    if (status & ATA_SR_BSY) {
+        TRACE_WARNING(IDE, TIMEOUT, 0, status);
+        return status;
+    }
+
+    deadline = deadline_after_ms(ATA_TIMEOUT_MS);
+    while (!(status & (ready | ATA_SR_ERR | ATA_SR_DF)) && !deadline_expired(deadline)) {
+        status = inb(channel->io + ATA_REG_STATUS);
+    }
+    if (!(status & (ready | ATA_SR_ERR | ATA_SR_DF))) TRACE_WARNING(IDE, TIMEOUT, 1, status);
+    return status;
+}
+
+static uint8_t ata_failed(uint8_t status, uint8_t ready) {
+    return (status & (ATA_SR_BSY | ATA_SR_ERR | ATA_SR_DF)) || !(status & ready);
+}
+
+static void ata_select(uint8_t drive, uint32_t lba) {
+    ata_channel_t* channel = channel_of(drive);
+
+    outb(channel->io + ATA_REG_DRIVE_HEAD, 0xE0 | ((drive & 1) << 4) | ((lba >> 24) & 0x0F));
+    ata_delay(channel);
+}
+
+static void ata_command(uint8_t drive, uint32_t lba, uint32_t count, uint8_t command) {
+    ata_channel_t* channel = channel_of(drive);
+
+    ata_select(drive, lba);
+    outb(channel->io + ATA_REG_SECTOR_COUNT, count & 0xFF);   // 256 -> 0
+    outb(channel->io + ATA_REG_LBA_LOW, lba & 0xFF);
+    outb(channel->io + ATA_REG_LBA_MID, (lba >> 8) & 0xFF);
+    outb(channel->io + ATA_REG_LBA_HIGH, (lba >> 16) & 0xFF);
+    outb(channel->io + ATA_REG_COMMAND, command);
+    ata_delay(channel);
+}
+
+// LBA48: регистры - двухбайтовые FIFO, сначала старшие байты
+static void ata_command_ext(uint8_t drive, uint32_t lba, uint32_t count, uint8_t command) {
+    ata_channel_t* channel = channel_of(drive);
+
+    outb(channel->io + ATA_REG_DRIVE_HEAD, 0x40 | ((drive & 1) << 4));
+    ata_delay(channel);
+    outb(channel->io + ATA_REG_SECTOR_COUNT, (count >> 8) & 0xFF);
+    outb(channel->io + ATA_REG_LBA_LOW, (lba >> 24) & 0xFF);
+    outb(channel->io + ATA_REG_LBA_MID, 0);
+    outb(channel->io + ATA_REG_LBA_HIGH, 0);
+    outb(channel->io + ATA_REG_SECTOR_COUNT, count & 0xFF);
+    outb(channel->io + ATA_REG_LBA_LOW, lba & 0xFF);
+    outb(channel->io + ATA_REG_LBA_MID, (lba >> 8) & 0xFF);
+    outb(channel->io + ATA_REG_LBA_HIGH, (lba >> 16) & 0xFF);
+    outb(channel->io + ATA_REG_COMMAND, command);
+    ata_delay(channel);
+}
+
+// Адрес за границей LBA28 (lba + count без переполнения)
+static uint8_t needs_lba48(uint32_t lba, uint32_t count) {
+    return lba > ATA_LBA28_LIMIT - count;
+}
+
+// Старший установленный бит в маске режимов
+static uint8_t highest_mode(uint16_t modes, uint8_t count) {
+    for (int mode = count - 1; mode >= 0; mode--) {
+        if (modes & (1 << mode)) return mode;
+    }
+    return ATA_MODE_NONE;
+}
+
+static void parse_identify(uint8_t index) {
+    ata_drive_t* drive = &drives[index];
+    ata_identify_t* info = &drive->info;
+    uint16_t* identify_data = drive->identify_data;
+
+    // Модель - ASCII, в каждом слове сначала старший байт
+    for (int i = 0; i < 20; i++) {
+        info->model[i * 2] = identify_data[27 + i] >> 8;
+        info->model[i * 2 + 1] = identify_data[27 + i] & 0xFF;
+    }
+    info->model[40] = 0;
+    for (int i = 39; i >= 0 && (info->model[i] == ' ' || info->model[i] == 0); i--) {
+        info->model[i] = 0;
+    }
+
+    info->lba48 = (identify_data[83] & 0x0400) ? 1 : 0;
+    info->max_multiple = identify_data[47] & 0xFF;
+    if (info->lba48) {
+        info->sectors = identify_data[100] | ((uint32_t)identify_data[101] << 16) |
+                        ((uint64_t)(identify_data[102] | ((uint32_t)identify_data[103] << 16)) << 32);
+    } else {
+        info->sectors = identify_data[60] | ((uint32_t)identify_data[61] << 16);
+    }
+
+    // Слово 53: бит 1 - слова 64-70 действительны, бит 2 - слово 88
+    info->pio_mode = (identify_data[51] >> 8) > 2 ? 2 : (identify_data[51] >> 8);
+    if (identify_data[53] & 0x0002) {
+        uint8_t advanced = highest_mode(identify_data[64] & 0x03, 2);
+        if (advanced != ATA_MODE_NONE) info->pio_mode = 3 + advanced;
+    }
+    info->mdma_mode = highest_mode(identify_data[63] & 0x07, 3);
+    info->udma_mode = (identify_data[53] & 0x0004) ? highest_mode(identify_data[88] & 0x7F, 7) : ATA_MODE_NONE;
+
+    drive->total_sectors = (info->sectors >> 32) ? 0xFFFFFFFF : (uint32_t)info->sectors;
+
+    TRACE(IDE, IDENTIFY, (uint32_t)info->sectors,
+          ((uint32_t)index << 24) | ((uint32_t)info->lba48 << 16) | ((uint32_t)info->udma_mode << 8) | info->pio_mode);
+}
+
+// ==================== ПОИСК ДИСКОВ ====================
+
+// Выбор позиции и IDENTIFY без ожидания; 0 - на позиции никого нет
+static uint8_t probe_start(uint8_t index) {
+    ata_channel_t* channel = channel_of(index);
+
+    ata_select(index, 0);
+    // Плавающая шина читается как 0xFF
+    if (inb(channel->io + ATA_REG_STATUS) == 0xFF) return 0;
+
+    outb(channel->io + ATA_REG_SECTOR_COUNT, 0);
+    outb(channel->io + ATA_REG_LBA_LOW, 0);
+    outb(channel->io + ATA_REG_LBA_MID, 0);
+    outb(channel->io + ATA_REG_LBA_HIGH, 0);
+    outb(channel->io + ATA_REG_COMMAND, ATA_CMD_IDENTIFY);
+    ata_delay(channel);
+    return inb(channel->io + ATA_REG_STATUS) != 0;
+}
+
+// Следующая позиция канала: ведущий, затем ведомый
+static void probe_next(uint8_t c) {
+    ata_channel_t* channel = &channels[c];
+
+    while (channel->probe_slave < 2) {
+        if (probe_start(c * 2 + channel->probe_slave)) {
+            channel->probe_state = PROBE_WAIT;
+            return;
+        }
+        channel->probe_slave++;
+    }
+    channel->probe_state = PROBE_DONE;
+}
+
+// Один опрос статуса канала без ожидания; 1 - позиция завершена
+static uint8_t probe_poll(uint8_t c) {
+    ata_channel_t* channel = &channels[c];
+    ata_drive_t* drive = &drives[c * 2 + channel->probe_slave];
+    uint8_t status = inb(channel->io + ATA_REG_STATUS);
+
+    if (status & ATA_SR_BSY) return 0;
+
+    // ATAPI отвечает ошибкой и сигнатурой в LBA_MID/HIGH
+    if (status & (ATA_SR_ERR | ATA_SR_DF)) {
+        drive->atapi = inb(channel->io + ATA_REG_LBA_MID) == ATAPI_SIGNATURE_MID &&
+                       inb(channel->io + ATA_REG_LBA_HIGH) == ATAPI_SIGNATURE_HIGH;
+        return 1;
+    }
+    if (!(status & ATA_SR_DRQ)) return 0;
+
+    ata_insw(channel->io + ATA_REG_DATA, drive->identify_data, 256);
+    drive->present = 1;
+    return 1;
+}
+
+// IDENTIFY уходит на оба канала сразу; пока один диск думает, второй канал
+// уже отвечает. Худший случай - самый медленный диск, а не сумма таймаутов
+static void probe_all(void) {
+    deadline_t deadline = deadline_after_ms(ATA_PROBE_TIMEOUT_MS);
+    uint64_t start = cpu_read_tsc();
+    uint8_t pending;
+    uint32_t found = 0;
+
+    for (uint8_t c = 0; c < ATA_CHANNELS; c++) {
+        channels[c].probe_slave = 0;
+        probe_next(c);
+    }
+
+    do {
+        pending = 0;
+        for (uint8_t c = 0; c < ATA_CHANNELS; c++) {
+            if (channels[c].probe_state != PROBE_WAIT) continue;
+            if (probe_poll(c)) {
+                channels[c].probe_slave++;
+                probe_next(c);
+            }
+            if (channels[c].probe_state == PROBE_WAIT) pending = 1;
+        }
+    } while (pending && !deadline_expired(deadline));
+
+    for (uint8_t c = 0; c < ATA_CHANNELS; c++) {
+        if (channels[c].probe_state == PROBE_WAIT) {
+            TRACE_WARNING(IDE, TIMEOUT, 2, c * 2 + channels[c].probe_slave);
+            channels[c].probe_state = PROBE_DONE;
+        }
+    }
+    for (uint8_t i = 0; i < ATA_MAX_DRIVES; i++) {
+        if (drives[i].present) found |= 1 << i;
+        if (drives[i].atapi) found |= 0x10 << i;
+    }
+    TRACE(IDE, PROBE, found, timer_cycles_to_us(cpu_read_tsc() - start));
+}
+
+// ==================== BUS MASTER DMA ====================
+
+// Чтение статуса снимает запрос прерывания диска
+static void ata_irq(ata_channel_t* channel) {
+    if (inb(channel->bm_base + BM_STATUS) & BM_SR_IRQ) channel->dma_irq = 1;
+    inb(channel->io + ATA_REG_STATUS);
+}
+
+static void ata_irq_primary(void) {
+    ata_irq(&channels[0]);
+}
+
+static void ata_irq_secondary(void) {
+    ata_irq(&channels[1]);
+}
+
+static void dma_init(void) {
+    const pci_device_t* dev = pci_find_class(ATA_PCI_CLASS, ATA_PCI_SUBCLASS, 0);
+    uint16_t bm_base;
+
+    if (!dev || !(dev->prog_if & ATA_PROG_IF_BUSMASTER) || !interrupts_active()) return;
+
+    bm_base = pci_bar(dev, ATA_BM_BAR);
+    if (!bm_base) return;
+    pci_enable(dev, PCI_COMMAND_IO | PCI_COMMAND_MASTER);
+
+    for (uint8_t i = 0; i < ATA_MAX_DRIVES; i++) {
+        ata_channel_t* channel = channel_of(i);
+
+        // Слово 49, бит 8 - диск поддерживает DMA
+        if (!drives[i].present || !(drives[i].identify_data[49] & 0x0100)) continue;
+
+        if (!channel->dma_irq_installed) {
+            channel->bm_base = bm_base + (i / 2) * BM_CHANNEL_STRIDE;
+            outb(channel->bm_base + BM_COMMAND, 0);
+            outb(channel->bm_base + BM_STATUS, BM_SR_ERROR | BM_SR_IRQ);
+            irq_install(channel->irq, i / 2 ? ata_irq_secondary : ata_irq_primary);
+            outb(channel->control, 0);
+            channel->dma_irq_installed = 1;
+            TRACE(IDE, DMA, channel->bm_base, channel->irq);
+        }
+
+        // Биты "диск умеет DMA" только для BIOS/ОС, на обмен не влияют
+        outb(channel->bm_base + BM_STATUS, inb(channel->bm_base + BM_STATUS) |
+             ((i & 1) ? BM_SR_DRIVE1_DMA : BM_SR_DRIVE0_DMA));
+        drives[i].dma_enabled = 1;
+    }
+}
+
+// Буфер режется на области по границам 64 КБ
+static uint8_t dma_build_prd(ata_prd_t* prd_table, void* buffer, uint32_t bytes) {
+    uint32_t address = (uint32_t)buffer;
+    uint32_t entry = 0;
+
+    while (bytes) {
+        uint32_t chunk = PRD_BOUNDARY - (address & (PRD_BOUNDARY - 1));
+
+        if (entry == PRD_MAX_ENTRIES) return 0;
+        if (chunk > bytes) chunk = bytes;
+
+        prd_table[entry].address = address;
+        prd_table[entry].bytes = chunk & 0xFFFF;    // 64 КБ -> 0
+        prd_table[entry].flags = 0;
+        address += chunk;
+        bytes -= chunk;
+        entry++;
+    }
+
+    prd_table[entry - 1].flags = PRD_EOT;
+    return 1;
+}
+
+// Процессор спит до IRQ канала; тик таймера будит для проверки таймаута
+static uint8_t dma_wait(ata_channel_t* channel) {
+    deadline_t deadline = deadline_after_ms(ATA_DMA_TIMEOUT_MS);
+
+    while (!channel->dma_irq && !deadline_expired(deadline)) {
+        __asm__ volatile ("cli");
+        if (!channel->dma_irq) {
+            power_idle();
+        } else {
+            __asm__ volatile ("sti");
+        }
+    }
+    return channel->dma_irq;
+}
+
+static uint8_t read_dma(uint8_t drive, uint32_t lba, uint32_t count, uint16_t* buffer) {
+    ata_channel_t* channel = channel_of(drive);
+    ata_prd_t* prd_table = prd_tables[drive / 2];
+    uint16_t bm_base = channel->bm_base;
+    uint8_t status, bm_status;
+
+    ata_select(drive, lba);
+    status = ata_wait(channel, ATA_SR_DRDY);
+    if (ata_failed(status, ATA_SR_DRDY) || !dma_build_prd(prd_table, buffer, count * ATA_SECTOR_SIZE)) {
+        TRACE_WARNING(IDE, DMA_ERROR, lba, status);
+        return 0;
+    }
+
+    outb(bm_base + BM_COMMAND, 0);
+    outl(bm_base + BM_PRDT, (uint32_t)prd_table);
+    outb(bm_base + BM_STATUS, inb(bm_base + BM_STATUS) | BM_SR_ERROR | BM_SR_IRQ);
+    outb(bm_base + BM_COMMAND, BM_CMD_READ);
+
+    channel->dma_irq = 0;
+    if (needs_lba48(lba, count)) {
+        ata_command_ext(drive, lba, count, ATA_CMD_READ_DMA_EXT);
+    } else {
+        ata_command(drive, lba, count, ATA_CMD_READ_DMA);
+    }
+    outb(bm_base + BM_COMMAND, BM_CMD_READ | BM_CMD_START);
+
+    uint8_t completed = dma_wait(channel);
+
+    outb(bm_base + BM_COMMAND, 0);
+    bm_status = inb(bm_base + BM_STATUS);
+    status = inb(channel->io + ATA_REG_STATUS);
+    outb(bm_base + BM_STATUS, bm_status | BM_SR_ERROR | BM_SR_IRQ);
+
+    if (!completed || (bm_status & BM_SR_ERROR) || (status & (ATA_SR_BSY | ATA_SR_ERR | ATA_SR_DF))) {
+        TRACE_WARNING(IDE, DMA_ERROR, lba, (bm_status << 8) | status);
+        return 0;
+    }
+
+    TRACE(IDE, READ_DONE, lba, status);
+    return 1;
+}
+
+uint8_t ata_init(void) {
+    drive_count = 0;
+    for (uint8_t c = 0; c < ATA_CHANNELS; c++) {
+        outb(channels[c].control, ATA_CTL_NIEN);
+    }
+
+    probe_all();
+
+    for (uint8_t i = 0; i < ATA_MAX_DRIVES; i++) {
+        ata_drive_t* drive = &drives[i];
+        ata_channel_t* channel = channel_of(i);
+
+        if (!drive->present) continue;
+        parse_identify(i);
+
+        // Максимум секторов на блок DRQ для READ/WRITE MULTIPLE
+        if (drive->info.max_multiple) {
+            ata_command(i, 0, drive->info.max_multiple, ATA_CMD_SET_MULTIPLE);
+            uint8_t status = ata_wait(channel, ATA_SR_DRDY);
+            if (!ata_failed(status, ATA_SR_DRDY)) drive->multiple = drive->info.max_multiple;
+        }
+    }
+
+    dma_init();
+
+    for (uint8_t i = 0; i < ATA_MAX_DRIVES; i++) {
+        ata_drive_t* drive = &drives[i];
+
+        if (!drive->present) continue;
+        ksnprintf(drive->dev.name, sizeof(drive->dev.name), "IDE%u", i);
+        drive->dev.type = BLOCKDEV_ATA;
+        drive->dev.unit = i;
+        drive->dev.sectors = drive->total_sectors;
+        drive->dev.read = disk_read;
+        if (blockdev_register(&drive->dev)) drive_count++;
+    }
+    return drive_count;
+}
+
+uint8_t ata_present(void) {
+    return drive_count != 0;
+}
+
+uint8_t ata_drive_present(uint8_t drive) {
+    return drive < ATA_MAX_DRIVES && drives[drive].present;
+}
+
+uint8_t ata_drive_atapi(uint8_t drive) {
+    return drive < ATA_MAX_DRIVES && drives[drive].atapi;
+}
+
+uint8_t ata_dma_available(uint8_t drive) {
+    return ata_drive_present(drive) && drives[drive].dma_enabled;
+}
+
+uint16_t ata_multiple_sectors(uint8_t drive) {
+    return ata_drive_present(drive) ? drives[drive].multiple : 0;
+}
+
+uint32_t ata_total_sectors(uint8_t drive) {
+    return ata_drive_present(drive) ? drives[drive].total_sectors : 0;
+}
+
+const ata_identify_t* ata_identify(uint8_t drive) {
+    return ata_drive_present(drive) ? &drives[drive].info : 0;
+}
+
+const char* ata_drive_position(uint8_t drive) {
+    return drive < ATA_MAX_DRIVES ? positions[drive] : "";
+}
+
+// Одна команда PIO, не больше ATA_MAX_SECTORS секторов
+static uint8_t read_pio(uint8_t drive, uint32_t lba, uint32_t count, uint16_t* buffer) {
+    ata_channel_t* channel = channel_of(drive);
+    uint16_t multiple = drives[drive].multiple;
+    uint32_t block = multiple ? multiple : 1;
+    uint8_t status;
+
+    ata_select(drive, lba);
+    status = ata_wait(channel, ATA_SR_DRDY);
+    if (ata_failed(status, ATA_SR_DRDY)) {
+        TRACE_WARNING(IDE, READ_ERROR, lba, status);
+        return 0;
+    }
+
+    if (needs_lba48(lba, count)) {
+        ata_command_ext(drive, lba, count, multiple ? ATA_CMD_READ_MULTIPLE_EXT : ATA_CMD_READ_EXT);
+    } else {
+        ata_command(drive, lba, count, multiple ? ATA_CMD_READ_MULTIPLE : ATA_CMD_READ);
+    }
+
+    while (count) {
+        uint32_t sectors = count < block ? count : block;
+
+        status = ata_wait(channel, ATA_SR_DRQ);
+        if (ata_failed(status, ATA_SR_DRQ)) {
+            TRACE_WARNING(IDE, READ_ERROR, lba, status);
+            return 0;
+        }
+
+        ata_insw(channel->io + ATA_REG_DATA, buffer, sectors * (ATA_SECTOR_SIZE / 2));
+        buffer += sectors * (ATA_SECTOR_SIZE / 2);
+        count -= sectors;
+        ata_delay(channel);
+    }
+
+    TRACE(IDE, READ_DONE, lba, status);
+    return 1;
+}
+
+uint8_t ata_read_sectors(uint8_t drive, uint32_t lba, uint32_t count, void* buffer) {
+    uint16_t* dest = (uint16_t*)buffer;
+
+    if (!ata_drive_present(drive)) return 0;
+
+    TRACE(IDE, READ, lba, count);
+    while (count) {
+        uint32_t chunk = count < ATA_MAX_SECTORS ? count : ATA_MAX_SECTORS;
+        uint8_t done = 0;
+
+        // Без LBA48 сектора за 128 ГБ недоступны
+        if (needs_lba48(lba, chunk) && !drives[drive].info.lba48) {
+            TRACE_WARNING(IDE, READ_ERROR, lba, 0);
+            return 0;
+        }
+
+        // DMA требует четного адреса буфера; после сбоя DMA диск остается на PIO
+        if (drives[drive].dma_enabled && !((uint32_t)dest & 1)) {
+            done = read_dma(drive, lba, chunk, dest);
+            if (!done) drives[drive].dma_enabled = 0;
+        }
+        if (!done && !read_pio(drive, lba, chunk, dest)) return 0;
+        lba += chunk;
+        dest += chunk * (ATA_SECTOR_SIZE / 2);
+        count -= chunk;
+    }
+    return 1;
+}
+
+static uint8_t disk_read(blockdev_t* dev, uint32_t lba, uint32_t count, void* buffer) {
+    return ata_read_sectors(dev->unit, lba, count, buffer);
+}
+
+// ==================== ATAPI ====================
+
+// Ожидание снятия BSY с долгим сроком: привод может раскручивать диск
+static uint8_t atapi_wait(ata_channel_t* channel) {
+    deadline_t deadline = deadline_after_ms(ATAPI_TIMEOUT_MS);
+    uint8_t status;
+
+    do {
+        status = inb(channel->io + ATA_REG_STATUS);
+    } while ((status & ATA_SR_BSY) && !deadline_expired(deadline));
+    if (status & ATA_SR_BSY) TRACE_WARNING(IDE, TIMEOUT, 0, status);
+    return status;
+}
+
+// Команда PACKET без повторов. Данные приходят блоками DRQ, размер блока
+// устройство сообщает в LBA_MID/HIGH; команда закончена, когда DRQ снят.
+// Возвращает число принятых байт, 0 - ошибка (в том числе лишние данные)
+static uint32_t atapi_packet_once(uint8_t drive, const uint8_t* packet, void* buffer, uint32_t bytes) {
+    ata_channel_t* channel = channel_of(drive);
+    uint16_t* dest = (uint16_t*)buffer;
+    uint32_t received = 0;
+    uint8_t status;
+
+    outb(channel->io + ATA_REG_DRIVE_HEAD, 0xA0 | ((drive & 1) << 4));
+    ata_delay(channel);
+    if (atapi_wait(channel) & ATA_SR_BSY) return 0;
+
+    outb(channel->io + ATA_REG_ERROR, 0);       // Features: PIO, без DMA
+    outb(channel->io + ATA_REG_LBA_MID, ATAPI_BYTE_LIMIT & 0xFF);
+    outb(channel->io + ATA_REG_LBA_HIGH, ATAPI_BYTE_LIMIT >> 8);
+    outb(channel->io + ATA_REG_COMMAND, ATA_CMD_PACKET);
+    ata_delay(channel);
+
+    status = atapi_wait(channel);
+    if (ata_failed(status, ATA_SR_DRQ)) goto failed;
+    ata_outsw(channel->io + ATA_REG_DATA, (const uint16_t*)packet, ATAPI_PACKET_SIZE / 2);
+
+    while (1) {
+        uint32_t block;
+
+        ata_delay(channel);
+        status = atapi_wait(channel);
+        if (status & (ATA_SR_BSY | ATA_SR_ERR | ATA_SR_DF)) goto failed;
+        if (!(status & ATA_SR_DRQ)) break;
+
+        block = inb(channel->io + ATA_REG_LBA_MID) | (inb(channel->io + ATA_REG_LBA_HIGH) << 8);
+        if (!block || block > bytes - received) goto failed;
+        ata_insw(channel->io + ATA_REG_DATA, dest, (block + 1) / 2);
+        dest += block / 2;
+        received += block;
+    }
+
+    TRACE(IDE, PACKET, (drive << 8) | packet[0], received);
+    return received;
+
+failed:
+    TRACE_WARNING(IDE, PACKET_ERROR, (drive << 8) | packet[0],
+                  (inb(channel->io + ATA_REG_ERROR) << 8) | status);
+    return 0;
+}
+
+// Ошибка после смены носителя или сброса (UNIT ATTENTION) снимается
+// чтением REQUEST SENSE; затем команда повторяется
+static uint32_t atapi_packet(uint8_t drive, const uint8_t* packet, void* buffer, uint32_t bytes) {
+    static const uint8_t sense_packet[ATAPI_PACKET_SIZE] = {ATAPI_CMD_REQUEST_SENSE, 0, 0, 0, ATAPI_SENSE_BYTES};
+    uint8_t sense[ATAPI_SENSE_BYTES + 2] __attribute__((aligned(2)));
+
+    for (int attempt = 0; attempt < ATAPI_RETRIES; attempt++) {
+        uint32_t received = atapi_packet_once(drive, packet, buffer, bytes);
+
+        if (received) return received;
+        atapi_packet_once(drive, sense_packet, sense, sizeof(sense));
+    }
+    return 0;
+}
+
+uint8_t atapi_read_capacity(uint8_t drive, uint32_t* sectors, uint32_t* block_size) {
+    uint8_t packet[ATAPI_PACKET_SIZE] __attribute__((aligned(2))) = {ATAPI_CMD_READ_CAPACITY};
+    uint8_t data[8] __attribute__((aligned(2)));
+
+    if (!ata_drive_atapi(drive) || atapi_packet(drive, packet, data, sizeof(data)) != sizeof(data)) return 0;
+
+    // Ответ big-endian: последний LBA и размер блока
+    *sectors = ((data[0] << 24) | (data[1] << 16) | (data[2] << 8) | data[3]) + 1;
+    *block_size = (data[4] << 24) | (data[5] << 16) | (data[6] << 8) | data[7];
+    return 1;
+}
+
+uint8_t atapi_read_sectors(uint8_t drive, uint32_t lba, uint32_t count, void* buffer) {
+    uint8_t packet[ATAPI_PACKET_SIZE] __attribute__((aligned(2))) = {ATAPI_CMD_READ_10};
+
+    if (!ata_drive_atapi(drive) || !count || count > ATAPI_MAX_SECTORS) return 0;
+
+    packet[2] = lba >> 24;
+    packet[3] = lba >> 16;
+    packet[4] = lba >> 8;
+    packet[5] = lba;
+    packet[7] = count >> 8;
+    packet[8] = count;
+    return atapi_packet(drive, packet, buffer, count * ATAPI_SECTOR_SIZE) == count * ATAPI_SECTOR_SIZE;
+}
+
+// ==================== БЕНЧМАРК ====================
+
+// Прежний путь: READ SECTORS на каждый сектор и inw на каждое слово
+static uint8_t read_sector_by_words(uint8_t drive, uint32_t lba, uint16_t* buffer) {
+    ata_channel_t* channel = channel_of(drive);
+
+    ata_select(drive, lba);
+    ata_wait(channel, ATA_SR_DRDY);
+    ata_command(drive, lba, 1, ATA_CMD_READ);
+
+    uint8_t status = ata_wait(channel, ATA_SR_DRQ);
+    if (ata_failed(status, ATA_SR_DRQ)) return 0;
+
+    for (int i = 0; i < 256; i++) {
+        buffer[i] = inw(channel->io + ATA_REG_DATA);
+    }
+    return 1;
+}
+
+static uint32_t mbps_x10(uint32_t bytes, uint32_t us) {
+    return us ? bytes * 10 / us : 0;
+}
+
+// Блоками по ATA_MAX_SECTORS; маленький диск читается по кругу
+static uint8_t bench_blocks(uint8_t drive, uint8_t* buffer, uint32_t sectors, uint32_t span) {
+    for (uint32_t done = 0; done < sectors; ) {
+        uint32_t lba = done % span;
+        uint32_t count = span - lba;
+
+        if (count > ATA_MAX_SECTORS) count = ATA_MAX_SECTORS;
+        if (count > sectors - done) count = sectors - done;
+        if (!ata_read_sectors(drive, lba, count, buffer + lba * ATA_SECTOR_SIZE)) return 0;
+        done += count;
+    }
+    return 1;
+}
+
+uint8_t ata_benchmark(ata_bench_result_t* result) {
+    uint8_t* buffer = memmap_scratch(ATA_BENCH_BYTES);
+    uint32_t sectors = ATA_BENCH_BYTES / ATA_SECTOR_SIZE;
+    uint32_t saved_mask = trace_mask;
+    uint8_t drive = 0;
+    uint8_t ok = 1;
+    uint64_t start;
+
+    while (drive < ATA_MAX_DRIVES && !drives[drive].present) drive++;
+
+    result->drive = drive;
+    result->bytes = ATA_BENCH_BYTES;
+    result->multiple = 0;
+    result->single_us = result->multi_us = result->dma_us = 0;
+    result->single_mbps_x10 = result->multi_mbps_x10 = result->dma_mbps_x10 = 0;
+    if (drive == ATA_MAX_DRIVES || !drives[drive].total_sectors || !buffer) return 0;
+
+    uint32_t span = drives[drive].total_sectors < sectors ? drives[drive].total_sectors : sectors;
+    uint8_t saved_dma = drives[drive].dma_enabled;
+
+    result->multiple = drives[drive].multiple;
+
+    // Тысячи чтений вытеснили бы из кольца трассировки все остальное
+    trace_mask &= ~(1 << TRACE_SYS_IDE);
+
+    start = cpu_read_tsc();
+    for (uint32_t i = 0; i < sectors && ok; i++) {
+        uint32_t lba = i % span;
+        ok = read_sector_by_words(drive, lba, (uint16_t*)(buffer + lba * ATA_SECTOR_SIZE));
+    }
+    result->single_us = timer_cycles_to_us(cpu_read_tsc() - start);
+
+    drives[drive].dma_enabled = 0;
+    start = cpu_read_tsc();
+    if (ok) ok = bench_blocks(drive, buffer, sectors, span);
+    result->multi_us = timer_cycles_to_us(cpu_read_tsc() - start);
+    drives[drive].dma_enabled = saved_dma;
+
+    if (ok && drives[drive].dma_enabled) {
+        start = cpu_read_tsc();
+        ok = bench_blocks(drive, buffer, sectors, span);
+        result->dma_us = timer_cycles_to_us(cpu_read_tsc() - start);
+    }
+
+    trace_mask = saved_mask;
+
+    result->single_mbps_x10 = mbps_x10(result->bytes, result->single_us);
+    result->multi_mbps_x10 = mbps_x10(result->bytes, result->multi_us);
+    result->dma_mbps_x10 = mbps_x10(result->bytes, result->dma_us);
+    return ok;
+}
@@ -0,0 +1,124 @@
+#include "bcache.h"
+
+typedef struct {
+    blockdev_t* dev;        // 0 - строка свободна
+    uint32_t lba;
+    uint32_t last_use;
+} bcache_line_t;
+
+static bcache_line_t lines[BCACHE_SETS][BCACHE_WAYS];
+static uint8_t data[BCACHE_SETS][BCACHE_WAYS][BLOCKDEV_SECTOR_SIZE] __attribute__((aligned(4)));
+static uint32_t use_clock = 0;
+static bcache_stats_t stats;
+
+static inline void copy_sector(void* dest, const void* src) {
+    uint32_t dwords = BLOCKDEV_SECTOR_SIZE / 4;
+
+    __asm__ volatile ("cld; rep movsl"
+                      : "+D" (dest), "+S" (src), "+c" (dwords)
+                      :
+                      : "memory");
+}
+
+// Соседние сектора попадают в разные наборы
+static uint32_t set_of(uint32_t lba) {
+    return lba & (BCACHE_SETS - 1);
+}
+
+static int find_way(blockdev_t* dev, uint32_t lba) {
+    bcache_line_t* set = lines[set_of(lba)];
+
+    for (int way = 0; way < BCACHE_WAYS; way++) {
+        if (set[way].dev == dev && set[way].lba == lba) return way;
+    }
+    return -1;
+}
+
+static void insert(blockdev_t* dev, uint32_t lba, const uint8_t* sector) {
+    uint32_t index = set_of(lba);
+    bcache_line_t* set = lines[index];
+    int victim = find_way(dev, lba);
+
+    if (victim < 0) {
+        victim = 0;
+        for (int way = 0; way < BCACHE_WAYS; way++) {
+            if (!set[way].dev) {
+                victim = way;
+                break;
+            }
+            if (set[way].last_use < set[victim].last_use) victim = way;
+        }
+        if (set[victim].dev) {
+            stats.evictions++;
+        } else {
+            stats.lines_used++;
+        }
+    }
+
+    set[victim].dev = dev;
+    set[victim].lba = lba;
+    set[victim].last_use = ++use_clock;
+    copy_sector(data[index][victim], sector);
+}
+
+uint8_t bcache_read(blockdev_t* dev, uint32_t lba, uint32_t count, void* buffer) {
+    uint8_t* dest = (uint8_t*)buffer;
+    uint32_t found = 0;
+
+    if (count > BCACHE_MAX_REQUEST) {
+        stats.bypassed++;
+        return dev->read(dev, lba, count, buffer);
+    }
+
+    for (uint32_t i = 0; i < count; i++) {
+        if (find_way(dev, lba + i) >= 0) found++;
+    }
+
+    if (found == count) {
+        for (uint32_t i = 0; i < count; i++) {
+            uint32_t index = set_of(lba + i);
+            int way = find_way(dev, lba + i);
+
+            lines[index][way].last_use = ++use_clock;
+            copy_sector(dest + i * BLOCKDEV_SECTOR_SIZE, data[index][way]);
+        }
+        stats.hits += count;
+        return 1;
+    }
+
+    // Частичное попадание все равно стоит одной команды к диску
+    if (!dev->read(dev, lba, count, buffer)) return 0;
+
+    for (uint32_t i = 0; i < count; i++) {
+        insert(dev, lba + i, dest + i * BLOCKDEV_SECTOR_SIZE);
+    }
+    stats.hits += found;
+    stats.misses += count - found;
+    return 1;
+}
+
+void bcache_invalidate(blockdev_t* dev, uint32_t lba, uint32_t count) {
+    for (uint32_t i = 0; i < count; i++) {
+        int way = find_way(dev, lba + i);
+
+        if (way >= 0) {
+            lines[set_of(lba + i)][way].dev = 0;
+            stats.lines_used--;
+        }
+    }
+}
+
+void bcache_invalidate_device(blockdev_t* dev) {
+    for (int set = 0; set < BCACHE_SETS; set++) {
+        for (int way = 0; way < BCACHE_WAYS; way++) {
+            if (lines[set][way].dev == dev) {
+                lines[set][way].dev = 0;
+                stats.lines_used--;
+            }
+        }
+    }
+}
+
+void bcache_get_stats(bcache_stats_t* stats_out) {
+    *stats_out = stats;
+}
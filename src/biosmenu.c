@@ -3,8 +3,27 @@
 #include "console.h"
 #include "efficiency.h"
 #include "cpu.h"
+#include "timeline.h"
+#include "timer.h"
+#include "interrupts.h"
+#include "screen.h"
+#include "gfx.h"
+#include "kprintf.h"
+#include "serial.h"
+#include "trace.h"
+#include "ata.h"
+#include "ahci.h"
+#include "nvme.h"
+#include "virtio_blk.h"
+#include "blockdev.h"
+#include "partition.h"
+#include "realmode.h"
+#include "fat.h"
+#include "image.h"
+#include "eltorito.h"
+#include "linux.h"
+#include "memmap.h"
 
-#define VIDEO_MEMORY 0xB8000
 #define WIDTH 80
 #define HEIGHT 25
 
@@ -21,20 +40,6 @@
 #define KEY_LEFT 0x4B
 #define KEY_RIGHT 0x4D
 
-// Порты IDE
-#define IDE_DATA        0x1F0
-#define IDE_ERROR       0x1F1
-#define IDE_SECTOR_COUNT 0x1F2
-#define IDE_LBA_LOW     0x1F3
-#define IDE_LBA_MID     0x1F4
-#define IDE_LBA_HIGH    0x1F5
-#define IDE_DRIVE_HEAD  0x1F6
-#define IDE_COMMAND     0x1F7
-#define IDE_STATUS      0x1F7
-
-// Команды IDE
-#define IDE_CMD_READ    0x20
-
 // Порты CMOS
 #define CMOS_ADDRESS    0x70
 #define CMOS_DATA       0x71
@@ -55,6 +60,10 @@
 #define CMOS_BOOT_DEVICE_2  0x21
 #define CMOS_BOOT_DEVICE_3  0x22
 #define CMOS_HW_ERROR_COUNT 0x23
+#define CMOS_DISPLAY_MODE   0x29
+
+// Флаги CMOS_DISPLAY_MODE
+#define DISPLAY_GRAPHICS_UI 0x01
 
 // Информация о системе
 #define BIOS_VERSION "1.53.2"
@@ -82,10 +91,11 @@ typedef struct {
     uint8_t checksum;
     uint8_t boot_devices[3];
     uint8_t hw_error_count;
+    uint8_t fast_boot;          // хранится в CMOS_FAST_BOOT (post.c)
+    uint8_t graphics_ui;        // DISPLAY_GRAPHICS_UI в CMOS_DISPLAY_MODE
 } bios_settings_t;
 
 // Глобальные переменные
-uint16_t* video_mem = (uint16_t*)VIDEO_MEMORY;
 menu_state_t menu_state = {0, 0, 0, 0, 1};
 bios_settings_t bios_settings = {0};
 char input_buffer[64];
@@ -100,9 +110,9 @@ void show_left_menu(void);
 void show_right_panel(void);
 void handle_input(void);
 int strcmp(const char* s1, const char* s2);
-void delay(uint32_t count);
 void config_screen(void);void show_boot_screen(void);
 void boot_os(void);
+blockdev_t* boot_device_disk(uint8_t device);
 void detect_memory_info(void);
 void detect_cpu_info(void);
 uint8_t inb(uint16_t port);
@@ -110,13 +120,20 @@ void outb(uint16_t port, uint8_t value);
 uint16_t inw(uint16_t port);
 void outw(uint16_t port, uint16_t value);
 uint8_t keyboard_read(void);
+uint8_t keyboard_wait(void);
+uint8_t keyboard_wait_press(void);
 char get_ascii_char(uint8_t scancode);
 void wait_keyboard(void);
-uint8_t read_disk_sector(uint32_t lba, uint16_t* buffer);
-void wait_ide(void);
 void boot_from_disk(void);
+int os_select_menu(void);
+void boot_partition(const partition_t* part);
+void boot_from_cdrom(void);
+void boot_linux(fat_volume_t* vol, const linux_config_t* config);
+void realmode_handoff_prepare(void);
+uint8_t realmode_chainload_allowed(const blockdev_t* dev);
 uint32_t detect_memory_range(uint32_t start, uint32_t end);
 uint16_t read_cmos_memory(void);
+uint8_t cmos_is_password(uint8_t reg);
 uint8_t read_cmos(uint8_t reg);
 void write_cmos(uint8_t reg, uint8_t value);
 void load_bios_settings(void);
@@ -131,7 +148,6 @@ void boot_priority_menu(void);
 void update_bios_menu(void);
 void hardware_test(void);
 void show_boot_failed_error(void);
-void print_hex(uint32_t num, uint8_t x, uint8_t y, uint8_t color);
 void boot_from_usb(void);
 uint8_t detect_usb_controllers(void);
 uint8_t init_usb_controller(uint16_t base);
@@ -165,21 +181,65 @@ const char* boot_device_names[] = {
     "USB",
     "Network",
     "Disabled",
+    "NVMe",
+    "VirtIO",
+    "IDE0",
+    "IDE1",
+    "IDE2",
+    "IDE3",
 };
 
+// Номера в boot_devices (значения хранятся в CMOS)
+#define BOOT_DEVICE_CDROM   1
+#define BOOT_DEVICE_USB     2
+#define BOOT_DEVICE_NVME    5
+#define BOOT_DEVICE_VIRTIO  6
+// Пунктов в меню выбора ОС
+#define OS_MENU_MAX         15
+
+// IDE0-IDE3: первичный/вторичный канал, ведущий/ведомый
+#define BOOT_DEVICE_IDE0    7
+const int boot_device_count = 11;
+
 void main() {
+    // Отметки времени загрузки
+    timeline_init();
+    
+    // Калибровка таймера до первых задержек POST
+    timer_init();
+    
+    // Зеркало экрана и ввод через COM-порт (до POST, чтобы ошибки были видны)
+    serial_init();
+    
     // Запускаем POST
     uint8_t post_result = run_post();
     if (post_result != POST_SUCCESS) {
         show_post_error(post_result);
         // Зависаем при ошибке POST
         while(1) { 
-            post_delay(1000000); 
+            post_delay(1000); 
         }
     }
     
+    // IDT, PIC и клавиатура по прерываниям (после POST - тест клавиатуры опрашивает порты)
+    interrupts_init();
+    
+    // Диски: IDE (оба канала параллельно, READ MULTIPLE/DMA), затем SATA через AHCI, NVMe, virtio-blk
+    ata_init();
+    ahci_init();
+    nvme_init();
+    virtio_blk_init();
+    // Индекс разделов всех дисков для меню выбора ОС
+    partition_scan();
+    
+    // Меню через линейный буфер DISPI, если включено в настройках
+    if (gfx_init() && (read_cmos(CMOS_DISPLAY_MODE) & DISPLAY_GRAPHICS_UI)) {
+        screen_use_graphics(1);
+    }
+    
     // Показываем загрузочный экран
     show_boot_screen();
+    timeline_mark(TL_BOOT_SCREEN);
     
     // Очищаем и сбрасываем состояние
     clear_screen(0x07);
@@ -187,11 +247,14 @@ void main() {
     // Загружаем настройки из CMOS
     load_bios_settings();
     save_bios_settings();
+    timeline_mark(TL_LOAD_SETTINGS);
     
     watch_init();
+    timeline_mark(TL_WATCH_INIT);
     
     // В main() инициализируйте:
 efficiency_init();
+    timeline_mark(TL_EFFICIENCY_INIT);
 
 // В handle_input() или главном цикле периодически вызывайте
     
@@ -203,6 +266,8 @@ efficiency_init();
     
     // 🔥 АВТОМАТИЧЕСКАЯ ПРОВЕРКА ОС ПРИ ЗАПУСКЕ
     auto_boot_check();
+    timeline_mark(TL_AUTO_BOOT_CHECK);
+    timeline_commit();
     
     // Если не загрузили ОС - показываем BIOS меню
     menu_state.selected = 0;
@@ -215,7 +280,9 @@ efficiency_init();
             menu_state.needs_redraw = 0;
         }
         handle_input();
-        delay(10000);
+        auto_power_management();
+        // Спим до следующего тика или нажатия клавиши
+        interrupts_idle();
     }
 }
 
@@ -275,8 +342,8 @@ void auto_boot_check(void) {
             
             // Ждем ответа пользователя
             while(1) {
-                uint8_t scancode = keyboard_read();
-                if (scancode && !(scancode & 0x80)) {
+                uint8_t scancode = keyboard_wait();
+                if (!(scancode & 0x80)) {
                     char c = get_ascii_char(scancode);
                     
                     if (c == 'y' || c == 'Y') {
@@ -303,7 +370,6 @@ void auto_boot_check(void) {
                         return;
                     }
                 }
-                delay(10000);
             }
         }
     }
@@ -337,11 +403,7 @@ void show_boot_menu(void) {
         
         print_string("ENTER: Select  ESC: Cancel", 25, 20, 0x07);
         
-        uint8_t scancode = keyboard_read();
-        if (scancode == 0) {
-            delay(10000);
-            continue;
-        }
+        uint8_t scancode = keyboard_wait();
         
         if (scancode & 0x80) continue;
         
@@ -458,9 +520,9 @@ uint8_t detect_usb_controllers(void) {
                 usb_devices[count].type = 1; // UHCI
                 usb_devices[count].base_port = base;
                 count++;
+                TRACE(USB, FOUND, base, 0);
                 
-                print_string("USB Controller found at: 0x", 22, 10 + count, 0x0E);
-                print_hex(base, 46, 10 + count, 0x0E);
+                kprintf(22, 10 + count, 0x0E, "USB Controller found at: 0x%08X", base);
             }
         }
         outw(base + USB_COMMAND_PORT, original);
@@ -473,9 +535,9 @@ uint8_t detect_usb_controllers(void) {
 void reset_usb_controller(uint16_t base) {
     // Сброс контроллера
     outw(base + USB_COMMAND_PORT, inw(base + USB_COMMAND_PORT) | USB_CMD_RESET);
-    delay(50000);
+    mdelay(50);
     outw(base + USB_COMMAND_PORT, inw(base + USB_COMMAND_PORT) & ~USB_CMD_RESET);
-    delay(50000);
+    mdelay(50);
 }
 
 uint8_t init_usb_controller(uint16_t base) {
@@ -486,9 +548,11 @@ uint8_t init_usb_controller(uint16_t base) {
     
     // Проверяем, что контроллер работает
     if((inw(base + USB_STATUS_PORT) & 0x8000) == 0) {
+        TRACE(USB, INIT, base, 1);
         return 1; // Успех
     }
     
+    TRACE_WARNING(USB, INIT, base, 0);
     return 0; // Ошибка
 }
 
@@ -500,7 +564,7 @@ uint8_t usb_storage_reset(uint16_t base) {
     
     // Отправляем команду сброса (упрощенно)
     outb(base + 0x00, reset_cmd);
-    delay(100000);
+    mdelay(100);
     
     return 1;
 }
@@ -518,6 +582,8 @@ uint8_t read_usb_sector(uint16_t base, uint32_t lba, uint16_t* buffer) {
     // Чтение сектора с USB устройства
     scsi_read10_t cmd;
     
+    TRACE(USB, READ, base, lba);
+    
     // Формируем SCSI команду READ(10)
     cmd.opcode = SCSI_READ_10;
     cmd.lun_flags = 0;
@@ -554,19 +620,17 @@ void boot_from_usb(void) {
     if(usb_count == 0) {
         print_string("No USB controllers found!", 25, 7, 0x0C);
         print_string("Press any key to return...", 25, 9, 0x07);
-        keyboard_read();
+        keyboard_wait_press();
         return;
     }
     
     print_string("Found ", 25, 7, 0x0E);
-    print_char('0' + usb_count, 31, 7, 0x0E);
-    print_string(" USB controller(s)", 32, 7, 0x0E);
+    kprintf(31, 7, 0x0E, "%u USB controller(s)", usb_count);
     
     // Пытаемся загрузиться с каждого обнаруженного USB
     for(int i = 0; i < usb_count; i++) {
         if(usb_devices[i].detected) {
-            print_string("Trying USB controller at: 0x", 25, 9 + i, 0x07);
-            print_hex(usb_devices[i].base_port, 53, 9 + i, 0x07);
+            kprintf(25, 9 + i, 0x07, "Trying USB controller at: 0x%08X", usb_devices[i].base_port);
             
             if(init_usb_controller(usb_devices[i].base_port)) {
                 print_string(" - Initialized", 56, 9 + i, 0x0A);
@@ -581,10 +645,14 @@ void boot_from_usb(void) {
                         print_string("Boot sector read successfully!", 25, 13 + i, 0x0A);
                         
                         // Проверяем сигнатуру
+                        TRACE(BOOT, SIGNATURE, TRACE_DEV_USB, boot_sector[255]);
                         if(boot_sector[255] == 0xAA55) {
                             print_string("Valid boot signature found!", 25, 15 + i, 0x0A);
                             print_string("Transferring control to USB boot sector...", 25, 17 + i, 0x0E);
-                            delay(200000);
+                            mdelay(200);
+                            
+                            TRACE(BOOT, HANDOFF, TRACE_DEV_USB, 0x7C00);
+                            realmode_handoff_prepare();
                             
                             // Копируем загрузочный сектор и передаем управление
                             uint16_t* dest = (uint16_t*)0x7C00;
@@ -592,19 +660,7 @@ void boot_from_usb(void) {
                                 dest[j] = boot_sector[j];
                             }
                             
-                            __asm__ volatile(
-                                "cli\n"
-                                "mov $0x0000, %%ax\n"
-                                "mov %%ax, %%ds\n"
-                                "mov %%ax, %%es\n"
-                                "mov %%ax, %%ss\n"
-                                "mov $0x7C00, %%sp\n"
-                                "sti\n"
-                                "ljmp $0x0000, $0x7C00\n"
-                                :
-                                :
-                                : "memory"
-                            );
+                            realmode_boot_sector(0x80, 0);
                         } else {
                             print_string("Invalid boot signature!", 25, 15 + i, 0x0C);
                         }
@@ -622,7 +678,7 @@ void boot_from_usb(void) {
     
     print_string("USB boot failed on all controllers!", 25, 19, 0x0C);
     print_string("Press any key to return...", 25, 21, 0x07);
-    keyboard_read();
+    keyboard_wait_press();
 }
 
 void usb_boot_menu(void) {
@@ -639,10 +695,8 @@ void usb_boot_menu(void) {
         print_string("None", 50, 4, 0x0C);
     } else {
         for(int i = 0; i < usb_count; i++) {
-            print_string("Controller ", 25, 6 + i, 0x07);
-            print_char('0' + i + 1, 37, 6 + i, 0x0E);
-            print_string(" at port 0x", 39, 6 + i, 0x07);
-            print_hex(usb_devices[i].base_port, 50, 6 + i, 0x0E);
+            kprintf(25, 6 + i, 0x07, "Controller %C%u%C at port 0x%C%08X",
+                    0x0E, i + 1, 0x07, 0x0E, usb_devices[i].base_port);
         }
     }
     
@@ -651,11 +705,7 @@ void usb_boot_menu(void) {
     print_string("ESC. Return to Main Menu", 25, 13, 0x07);
     
     while(1) {
-        uint8_t scancode = keyboard_read();
-        if(scancode == 0) {
-            delay(10000);
-            continue;
-        }
+        uint8_t scancode = keyboard_wait();
         
         if(scancode & 0x80) continue;
         
@@ -670,26 +720,12 @@ void usb_boot_menu(void) {
             case '2':
                 // USB диагностика может быть добавлена позже
                 print_string("USB diagnostics not implemented yet", 25, 15, 0x0E);
-                delay(1000000);
+                mdelay(1000);
                 return;
         }
     }
 }
 
-// Вспомогательная функция для вывода hex
-void print_hex(uint32_t num, uint8_t x, uint8_t y, uint8_t color) {
-    char hex_chars[] = "0123456789ABCDEF";
-    char buffer[9];
-    
-    for(int i = 7; i >= 0; i--) {
-        buffer[i] = hex_chars[num & 0xF];
-        num >>= 4;
-    }
-    buffer[8] = '\0';
-    
-    print_string(buffer, x, y, color);
-}
-
 // ==================== НОВЫЕ ФУНКЦИИ SETTINGS ====================
 
 void settings_menu(void) {
@@ -699,10 +735,13 @@ void settings_menu(void) {
         "Power Management",  // Добавили управление питанием
         "Update BIOS", 
         "Load Defaults",
+        "Fast Boot",
+        "Full POST Next Boot",
+        "Graphics UI",
         "Save & Exit",
         "Exit Without Save"
     };
-    const int items_count = 6;
+    const int items_count = 9;
     
     clear_screen(0x07);
     print_string("BIOS SETTINGS", 35, 1, 0x0F);
@@ -726,6 +765,24 @@ void settings_menu(void) {
     }
     
     while(1) {
+        // Состояние быстрой загрузки
+        print_string("Fast Boot: ", 25, 5, 0x0F);
+        if (bios_settings.fast_boot) {
+            print_string("ON ", 46, 5, 0x0A);
+        } else {
+            print_string("OFF", 46, 5, 0x07);
+        }
+        
+        // Режим вывода меню
+        print_string("Graphics UI: ", 52, 5, 0x0F);
+        if (!gfx_available()) {
+            print_string("N/A", 65, 5, 0x08);
+        } else if (bios_settings.graphics_ui) {
+            print_string("ON ", 65, 5, 0x0A);
+        } else {
+            print_string("OFF", 65, 5, 0x07);
+        }
+        
         // Отрисовка меню
         for(int i = 0; i < items_count; i++) {
             uint8_t color = (i == selected) ? 0x1F : 0x07;
@@ -739,11 +796,7 @@ void settings_menu(void) {
         
         print_string("Use UP/DOWN to navigate, ENTER to select, ESC to return", 15, 20, 0x07);
         
-        uint8_t scancode = keyboard_read();
-        if (scancode == 0) {
-            delay(10000);
-            continue;
-        }
+        uint8_t scancode = keyboard_wait();
         
         if (scancode & 0x80) continue;
         
@@ -765,15 +818,35 @@ void settings_menu(void) {
                     bios_settings.boot_devices[2] = 4; // Disabled
                     set_power_mode(POWER_MODE_BALANCED); // Сброс к сбалансированному режиму
                     print_string("Defaults loaded! Press any key...", 30, 15, 0x07);
-                    keyboard_read();
+                    keyboard_wait_press();
                     break;
                 case 4:
+                    // Fast Boot: пропуск сигналов, анимации и повторных проверок
+                    bios_settings.fast_boot = !bios_settings.fast_boot;
+                    continue;
+                case 5:
+                    // Полный POST при следующей загрузке
+                    post_force_full_next_boot();
+                    print_string("Full POST scheduled! Press any key...", 28, 15, 0x07);
+                    keyboard_wait_press();
+                    break;
+                case 6:
+                    // Графический режим меню, включается по Save & Exit
+                    if (gfx_available()) {
+                        bios_settings.graphics_ui = !bios_settings.graphics_ui;
+                    }
+                    continue;
+                case 7:
                     // Save & Exit
                     save_bios_settings();
                     save_power_settings_to_cmos();
+                    if (gfx_available()) {
+                        screen_use_graphics(bios_settings.graphics_ui);
+                    }
                     return;
-                case 5:
-                    // Exit Without Save
+                case 8:
+                    // Exit Without Save: несохраненные изменения - обратно из CMOS
+                    load_bios_settings();
                     return;
             }
             // Перерисовываем меню после возврата из подменю
@@ -799,6 +872,7 @@ void settings_menu(void) {
             }
         }
         else if (scancode == KEY_ESC) {
+            load_bios_settings();
             return;
         }
     }
@@ -817,23 +891,19 @@ void boot_priority_menu(void) {
     while(1) {
         // Отрисовка текущих настроек
         print_string("1st Boot Device: ", 25, 7, 0x07);
-        print_string(boot_device_names[bios_settings.boot_devices[0]], 42, 7, 0x0F);
+        kprintf(42, 7, 0x0F, "%-9s", boot_device_names[bios_settings.boot_devices[0]]);
         
         print_string("2nd Boot Device: ", 25, 9, 0x07);
-        print_string(boot_device_names[bios_settings.boot_devices[1]], 42, 9, 0x0F);
+        kprintf(42, 9, 0x0F, "%-9s", boot_device_names[bios_settings.boot_devices[1]]);
         
         print_string("3rd Boot Device: ", 25, 11, 0x07);
-        print_string(boot_device_names[bios_settings.boot_devices[2]], 42, 11, 0x0F);
+        kprintf(42, 11, 0x0F, "%-9s", boot_device_names[bios_settings.boot_devices[2]]);
         
         // Курсор выбора
         print_string("  ", 40, 7 + selected * 2, 0x07);
         print_string(">", 40, 7 + selected * 2, 0x1F);
         
-        uint8_t scancode = keyboard_read();
-        if (scancode == 0) {
-            delay(10000);
-            continue;
-        }
+        uint8_t scancode = keyboard_wait();
         
         if (scancode & 0x80) continue;
         
@@ -851,7 +921,7 @@ void boot_priority_menu(void) {
             
             print_string("Boot priority saved to CMOS!", 25, 15, 0x07);
             print_string("Press any key...", 25, 16, 0x07);
-            keyboard_read();
+            keyboard_wait_press();
             return;
         }
         else if (scancode == KEY_ESC) {
@@ -861,7 +931,7 @@ void boot_priority_menu(void) {
             char c = get_ascii_char(scancode);
             if (c == '+' || c == '=') {
                 // Увеличиваем приоритет устройства
-                if (bios_settings.boot_devices[selected] < 4) {
+                if (bios_settings.boot_devices[selected] < boot_device_count - 1) {
                     bios_settings.boot_devices[selected]++;
                 }
             }
@@ -875,19 +945,101 @@ void boot_priority_menu(void) {
     }
 }
 
+// Образ обновления на первом томе FAT; проверяется целиком в памяти
+// (в общем буфере SCRATCH_ADDR, поэтому не больше него)
+#define UPDATE_MAX_SECTORS (SCRATCH_SIZE / IMAGE_SECTOR_SIZE - IMAGE_PAYLOAD_LBA)
+const char* update_image_paths[] = {"/WEXIB.IMG", "/BIOS.IMG", "/EFI/WEXIB/WEXIB.IMG"};
+const int update_image_paths_count = 3;
+
 void update_bios_menu(void) {
+    fat_volume_t vol;
+    fat_file_t file;
+    image_header_t* header;
+    uint8_t* image = memmap_scratch(IMAGE_PAYLOAD_LBA * IMAGE_SECTOR_SIZE);
+    uint32_t current = ((boot_handoff_t*)BOOT_HANDOFF_ADDR)->image_checksum;
+    uint32_t checksum = 0;
+    uint32_t image_size, payload_size;
+    int found = -1;
+
     clear_screen(0x07);
     print_string("BIOS UPDATE UTILITY", 32, 5, 0x0F);
     print_string("====================", 32, 6, 0x0F);
     
     print_string("Searching for updates...", 30, 8, 0x07);
-    delay(100000);
-    
-    print_string("No updates found.", 35, 10, 0x07);
-    print_string("Your BIOS is up to date.", 33, 11, 0x07);
-    print_string("Current version: WeBIOS v4.51", 30, 13, 0x07);
-    
-    delay(1000000);
+
+    if (!image) {
+        print_string("Not enough memory for the image buffer.", 30, 10, 0x0C);
+        print_string("Press any key...", 30, 15, 0x07);
+        keyboard_wait_press();
+        return;
+    }
+    if (!fat_mount_first(&vol)) {
+        print_string("No FAT volume found.", 30, 10, 0x0C);
+        print_string("Press any key...", 30, 15, 0x07);
+        keyboard_wait_press();
+        return;
+    }
+    kprintf(30, 9, 0x07, "Volume: FAT%u on %s", vol.type, vol.dev->name);
+
+    for (int i = 0; i < update_image_paths_count && found < 0; i++) {
+        if (fat_open(&vol, update_image_paths[i], &file)) found = i;
+    }
+    if (found < 0) {
+        print_string("No updates found.", 35, 10, 0x07);
+        print_string("Your BIOS is up to date.", 33, 11, 0x07);
+        print_string("Current version: WeBIOS v4.51", 30, 13, 0x07);
+        print_string("Press any key...", 30, 15, 0x07);
+        keyboard_wait_press();
+        return;
+    }
+    kprintf(30, 10, 0x07, "Image: %s (%u KB)", update_image_paths[found], file.size / 1024);
+
+    // Заголовок образа, затем payload целиком - слитные кластеры читаются крупно
+    header = (image_header_t*)(image + IMAGE_HEADER_LBA * IMAGE_SECTOR_SIZE);
+    image_size = IMAGE_PAYLOAD_LBA * IMAGE_SECTOR_SIZE;
+    if (fat_read(&file, image, image_size) != image_size || header->magic != IMAGE_MAGIC) {
+        print_string("Not a WexIB image!", 30, 12, 0x0C);
+        print_string("Press any key...", 30, 15, 0x07);
+        keyboard_wait_press();
+        return;
+    }
+    // Размер из заголовка ограничен до умножения: без этого переполнение
+    // обходит проверку размера файла
+    if (header->sectors > UPDATE_MAX_SECTORS) {
+        print_string("Image is too large!", 30, 12, 0x0C);
+        print_string("Press any key...", 30, 15, 0x07);
+        keyboard_wait_press();
+        return;
+    }
+    payload_size = header->sectors * IMAGE_SECTOR_SIZE;
+    image_size += payload_size;
+    if (!memmap_scratch(image_size)) {
+        print_string("Not enough memory for the image buffer.", 30, 12, 0x0C);
+        print_string("Press any key...", 30, 15, 0x07);
+        keyboard_wait_press();
+        return;
+    }
+    if (file.size < image_size ||
+        fat_read(&file, image + IMAGE_PAYLOAD_LBA * IMAGE_SECTOR_SIZE, payload_size) != payload_size) {
+        print_string("Image is truncated!", 30, 12, 0x0C);
+        print_string("Press any key...", 30, 15, 0x07);
+        keyboard_wait_press();
+        return;
+    }
+
+    for (uint32_t offset = IMAGE_PAYLOAD_LBA * IMAGE_SECTOR_SIZE; offset < image_size; offset += 4) {
+        checksum += *(uint32_t*)(image + offset);
+    }
+    if (checksum != header->checksum) {
+        print_string("Image checksum mismatch!", 30, 12, 0x0C);
+    } else if (checksum == current) {
+        kprintf(30, 12, 0x0A, "Image %08x matches the running BIOS.", checksum);
+    } else {
+        kprintf(30, 12, 0x0E, "New image %08x (running %08x).", checksum, current);
+        print_string("Flash it with the tools in flashing.md.", 30, 13, 0x07);
+    }
+    print_string("Press any key...", 30, 15, 0x07);
+    keyboard_wait_press();
 }
 
 void hardware_test(void) {
@@ -898,15 +1050,18 @@ void hardware_test(void) {
     print_string("=====================", 30, 2, 0x0F);
     
     print_string("Testing hardware components...", 25, 4, 0x07);
-    delay(10000);
+    mdelay(10);
     
   
     // Тест видео
     print_string("Video Test: ", 25, 10, 0x07);
-    delay(10000);
+    mdelay(10);
     print_string("PASSED", 38, 10, 0x0A);
     
-    // Сохраняем количество ошибок
+    // Сохраняем количество ошибок; изменение сбрасывает отпечаток быстрой загрузки
+    if (bios_settings.hw_error_count != error_count) {
+        post_invalidate_fingerprint();
+    }
     bios_settings.hw_error_count = error_count;
     write_cmos(CMOS_HW_ERROR_COUNT, error_count);
     
@@ -914,7 +1069,7 @@ void hardware_test(void) {
     if (error_count >= 2) {
         print_string("Critical errors detected!", 25, 12, 0x0C);
         print_string("System will show error on next boot.", 25, 13, 0x07);
-        delay(9999000);
+        mdelay(10000);
     } else if (error_count > 0) {
         print_string("Some errors detected but system is operational.", 25, 12, 0x0E);
     } else {
@@ -922,7 +1077,7 @@ void hardware_test(void) {
     }
     
     print_string("Press any key to return...", 25, 16, 0x07);
-    keyboard_read();
+    keyboard_wait_press();
 }
 
 // ==================== СИСТЕМА БЕЗОПАСНОСТИ ====================
@@ -943,11 +1098,7 @@ void enter_password(void) {
         }
         print_char('_', 41 + pos, 7, 0x07);
         
-        uint8_t scancode = keyboard_read();
-        if (scancode == 0) {
-            delay(10000);
-            continue;
-        }
+        uint8_t scancode = keyboard_wait();
         
         if (scancode & 0x80) continue;
         
@@ -957,19 +1108,17 @@ void enter_password(void) {
             if (strcmp(password, bios_settings.password) == 0) {
                 // Пароль верный
                 print_string("Access granted!", 25, 9, 0x07);
-                delay(2000);
+                mdelay(500);
                 return;
             } else {
                 // Неверный пароль
                 password_attempts++;
                 pos = 0;
-                print_string("Invalid password! Attempts: ", 25, 9, 0x07);
-                print_char('0' + password_attempts, 53, 9, 0x07);
-                print_string("/3", 54, 9, 0x07);
+                kprintf(25, 9, 0x07, "Invalid password! Attempts: %u/3", password_attempts);
                 
                 if (password_attempts >= 3) {
                     print_string("System halted!", 25, 11, 0x07);
-                    while(1) { delay(1000000); } // Зависаем
+                    while(1) { mdelay(1000); } // Зависаем
                 }
             }
         }
@@ -1019,11 +1168,7 @@ void security_menu(void) {
     print_string("ESC. Return to Main Menu", 25, 11, 0x07);
     
     while(1) {
-        uint8_t scancode = keyboard_read();
-        if (scancode == 0) {
-            delay(10000);
-            continue;
-        }
+        uint8_t scancode = keyboard_wait();
         
         if (scancode & 0x80) continue;
         
@@ -1089,11 +1234,7 @@ void set_password(void) {
         // Показываем курсор
         print_char('_', 25 + pos, 4, 0x07);
         
-        uint8_t scancode = keyboard_read();
-        if (scancode == 0) {
-            delay(10000);
-            continue;
-        }
+        uint8_t scancode = keyboard_wait();
         
         if (scancode & 0x80) continue;
         
@@ -1111,7 +1252,7 @@ void set_password(void) {
                 print_string("Password set to: ", 25, 7, 0x2);
                 print_string(new_password, 42, 7, 0x07);
                 print_string("Press any key...", 25, 9, 0x2);
-                keyboard_read();
+                keyboard_wait_press();
                 return;
             }
         }
@@ -1166,11 +1307,15 @@ void show_boot_screen(void) {
     uint8_t b_pressed = 0;
     uint8_t t_pressed = 0;
     
+    // Быстрая загрузка - без анимации
+    if (post_fast_boot_active()) {
+        return;
+    }
+    
     for(int i = 0; i < 30; i++) {
         // Проверяем одновременное нажатие B+T
-        if (inb(KEYBOARD_STATUS_PORT) & 0x01) {
-            uint8_t scancode = inb(KEYBOARD_DATA_PORT);
-            
+        uint8_t scancode;
+        while ((scancode = keyboard_read()) != 0) {
             if (!(scancode & 0x80)) { // Только нажатие
                 if (scancode == 0x30) { // B key
                     b_pressed = 1;
@@ -1199,30 +1344,40 @@ void show_boot_screen(void) {
         // Анимация прогресс-бара
         print_string("=", 26 + i, 15, 0x001F);
         print_string(">", 26 + i, 15, 0x001F);
-        delay(20000);
+        mdelay(20);
         print_string(" ", 26 + i, 15, 0x001F);
     }
     
     // Заполняем прогресс-бар полностью
     for(int i = 0; i < 30; i++) {
         print_string("=", 26 + i, 15, 0x001F);
-        delay(10000);
+        mdelay(10);
     }
     
-    delay(99999);
+    mdelay(100);
 }
 
 // ==================== CMOS ФУНКЦИИ ====================
 
+uint8_t cmos_is_password(uint8_t reg) {
+    return reg >= CMOS_PASSWORD_0 && reg <= CMOS_PASSWORD_7;
+}
+
 uint8_t read_cmos(uint8_t reg) {
     outb(CMOS_ADDRESS, reg);
-    delay(10);
-    return inb(CMOS_DATA);
+    udelay(1);
+    uint8_t value = inb(CMOS_DATA);
+    
+    // Часы опрашиваются дважды в секунду - только на подробном уровне.
+    // Байты пароля в трассировку не попадают: она уходит в COM1 и 0xE9
+    TRACE_VERBOSE(CMOS, READ, reg, cmos_is_password(reg) ? 0 : value);
+    return value;
 }
 
 void write_cmos(uint8_t reg, uint8_t value) {
+    TRACE_VERBOSE(CMOS, WRITE, reg, cmos_is_password(reg) ? 0 : value);
     outb(CMOS_ADDRESS, reg);
-    delay(10);
+    udelay(1);
     outb(CMOS_DATA, value);
 }
 
@@ -1251,6 +1406,9 @@ void load_bios_settings(void) {
     // Загружаем счетчик ошибок
     bios_settings.hw_error_count = read_cmos(CMOS_HW_ERROR_COUNT);
     
+    bios_settings.fast_boot = post_get_fast_boot();
+    bios_settings.graphics_ui = (read_cmos(CMOS_DISPLAY_MODE) & DISPLAY_GRAPHICS_UI) != 0;
+    
     // Проверяем контрольную сумму
     uint8_t stored_checksum = read_cmos(CMOS_CHECKSUM);
     uint8_t calculated_checksum = calculate_checksum();
@@ -1289,6 +1447,11 @@ void save_bios_settings(void) {
     // Сохраняем счетчик ошибок
     write_cmos(CMOS_HW_ERROR_COUNT, bios_settings.hw_error_count);
     
+    post_set_fast_boot(bios_settings.fast_boot);
+    uint8_t display_mode = read_cmos(CMOS_DISPLAY_MODE) & ~DISPLAY_GRAPHICS_UI;
+    if (bios_settings.graphics_ui) display_mode |= DISPLAY_GRAPHICS_UI;
+    write_cmos(CMOS_DISPLAY_MODE, display_mode);
+    
     // Сохраняем контрольную сумму
     bios_settings.checksum = calculate_checksum();
     write_cmos(CMOS_CHECKSUM, bios_settings.checksum);
@@ -1314,18 +1477,47 @@ uint8_t calculate_checksum(void) {
 
 // ==================== ЗАГРУЗКА ОС ====================
 
+// Диск для пункта порядка загрузки; 0 - пункт не диск или диска нет
+blockdev_t* boot_device_disk(uint8_t device) {
+    if (device == BOOT_DEVICE_NVME) return blockdev_find_type(BLOCKDEV_NVME, 0);
+    if (device == BOOT_DEVICE_VIRTIO) return blockdev_find_type(BLOCKDEV_VIRTIO, 0);
+    if (device >= BOOT_DEVICE_IDE0 && device < BOOT_DEVICE_IDE0 + ATA_MAX_DRIVES) {
+        blockdev_t* dev;
+
+        for (uint8_t i = 0; (dev = blockdev_find_type(BLOCKDEV_ATA, i)) != 0; i++) {
+            if (dev->unit == device - BOOT_DEVICE_IDE0) return dev;
+        }
+    }
+    return 0;
+}
+
 void boot_os(void) {
     clear_screen(0x07);
     
     // Проверяем приоритет загрузки
-    if(bios_settings.boot_devices[0] == 2) { // USB
+    if(bios_settings.boot_devices[0] == BOOT_DEVICE_USB) {
         print_string("Booting from USB (1st priority)...", 0, 0, 0x07);
         boot_from_usb();
     } 
-    else if(bios_settings.boot_devices[1] == 2) { // USB как второе устройство
+    else if(boot_device_disk(bios_settings.boot_devices[0])) {
+        kprintf(0, 0, 0x07, "Booting from %s (1st priority)...",
+                boot_device_names[bios_settings.boot_devices[0]]);
+        blockdev_select_boot(boot_device_disk(bios_settings.boot_devices[0]));
+        boot_from_disk();
+    }
+    else if(bios_settings.boot_devices[0] == BOOT_DEVICE_CDROM) {
+        print_string("Booting from CD/DVD (1st priority)...", 0, 0, 0x07);
+        boot_from_cdrom();
+    }
+    else if(bios_settings.boot_devices[1] == BOOT_DEVICE_USB) { // второе устройство
         print_string("Trying USB (2nd priority)...", 0, 0, 0x07);
         boot_from_usb();
     }
+    else if(bios_settings.boot_devices[1] == BOOT_DEVICE_CDROM && blockdev_holds_firmware(blockdev_boot())) {
+        // Кроме диска с прошивкой загружаться не с чего
+        print_string("Trying CD/DVD (2nd priority)...", 0, 0, 0x07);
+        boot_from_cdrom();
+    }
     else {
         // Стандартная загрузка с HDD
         print_string("Attempting to boot from hard disk...", 0, 0, 0x07);
@@ -1335,13 +1527,42 @@ void boot_os(void) {
 
 void boot_from_disk(void) {
     uint16_t boot_sector[256]; // 512 байт
+    fat_volume_t linux_volume;
+    linux_config_t linux_config;
+    
+    // Ядро Linux с тома FAT - без загрузчика в MBR
+    if (linux_find_config(blockdev_boot(), &linux_volume, &linux_config)) {
+        boot_linux(&linux_volume, &linux_config);
+        return;
+    }
+    
+    // Несколько систем - сначала меню выбора
+    if (partition_bootable_count() >= 2) {
+        int choice = os_select_menu();
+        
+        if (choice < 0) return;
+        if (choice > 0) {
+            boot_partition(partition_get(choice - 1));
+            return;
+        }
+        clear_screen(0x07);
+        print_string("Booting from disk boot sector...", 0, 0, 0x07);
+    }
+    
+    if (!realmode_chainload_allowed(blockdev_boot())) return;
     
     // Пытаемся прочитать загрузочный сектор (LBA 0)
     if (read_disk_sector(0, boot_sector)) {
         // Проверяем сигнатуру загрузочного сектора
+        TRACE(BOOT, SIGNATURE, TRACE_DEV_DISK, boot_sector[255]);
         if (boot_sector[255] == 0xAA55) {
             print_string("Boot signature found! Transferring control...", 0, 3, 0x07);
-            delay(100);
+            udelay(100);
+            
+            timeline_mark(TL_BOOT_HANDOFF);
+            timeline_commit();
+            TRACE(BOOT, HANDOFF, TRACE_DEV_DISK, 0x7C00);
+            realmode_handoff_prepare();
             
             // Копируем загрузочный сектор по адресу 0x7C00
             uint16_t* dest = (uint16_t*)0x7C00;
@@ -1349,78 +1570,179 @@ void boot_from_disk(void) {
                 dest[i] = boot_sector[i];
             }
             
-            // Переходим в реальный режим и передаем управление
-            __asm__ volatile(
-                "cli\n"
-                "mov $0x0000, %ax\n"
-                "mov %ax, %ds\n"
-                "mov %ax, %es\n"
-                "mov %ax, %ss\n"
-                "mov $0x7C00, %sp\n"
-                "sti\n"
-                "ljmp $0x0000, $0x7C00\n"
-            );
+            // Возвращаемся в реальный режим и передаем управление
+            realmode_boot_sector(blockdev_bios_drive(blockdev_boot()), 0);
         } else {
             print_string("Error: No boot signature (0xAA55)", 0, 3, 0x07);
             print_string("Press any key to return...", 0, 5, 0x07);
-            keyboard_read();
+            keyboard_wait_press();
         }
     } else {
         print_string("Error: Cannot read boot sector", 0, 3, 0x07);
         print_string("Press any key to return...", 0, 5, 0x07);
-        keyboard_read();
+        keyboard_wait_press();
     }
 }
 
-uint8_t read_disk_sector(uint32_t lba, uint16_t* buffer) {
-    wait_ide();
+// Меню выбора ОС по индексу разделов. Возвращает -1 (ESC), 0 - загрузочный
+// сектор диска, n - раздел n - 1 в индексе
+int os_select_menu(void) {
+    uint8_t items[OS_MENU_MAX];
+    uint8_t item_count = 0;
+    int selected = 0;
     
-    // Выбираем мастер-диск
-    outb(IDE_DRIVE_HEAD, 0xE0 | ((lba >> 24) & 0x0F));
+    for (uint8_t i = 0; i < partition_count() && item_count < OS_MENU_MAX; i++) {
+        if (partition_get(i)->flags & PARTITION_BOOTABLE) items[item_count++] = i;
+    }
     
-    // Количество секторов
-    outb(IDE_SECTOR_COUNT, 1);
+    clear_screen(0x07);
+    print_string("SELECT OPERATING SYSTEM", 28, 1, 0x0F);
+    print_string("=======================", 28, 2, 0x0F);
+    print_string("* - active partition", 20, 4, 0x07);
+    print_string("ENTER: Boot  ESC: Return", 28, 23, 0x07);
     
-    // LBA адрес
-    outb(IDE_LBA_LOW, lba & 0xFF);
-    outb(IDE_LBA_MID, (lba >> 8) & 0xFF);
-    outb(IDE_LBA_HIGH, (lba >> 16) & 0xFF);
+    while (1) {
+        blockdev_t* disk = blockdev_boot();
+        
+        kprintf(18, 6, selected == 0 ? 0x1F : 0x07, " %-44s ", "Disk boot sector (MBR)");
+        if (disk) kprintf(65, 6, 0x07, "%-6s", disk->name);
+        
+        for (int i = 0; i < item_count; i++) {
+            const partition_t* part = partition_get(items[i]);
+            
+            kprintf(18, 7 + i, selected == i + 1 ? 0x1F : 0x07, " %s %-3u %-20s %-10u MB %c   ",
+                    partition_scheme_name(part), part->number, part->name, part->sectors >> 11,
+                    (part->flags & PARTITION_ACTIVE) ? '*' : ' ');
+            kprintf(65, 7 + i, 0x07, "%-6s", part->dev->name);
+        }
+        
+        uint8_t scancode = keyboard_wait();
+        if (scancode & 0x80) continue;
+        
+        if (scancode == KEY_UP && selected > 0) {
+            selected--;
+        } else if (scancode == KEY_DOWN && selected < item_count) {
+            selected++;
+        } else if (scancode == KEY_ENTER) {
+            return selected ? items[selected - 1] + 1 : 0;
+        } else if (scancode == KEY_ESC) {
+            return -1;
+        }
+    }
+}
+
+// Сектор раздела (VBR) по 0x7C00; DS:SI - запись раздела, как после MBR
+void boot_partition(const partition_t* part) {
+    uint16_t boot_sector[256];
+    mbr_entry_t* entry = (mbr_entry_t*)REALMODE_PART_ENTRY;
     
-    // Команда чтения
-    outb(IDE_COMMAND, IDE_CMD_READ);
+    clear_screen(0x07);
+    kprintf(0, 0, 0x07, "Booting %s %s partition %u (%s)...", part->dev->name,
+            partition_scheme_name(part), part->number, part->name);
     
-    // Ждем готовности
-    wait_ide();
+    if (!realmode_chainload_allowed(part->dev)) return;
+    if (!blockdev_read(part->dev, part->start, 1, boot_sector) || boot_sector[255] != 0xAA55) {
+        print_string("Error: Cannot read partition boot sector", 0, 3, 0x07);
+        print_string("Press any key to return...", 0, 5, 0x07);
+        keyboard_wait_press();
+        return;
+    }
     
-    // Проверяем ошибки
-    if (inb(IDE_STATUS) & 0x01) {
-        return 0; // Ошибка
+    timeline_mark(TL_BOOT_HANDOFF);
+    timeline_commit();
+    TRACE(BOOT, HANDOFF, TRACE_DEV_PARTITION, part->start);
+    realmode_handoff_prepare();
+    
+    uint16_t* dest = (uint16_t*)0x7C00;
+    for (int i = 0; i < 256; i++) {
+        dest[i] = boot_sector[i];
     }
+    *entry = part->entry;
+    entry->status = MBR_ACTIVE;
     
-    // Читаем данные
-    for(int i = 0; i < 256; i++) {
-        buffer[i] = inw(IDE_DATA);
+    realmode_boot_sector(blockdev_bios_drive(part->dev), REALMODE_PART_ENTRY);
+}
+
+// Образ El Torito без эмуляции: читается одной командой, переносится на
+// место загрузки уже после выхода из payload
+void boot_from_cdrom(void) {
+    eltorito_boot_t boot;
+    
+    if (!eltorito_find(&boot)) {
+        print_string("Error: No bootable CD/DVD (El Torito, no emulation)", 0, 3, 0x07);
+        print_string("Press any key to return...", 0, 5, 0x07);
+        keyboard_wait_press();
+        return;
     }
+    kprintf(0, 2, 0x07, "IDE%u: boot image at sector %u, %u KB to %04x:0000", boot.drive,
+            boot.load_rba, boot.sectors / 2, boot.load_segment);
     
-    return 1;
+    if (!eltorito_load(&boot)) {
+        print_string("Error: Cannot load CD boot image", 0, 3, 0x07);
+        print_string("Press any key to return...", 0, 5, 0x07);
+        keyboard_wait_press();
+        return;
+    }
+    
+    timeline_mark(TL_BOOT_HANDOFF);
+    timeline_commit();
+    TRACE(BOOT, HANDOFF, TRACE_DEV_CDROM, (uint32_t)boot.load_segment << 4);
+    realmode_handoff_prepare();
+    
+    eltorito_jump(&boot);
 }
 
-void wait_ide(void) {
-    uint8_t status;
-    int timeout = 10000;
-    
-    // Ждем когда диск не busy
-    do {
-        status = inb(IDE_STATUS);
-        timeout--;
-    } while ((status & 0x80) && timeout > 0);
-    
-    timeout = 10000;
-    // Ждем ready
-    do {
-        status = inb(IDE_STATUS);
-        timeout--;
-    } while (!(status & 0x40) && timeout > 0);
+// Перед переходом в реальный режим: текстовый режим, выгрузка трассировки,
+// контроллеры и прерывания обратно в том виде, в каком их оставил BIOS
+void realmode_handoff_prepare(void) {
+    screen_use_graphics(0);
+    trace_drain(TRACE_OUT_DEBUGCON);
+    serial_shutdown();
+    ahci_shutdown();
+    nvme_shutdown();
+    virtio_blk_shutdown();
+    interrupts_shutdown();
+}
+
+// Очереди NVMe и virtio-blk, которые завел BIOS, после инициализации не
+// восстановить - его INT 13h с такого диска не работает, остается только Linux
+uint8_t realmode_chainload_allowed(const blockdev_t* dev) {
+    if (!dev || (dev->type != BLOCKDEV_NVME && dev->type != BLOCKDEV_VIRTIO)) return 1;
+    
+    kprintf(0, 3, 0x07, "Error: %s boots only Linux (/LINUX.CFG)", dev->name);
+    print_string("Press any key to return...", 0, 5, 0x07);
+    keyboard_wait_press();
+    return 0;
+}
+
+// bzImage и initrd читаются прямо на свои места, вход - 32-битный
+// (boot_params вместо кода настройки в реальном режиме)
+void boot_linux(fat_volume_t* vol, const linux_config_t* config) {
+    uint8_t result;
+    
+    // Буфер графики лежит там, куда грузится ядро
+    screen_use_graphics(0);
+    clear_screen(0x07);
+    kprintf(0, 0, 0x07, "Booting Linux from %s (FAT%u)...", vol->dev->name, vol->type);
+    kprintf(0, 1, 0x07, "Kernel: %s", config->kernel);
+    if (config->initrd[0]) kprintf(0, 2, 0x07, "Initrd: %s", config->initrd);
+    
+    result = linux_load(vol, config);
+    if (result != LINUX_OK) {
+        kprintf(0, 4, 0x07, "Error: %s", linux_error_name(result));
+        print_string("Press any key to return...", 0, 6, 0x07);
+        keyboard_wait_press();
+        return;
+    }
+    
+    timeline_mark(TL_BOOT_HANDOFF);
+    timeline_commit();
+    TRACE(BOOT, HANDOFF, TRACE_DEV_LINUX, linux_entry_point());
+    trace_drain(TRACE_OUT_DEBUGCON);
+    serial_shutdown();
+    interrupts_shutdown();
+    
+    linux_jump();
 }
 
 // ==================== ОБНАРУЖЕНИЕ ПАМЯТИ ====================
@@ -1448,10 +1770,6 @@ void detect_cpu_info(void) {
 
 // ==================== ФУНКЦИИ ВВОДА-ВЫВОДА ====================
 
-void delay(uint32_t milliseconds) {
-    for (volatile int i = 0; i < milliseconds * 1000; i++);
-}
-
 // Чтение из порта
 uint8_t inb(uint16_t port) {
     uint8_t result;
@@ -1483,12 +1801,42 @@ void wait_keyboard(void) {
 
 // Чтение скана кода клавиши
 uint8_t keyboard_read(void) {
+    uint8_t scancode;
+    
+    // После interrupts_init() скан-коды приходят через IRQ1
+    if (interrupts_active()) {
+        return kbd_queue_pop(&scancode) ? scancode : 0;
+    }
+    
     if (!(inb(KEYBOARD_STATUS_PORT) & 0x01)) {
         return 0; // Нет данных
     }
     return inb(KEYBOARD_DATA_PORT);
 }
 
+// Ожидание скан-кода (нажатие или отпускание)
+uint8_t keyboard_wait(void) {
+    uint8_t scancode;
+    
+    if (interrupts_active()) {
+        return kbd_queue_wait();
+    }
+    
+    while ((scancode = keyboard_read()) == 0) {
+        screen_flush();
+        mdelay(10);
+    }
+    return scancode;
+}
+
+// Ожидание нажатия клавиши, коды отпускания пропускаются
+uint8_t keyboard_wait_press(void) {
+    uint8_t scancode;
+    
+    while ((scancode = keyboard_wait()) & 0x80);
+    return scancode;
+}
+
 // Преобразование скан-кода в ASCII
 char get_ascii_char(uint8_t scancode) {
     // Базовая US QWERTY раскладка
@@ -1507,29 +1855,6 @@ char get_ascii_char(uint8_t scancode) {
     return 0;
 }
 
-// ==================== ВИДЕОФУНКЦИИ ====================
-
-// Очистка экрана
-void clear_screen(uint8_t color) {
-    uint16_t blank = (color << 8) | ' ';
-    for(int i = 0; i < WIDTH * HEIGHT; i++) {
-        video_mem[i] = blank;
-    }
-}
-
-// Вывод строки
-void print_string(const char* str, uint8_t x, uint8_t y, uint8_t color) {
-    uint16_t* location = video_mem + y * WIDTH + x;
-    while(*str) {
-        *location++ = (color << 8) | *str++;
-    }
-}
-
-// Вывод символа
-void print_char(char c, uint8_t x, uint8_t y, uint8_t color) {
-    video_mem[y * WIDTH + x] = (color << 8) | c;
-}
-
 // ==================== ИНТЕРФЕЙС ====================
 
 // Отрисовка интерфейса
@@ -1594,6 +1919,11 @@ void show_right_panel(void) {
             print_string("Will load first sector (512 bytes)", 22, 5, 0x0F);
             print_string("and transfer control to it", 22, 6, 0x0F);
             print_string("Press Enter to boot", 22, 8, 0x2);
+            print_string("Disks found:", 22, 10, 0x0F);
+            for (uint8_t i = 0; i < blockdev_count() && i < 8; i++) {
+                print_string(blockdev_get(i)->name, 22 + (i % 4) * 8, 11 + i / 4, 0x0F);
+            }
+            if (!blockdev_count()) print_string("none", 35, 10, 0x0F);
             break;
             
         case 1: // Hardware Test
@@ -1634,9 +1964,19 @@ void show_right_panel(void) {
     cmos_display_time();
     cmos_display_date();
     cmos_update_display();
-    print_string("VGA 640x480 16-color", 22, 6, 0x0F);
+    if (gfx_active()) {
+        print_string("Video: DISPI 640x480x32 LFB", 22, 6, 0x0F);
+    } else if (gfx_available()) {
+        print_string("Video: VGA text 80x25, DISPI", 22, 6, 0x0F);
+    } else {
+        print_string("Video: VGA text 80x25", 22, 6, 0x0F);
+    }
     print_string("BIOS: WexIB v" BIOS_VERSION "   " SERIAL_NUMBER, 22, 7, 0x0F);
-    print_string("DUAL BOOT: OFF", 22, 8, 0x0F); 
+    if (partition_bootable_count() >= 2) {
+        kprintf(22, 8, 0x0F, "DUAL BOOT: ON (%u systems)", partition_bootable_count());
+    } else {
+        print_string("DUAL BOOT: OFF", 22, 8, 0x0F);
+    }
     print_string("Security: ", 22, 9, 0x0F);
     if (bios_settings.security_enabled) {
         print_string("ENABLED", 33, 9, 0x0F);
@@ -1646,8 +1986,7 @@ void show_right_panel(void) {
     print_string("Boot Order: ", 22, 10, 0x0F);
     print_string(boot_device_names[bios_settings.boot_devices[0]], 34, 10, 0x0F);
     
-    print_string("Hardware Errors: ", 22, 11, 0x0F);
-    print_char('0' + bios_settings.hw_error_count, 39, 11, 0x0F);
+    kprintf(22, 11, 0x0F, "Hardware Errors: %-3u", bios_settings.hw_error_count);
     
     print_string("Build: " BIOS_DATE, 22, 12, 0x0F);
     
@@ -1660,6 +1999,28 @@ void show_right_panel(void) {
     
     print_string("RTC:", 22, 14, 0x0F);
     print_string("Active", 27, 14, 0x0A);
+
+    for (uint8_t drive = 0; drive < ATA_MAX_DRIVES; drive++) {
+        const ata_identify_t* disk_info = ata_identify(drive);
+        char dma_mode[8];
+
+        if (ata_drive_atapi(drive)) {
+            kprintf(22, 15 + drive, 0x0F, "IDE%u: ATAPI CD/DVD", drive);
+        } else if (disk_info) {
+            if (disk_info->udma_mode != ATA_MODE_NONE) {
+                ksnprintf(dma_mode, sizeof(dma_mode), "UDMA%u", disk_info->udma_mode);
+            } else if (disk_info->mdma_mode != ATA_MODE_NONE) {
+                ksnprintf(dma_mode, sizeof(dma_mode), "MDMA%u", disk_info->mdma_mode);
+            } else {
+                ksnprintf(dma_mode, sizeof(dma_mode), "no DMA");
+            }
+            kprintf(22, 15 + drive, 0x0F, "IDE%u: %-16.16s %6u MB %s PIO%u %s", drive,
+                    disk_info->model[0] ? disk_info->model : "ATA disk", (uint32_t)(disk_info->sectors >> 11),
+                    disk_info->lba48 ? "LBA48" : "LBA28", disk_info->pio_mode, dma_mode);
+        } else {
+            kprintf(22, 15 + drive, 0x0F, "IDE%u: none", drive);
+        }
+    }
     break;
     
     case 5: // USB Boot
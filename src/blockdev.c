@@ -0,0 +1,80 @@
+#include "blockdev.h"
+#include "image.h"
+#include "bcache.h"
+
+static blockdev_t* devices[BLOCKDEV_MAX];
+static uint8_t device_count = 0;
+static blockdev_t* boot_device = 0;
+static uint8_t boot_selected = 0;
+
+uint8_t blockdev_register(blockdev_t* dev) {
+    if (device_count >= BLOCKDEV_MAX) return 0;
+
+    devices[device_count++] = dev;
+    boot_selected = 0;
+    return 1;
+}
+
+uint8_t blockdev_count(void) {
+    return device_count;
+}
+
+blockdev_t* blockdev_get(uint8_t index) {
+    return index < device_count ? devices[index] : 0;
+}
+
+blockdev_t* blockdev_find_type(uint8_t type, uint8_t index) {
+    for (uint8_t i = 0; i < device_count; i++) {
+        if (devices[i]->type != type) continue;
+        if (index == 0) return devices[i];
+        index--;
+    }
+    return 0;
+}
+
+uint8_t blockdev_bios_drive(blockdev_t* dev) {
+    for (uint8_t i = 0; i < device_count; i++) {
+        if (devices[i] == dev) return 0x80 + i;
+    }
+    return 0x80;
+}
+
+uint8_t blockdev_read(blockdev_t* dev, uint32_t lba, uint32_t count, void* buffer) {
+    if (!dev || !count) return 0;
+    if (dev->sectors && (lba >= dev->sectors || count > dev->sectors - lba)) return 0;
+    return bcache_read(dev, lba, count, buffer);
+}
+
+uint8_t blockdev_holds_firmware(blockdev_t* dev) {
+    static uint8_t sector[IMAGE_SECTOR_SIZE] __attribute__((aligned(4)));
+
+    return blockdev_read(dev, IMAGE_HEADER_LBA, 1, sector) &&
+           ((image_header_t*)sector)->magic == IMAGE_MAGIC;
+}
+
+blockdev_t* blockdev_boot(void) {
+    if (boot_selected) return boot_device;
+
+    boot_selected = 1;
+    boot_device = device_count ? devices[0] : 0;
+    for (uint8_t i = 0; i < device_count; i++) {
+        if (!blockdev_holds_firmware(devices[i])) {
+            boot_device = devices[i];
+            break;
+        }
+    }
+    return boot_device;
+}
+
+void blockdev_select_boot(blockdev_t* dev) {
+    boot_device = dev;
+    boot_selected = 1;
+}
+
+uint8_t read_disk_sectors(uint32_t lba, uint32_t count, void* buffer) {
+    return blockdev_read(blockdev_boot(), lba, count, buffer);
+}
+
+uint8_t read_disk_sector(uint32_t lba, uint16_t* buffer) {
+    return read_disk_sectors(lba, 1, buffer);
+}
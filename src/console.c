@@ -1,48 +1,206 @@
 #include "console.h"
 #include "post.h"
+#include "timeline.h"
+#include "timer.h"
+#include "screen.h"
+#include "gfx.h"
+#include "kprintf.h"
+#include "serial.h"
+#include "trace.h"
+#include "ata.h"
+#include "bcache.h"
 
-// Debug console state
-static uint8_t debug_line = 3;
+// Scrollback ring: the last DEBUG_SCROLLBACK_LINES lines live in RAM.
+// VGA text memory (32K = DEBUG_STRIP_ROWS rows) holds a contiguous strip
+// of them; scrolling just moves the CRTC start address along the strip.
+#define DEBUG_SCROLLBACK_LINES 1000
+#define DEBUG_COLS             SCREEN_WIDTH
+#define DEBUG_ROWS             SCREEN_HEIGHT
+#define DEBUG_STRIP_ROWS       (0x8000 / 2 / DEBUG_COLS)
+
+#define KEY_PGUP 0x49
+#define KEY_PGDN 0x51
+#define KEY_HOME 0x47
+#define KEY_END  0x4F
+
+static char sb_text[DEBUG_SCROLLBACK_LINES][DEBUG_COLS + 1];
+static uint8_t sb_color[DEBUG_SCROLLBACK_LINES];
+static uint32_t sb_count = 0;       // lines logged in total
+
+// Strip: line strip_first is at VGA row 0, strip_rows lines follow it
+static uint32_t strip_first = 0;
+static uint32_t strip_rows = 0;
+static uint32_t page_first = 0;     // first line of the current page
+static uint32_t view_top = 0;       // line shown on the top screen row
+static uint8_t console_active = 0;
+
+static uint32_t oldest_line(void) {
+    return sb_count > DEBUG_SCROLLBACK_LINES ? sb_count - DEBUG_SCROLLBACK_LINES : 0;
+}
+
+static void strip_write_row(uint32_t row, uint32_t line) {
+    volatile uint16_t* dst = (volatile uint16_t*)SCREEN_VIDEO_MEMORY + row * DEBUG_COLS;
+    uint16_t blank = 0x0720;
+    
+    if (line >= sb_count) {
+        for (int x = 0; x < DEBUG_COLS; x++) dst[x] = blank;
+        return;
+    }
+    
+    const char* text = sb_text[line % DEBUG_SCROLLBACK_LINES];
+    uint16_t attr = sb_color[line % DEBUG_SCROLLBACK_LINES] << 8;
+    int x = 0;
+    for (; x < DEBUG_COLS && text[x]; x++) dst[x] = attr | (uint8_t)text[x];
+    for (; x < DEBUG_COLS; x++) dst[x] = blank;
+}
+
+// Re-render the strip starting at the given line (rare: paging far back,
+// or the strip reaching the end of VGA memory)
+static void strip_rebase(uint32_t first) {
+    strip_first = first;
+    strip_rows = 0;
+    for (uint32_t row = 0; row < DEBUG_ROWS; row++) {
+        strip_write_row(row, first + row);
+        if (first + row < sb_count) strip_rows++;
+    }
+}
+
+static void show_view(uint32_t top) {
+    if (top < strip_first || top + DEBUG_ROWS > strip_first + DEBUG_STRIP_ROWS ||
+        top > strip_first + strip_rows) {
+        strip_rebase(top);
+    }
+    
+    // Extend the strip down to the bottom of the page (blank past the tail)
+    for (uint32_t line = strip_first + strip_rows; line < top + DEBUG_ROWS; line++) {
+        strip_write_row(line - strip_first, line);
+        if (line < sb_count) strip_rows++;
+    }
+    
+    view_top = top;
+    screen_set_start((top - strip_first) * DEBUG_COLS);
+}
+
+static void console_acquire(void) {
+    if (console_active) return;
+    
+    screen_flush();
+    screen_suspend();
+    serial_console_clear();
+    console_active = 1;
+}
+
+// Hand the screen back to the shadow framebuffer
+void debug_console_release(void) {
+    if (!console_active) return;
+    
+    console_active = 0;
+    screen_resume();
+}
 
 void clear_debug_screen(void) {
-    debug_line = 3;
-    clear_screen(0x00); // Черный фон
+    console_acquire();
+    
+    // New page: history stays reachable with PgUp
+    // (over serial the terminal's own scrollback keeps it)
+    serial_console_clear();
+    page_first = sb_count;
+    strip_rebase(page_first);
+    show_view(page_first);
+}
+
+// Commit the line already written into its ring slot
+static void log_debug_commit(uint8_t color) {
+    uint32_t line = sb_count;
+    
+    serial_console_line(sb_text[line % DEBUG_SCROLLBACK_LINES], color);
+    sb_color[line % DEBUG_SCROLLBACK_LINES] = color;
+    sb_count++;
+    
+    // Keep the strip contiguous; wrap to its start when VGA memory runs out
+    if (line != strip_first + strip_rows || strip_rows >= DEBUG_STRIP_ROWS) {
+        uint32_t first = line >= DEBUG_ROWS - 1 ? line - (DEBUG_ROWS - 1) : 0;
+        if (first < page_first) first = page_first;
+        strip_rebase(first);
+    } else {
+        strip_write_row(strip_rows, line);
+        strip_rows++;
+    }
+    
+    // Follow the tail of the log
+    uint32_t top = sb_count > page_first + DEBUG_ROWS ? sb_count - DEBUG_ROWS : page_first;
+    show_view(top);
 }
 
 void log_debug_message(const char* message, uint8_t color) {
-    if (debug_line >= 24) {
-        // Simple scroll - just reset
-        clear_debug_screen();
-        print_string("=== BIOS DEBUG CONSOLE ===", 25, 0, DEBUG_COLOR_INFO);
-        print_string("F1:POST  F2:CMOS  F3:Memory  F4:CPU  ESC:Exit", 15, 1, DEBUG_COLOR_NORMAL);
+    char* text = sb_text[sb_count % DEBUG_SCROLLBACK_LINES];
+    int len = 0;
+    
+    console_acquire();
+    
+    while (len < DEBUG_COLS && message[len]) {
+        text[len] = message[len];
+        len++;
     }
+    text[len] = '\0';
+    log_debug_commit(color);
+}
+
+// Formats straight into the ring slot
+void log_debugf(uint8_t color, const char* fmt, ...) {
+    va_list args;
+    
+    console_acquire();
     
-    print_string(message, 0, debug_line, color);
-    debug_line++;
+    va_start(args, fmt);
+    kvsnprintf(sb_text[sb_count % DEBUG_SCROLLBACK_LINES], DEBUG_COLS + 1, fmt, args);
+    va_end(args);
+    log_debug_commit(color);
 }
 
-void log_debug_hex(const char* label, uint32_t value, uint8_t color) {
-    char buffer[64];
-    char hex_chars[] = "0123456789ABCDEF";
-    char hex[9];
+// Page through the scrollback; returns 1 if the key was a paging key
+uint8_t debug_console_scroll(uint8_t scancode) {
+    uint32_t top = view_top;
+    uint32_t oldest = oldest_line();
+    uint32_t newest = sb_count > page_first + DEBUG_ROWS ? sb_count - DEBUG_ROWS : page_first;
     
-    for(int i = 7; i >= 0; i--) {
-        hex[i] = hex_chars[value & 0xF];
-        value >>= 4;
+    if (!console_active) return 0;
+    
+    switch (scancode) {
+        case KEY_PGUP:
+            top = top > oldest + (DEBUG_ROWS - 1) ? top - (DEBUG_ROWS - 1) : oldest;
+            break;
+        case KEY_PGDN:
+            top += DEBUG_ROWS - 1;
+            if (top > newest) top = newest;
+            break;
+        case KEY_HOME:
+            top = oldest;
+            break;
+        case KEY_END:
+            top = newest;
+            break;
+        default:
+            return 0;
     }
-    hex[8] = '\0';
-    
-    // Format: "Label: 0x12345678"
-    int pos = 0;
-    while (*label) buffer[pos++] = *label++;
-    buffer[pos++] = ':';
-    buffer[pos++] = ' ';
-    buffer[pos++] = '0';
-    buffer[pos++] = 'x';
-    for(int i = 0; i < 8; i++) buffer[pos++] = hex[i];
-    buffer[pos] = '\0';
-    
-    log_debug_message(buffer, color);
+    
+    show_view(top);
+    return 1;
+}
+
+// Wait for a key that is not a paging key
+uint8_t debug_console_wait_key(void) {
+    uint8_t scancode;
+    
+    do {
+        scancode = keyboard_wait_press();
+    } while (debug_console_scroll(scancode));
+    
+    return scancode;
+}
+
+void log_debug_hex(const char* label, uint32_t value, uint8_t color) {
+    log_debugf(color, "%s: 0x%08X", label, value);
 }
 
 void dump_memory_map(void) {
@@ -104,7 +262,6 @@ void dump_cmos_registers(void) {
     log_debug_message("CMOS Dump (first 32 bytes):", DEBUG_COLOR_INFO);
     
     for (uint8_t reg = 0; reg < 32; reg++) {
-        char line[32];
         uint8_t value;
         
         __asm__ volatile(
@@ -114,39 +271,154 @@ void dump_cmos_registers(void) {
             : "a"(reg)
         );
         
-        line[0] = '0'; line[1] = 'x';
-        line[2] = (reg >> 4) < 10 ? (reg >> 4) + '0' : (reg >> 4) - 10 + 'A';
-        line[3] = (reg & 0xF) < 10 ? (reg & 0xF) + '0' : (reg & 0xF) - 10 + 'A';
-        line[4] = ':'; line[5] = ' ';
-        line[6] = '0'; line[7] = 'x';
-        line[8] = (value >> 4) < 10 ? (value >> 4) + '0' : (value >> 4) - 10 + 'A';
-        line[9] = (value & 0xF) < 10 ? (value & 0xF) + '0' : (value & 0xF) - 10 + 'A';
-        line[10] = '\0';
-        
-        log_debug_message(line, DEBUG_COLOR_DEBUG);
+        log_debugf(DEBUG_COLOR_DEBUG, "0x%02X: 0x%02X", reg, value);
+    }
+}
+
+void show_screen_stats(void) {
+    const screen_stats_t* stats = screen_get_stats();
+    
+    log_debug_hex("Frames flushed", stats->frames, DEBUG_COLOR_DEBUG);
+    log_debug_hex("Cells last frame", stats->cells_last, DEBUG_COLOR_DEBUG);
+    log_debug_hex("Cells peak frame", stats->cells_peak, DEBUG_COLOR_DEBUG);
+    log_debug_hex("Cells flushed total", stats->cells_total, DEBUG_COLOR_DEBUG);
+    log_debug_hex("Cells drawn total", stats->cells_drawn, DEBUG_COLOR_DEBUG);
+}
+
+static void log_bench_result(const gfx_bench_result_t* result) {
+    log_debug_message(result->sse2 ? "SSE2 (movntdq):" : "Scalar:", DEBUG_COLOR_INFO);
+    log_debugf(DEBUG_COLOR_DEBUG, "  Fill: %u.%u MP/s",
+               result->fill_mpps_x10 / 10, result->fill_mpps_x10 % 10);
+    log_debugf(DEBUG_COLOR_DEBUG, "  Blit from RAM: %u.%u MP/s",
+               result->blit_mpps_x10 / 10, result->blit_mpps_x10 % 10);
+    log_debugf(DEBUG_COLOR_DEBUG, "  Glyphs: %u.%u MP/s",
+               result->glyph_mpps_x10 / 10, result->glyph_mpps_x10 % 10);
+    log_debugf(result->redraw_us < 16666 ? DEBUG_COLOR_SUCCESS : DEBUG_COLOR_WARNING,
+               "  Full 80x25 redraw: %u us (60 Hz frame: 16666 us)", result->redraw_us);
+}
+
+void run_graphics_benchmark(void) {
+    gfx_bench_result_t sse2, scalar;
+
+    if (!gfx_available()) {
+        log_debug_message("DISPI adapter not found (needs Bochs/QEMU std VGA)", DEBUG_COLOR_ERROR);
+        return;
+    }
+
+    log_debug_message("Benchmarking 640x480x32 LFB...", DEBUG_COLOR_WARNING);
+    gfx_enter();
+    gfx_benchmark(1, &sse2);
+    gfx_benchmark(0, &scalar);
+    gfx_leave();
+
+    // The framebuffer shares video memory with the text strip
+    strip_rebase(view_top);
+    show_view(view_top);
+
+    if (gfx_sse2()) {
+        log_bench_result(&sse2);
+    } else {
+        log_debug_message("SSE2 not supported by CPU", DEBUG_COLOR_WARNING);
+    }
+    log_bench_result(&scalar);
+}
+
+static void log_disk_result(const char* name, uint32_t us, uint32_t mbps_x10) {
+    log_debugf(DEBUG_COLOR_DEBUG, "  %-32s %8u us  %u.%u MB/s", name, us, mbps_x10 / 10, mbps_x10 % 10);
+}
+
+void run_disk_benchmark(void) {
+    ata_bench_result_t result;
+
+    if (!ata_present()) {
+        log_debug_message("No ATA disk on the IDE channels", DEBUG_COLOR_ERROR);
+        return;
+    }
+
+    log_debugf(DEBUG_COLOR_WARNING, "Reading %u KB three times from the first IDE disk...", ATA_BENCH_BYTES / 1024);
+    uint8_t ok = ata_benchmark(&result);
+
+    log_debugf(DEBUG_COLOR_INFO, "Disk: IDE%u (%s), %u sectors, READ MULTIPLE block: %u sectors",
+               result.drive, ata_drive_position(result.drive), ata_total_sectors(result.drive), result.multiple);
+    log_disk_result("READ SECTORS, inw per word:", result.single_us, result.single_mbps_x10);
+    log_disk_result(result.multiple ? "READ MULTIPLE, rep insw per block:" : "READ SECTORS, rep insw:",
+                    result.multi_us, result.multi_mbps_x10);
+    if (result.dma_us) {
+        log_disk_result("Bus master DMA, IRQ14 + hlt:", result.dma_us, result.dma_mbps_x10);
+    } else {
+        log_debug_message("  Bus master DMA not available", DEBUG_COLOR_WARNING);
+    }
+    if (!ok) {
+        log_debug_message("Read error, results are partial", DEBUG_COLOR_ERROR);
+    } else if (result.single_us) {
+        uint32_t best = result.dma_us && result.dma_us < result.multi_us ? result.dma_us : result.multi_us;
+        if (!best) best = 1;
+        log_debugf(DEBUG_COLOR_SUCCESS, "Speedup: %u.%ux", result.single_us / best,
+                   result.single_us * 10 / best % 10);
+    }
+}
+
+void show_block_cache_stats(void) {
+    bcache_stats_t stats;
+    uint32_t lookups;
+
+    bcache_get_stats(&stats);
+    lookups = stats.hits + stats.misses;
+
+    log_debugf(DEBUG_COLOR_INFO, "Block cache: %u sets x %u ways, %u of %u lines used",
+               BCACHE_SETS, BCACHE_WAYS, stats.lines_used, BCACHE_SETS * BCACHE_WAYS);
+    log_debugf(DEBUG_COLOR_DEBUG, "  Hits:      %8u sectors", stats.hits);
+    log_debugf(DEBUG_COLOR_DEBUG, "  Misses:    %8u sectors", stats.misses);
+    log_debugf(DEBUG_COLOR_DEBUG, "  Evictions: %8u", stats.evictions);
+    log_debugf(DEBUG_COLOR_DEBUG, "  Bypassed:  %8u reads over %u sectors", stats.bypassed, BCACHE_MAX_REQUEST);
+    if (lookups) {
+        log_debugf(DEBUG_COLOR_SUCCESS, "Hit rate: %u%%", stats.hits * 100 / lookups);
     }
 }
 
+#define TRACE_SHOW_RECORDS 18
+
+// Last records on screen, then the whole unread part of the ring to
+// serial/debugcon for tools/trace_decode.py
+void show_trace_buffer(void) {
+    uint32_t end = trace_count();
+    uint32_t first = end > TRACE_SHOW_RECORDS ? end - TRACE_SHOW_RECORDS : 0;
+    trace_record_t record, base;
+    
+    log_debugf(DEBUG_COLOR_INFO, "Trace: %u events, ring %u", end, TRACE_RING_SIZE);
+    log_debug_message("     +us  sys   event  arg0      arg1", DEBUG_COLOR_NORMAL);
+    
+    if (!trace_get(first, &base)) return;
+    for (uint32_t seq = first; seq < end; seq++) {
+        if (!trace_get(seq, &record)) continue;
+        log_debugf(record.level <= TRACE_WARN ? DEBUG_COLOR_WARNING : DEBUG_COLOR_DEBUG,
+                   "%8u  %-5s %04X   %08X  %08X",
+                   timer_cycles_to_us(record.tsc - base.tsc), trace_subsystem_name(record.subsystem),
+                   record.event, record.arg0, record.arg1);
+    }
+    
+    uint32_t sent = trace_drain(TRACE_OUT_SERIAL | TRACE_OUT_DEBUGCON);
+    log_debugf(DEBUG_COLOR_SUCCESS, "Exported %u records to serial/debugcon", sent);
+}
+
 void debug_console(void) {
     clear_debug_screen();
-    print_string("=== BIOS DEBUG CONSOLE ===", 25, 0, DEBUG_COLOR_INFO);
-    print_string("F1:POST  F2:CMOS  F3:Memory  F4:CPU  ESC:Exit", 15, 1, DEBUG_COLOR_NORMAL);
+    log_debug_message("                         === BIOS DEBUG CONSOLE ===", DEBUG_COLOR_INFO);
+    log_debug_message("F1:POST  F2:CMOS  F3:Memory  F4:CPU  F5:Screen  PgUp/PgDn:Scroll  ESC:Exit", DEBUG_COLOR_NORMAL);
+    log_debug_message("", DEBUG_COLOR_NORMAL);
     
     log_debug_message("Debug console ready", DEBUG_COLOR_SUCCESS);
     
     while(1) {
-        uint8_t scancode = keyboard_read();
-        if (scancode == 0) {
-            delay(10000);
-            continue;
-        }
-        
-        if (scancode & 0x80) continue;
+        uint8_t scancode = debug_console_wait_key();
         
         switch(scancode) {
             case 0x3B: // F1 - Run POST
                 log_debug_message(">>> Running POST...", DEBUG_COLOR_WARNING);
                 uint8_t post_result = run_post();
+                // The POST video test writes VGA memory directly
+                strip_rebase(view_top);
+                show_view(view_top);
                 if (post_result == 0) {
                     log_debug_message("POST: SUCCESS", DEBUG_COLOR_SUCCESS);
                 } else {
@@ -170,9 +442,15 @@ void debug_console(void) {
                 show_system_registers();
                 break;
                 
+            case 0x3F: // F5 - Shadow framebuffer stats
+                log_debug_message(">>> Screen flush stats...", DEBUG_COLOR_WARNING);
+                show_screen_stats();
+                break;
+                
             case KEY_ESC:
                 log_debug_message("Exiting debug console...", DEBUG_COLOR_INFO);
-                delay(300000);
+                mdelay(300);
+                debug_console_release();
                 return;
         }
     }
@@ -184,9 +462,14 @@ void dev_tools_menu(void) {
         "Debug Console",
         "System Registers", 
         "Memory Map",
-        "CMOS Dump"
+        "CMOS Dump",
+        "Boot Timeline",
+        "Graphics Benchmark",
+        "Trace Buffer",
+        "Disk Benchmark",
+        "Block Cache"
     };
-    const int items_count = 4;
+    const int items_count = 9;
     
     clear_screen(0x00); // Черный фон
     print_string("DEVELOPER TOOLS", 35, 1, 0x0F);
@@ -202,11 +485,7 @@ void dev_tools_menu(void) {
         
         print_string("ENTER: Select  ESC: Return", 25, 20, 0x07);
         
-        uint8_t scancode = keyboard_read();
-        if (scancode == 0) {
-            delay(10000);
-            continue;
-        }
+        uint8_t scancode = keyboard_wait();
         
         if (scancode & 0x80) continue;
         
@@ -226,21 +505,56 @@ void dev_tools_menu(void) {
                     log_debug_message("System Registers:", DEBUG_COLOR_INFO);
                     show_system_registers();
                     log_debug_message("Press any key...", DEBUG_COLOR_NORMAL);
-                    keyboard_read();
+                    debug_console_wait_key();
+                    debug_console_release();
                     break;
                 case 2: 
                     clear_debug_screen();
                     log_debug_message("Memory Map:", DEBUG_COLOR_INFO);
                     dump_memory_map();
                     log_debug_message("Press any key...", DEBUG_COLOR_NORMAL);
-                    keyboard_read();
+                    debug_console_wait_key();
+                    debug_console_release();
                     break;
                 case 3: 
                     clear_debug_screen();
                     log_debug_message("CMOS Dump:", DEBUG_COLOR_INFO);
                     dump_cmos_registers();
                     log_debug_message("Press any key...", DEBUG_COLOR_NORMAL);
-                    keyboard_read();
+                    debug_console_wait_key();
+                    debug_console_release();
+                    break;
+                case 4:
+                    timeline_show();
+                    break;
+                case 5:
+                    clear_debug_screen();
+                    log_debug_message("Graphics Benchmark:", DEBUG_COLOR_INFO);
+                    run_graphics_benchmark();
+                    log_debug_message("Press any key...", DEBUG_COLOR_NORMAL);
+                    debug_console_wait_key();
+                    debug_console_release();
+                    break;
+                case 6:
+                    clear_debug_screen();
+                    show_trace_buffer();
+                    log_debug_message("Press any key...", DEBUG_COLOR_NORMAL);
+                    debug_console_wait_key();
+                    debug_console_release();
+                    break;
+                case 7:
+                    clear_debug_screen();
+                    run_disk_benchmark();
+                    log_debug_message("Press any key...", DEBUG_COLOR_NORMAL);
+                    debug_console_wait_key();
+                    debug_console_release();
+                    break;
+                case 8:
+                    clear_debug_screen();
+                    show_block_cache_stats();
+                    log_debug_message("Press any key...", DEBUG_COLOR_NORMAL);
+                    debug_console_wait_key();
+                    debug_console_release();
                     break;
             }
             // Redraw menu
@@ -1,24 +1,8 @@
 #include "cpu.h"
 #include "console.h"
+#include "kprintf.h"
 #include <stdint.h>
 
-// Внешние функции
-extern void print_string(const char* str, uint8_t x, uint8_t y, uint8_t color);
-
-// Наши реализации строковых функций
-static void my_strcpy(char* dest, const char* src) {
-    while (*src) {
-        *dest++ = *src++;
-    }
-    *dest = '\0';
-}
-
-static int my_strlen(const char* str) {
-    int len = 0;
-    while (*str++) len++;
-    return len;
-}
-
 // Проверка наличия CPUID (для 486 и выше)
 static uint8_t cpu_has_cpuid(void) {
     uint32_t flags;
@@ -190,29 +174,18 @@ static cpu_type_t cpu_detect_type(void) {
 
 // Получение имени процессора
 static void cpu_get_name(cpu_info_t* info) {
+    const char* name;
+    
     switch(info->type) {
-        case CPU_8086:
-            my_strcpy(info->name, "Intel 8086");
-            break;
-        case CPU_8088:
-            my_strcpy(info->name, "Intel 8088");
-            break;
-        case CPU_80286:
-            my_strcpy(info->name, "Intel 80286");
-            break;
-        case CPU_80386:
-            my_strcpy(info->name, "Intel 80386");
-            break;
-        case CPU_80486:
-            my_strcpy(info->name, "Intel 80486");
-            break;
-        case CPU_PENTIUM:
-            my_strcpy(info->name, "Intel Pentium");
-            break;
-        default:
-            my_strcpy(info->name, "Unknown CPU");
-            break;
+        case CPU_8086:    name = "Intel 8086"; break;
+        case CPU_8088:    name = "Intel 8088"; break;
+        case CPU_80286:   name = "Intel 80286"; break;
+        case CPU_80386:   name = "Intel 80386"; break;
+        case CPU_80486:   name = "Intel 80486"; break;
+        case CPU_PENTIUM: name = "Intel Pentium"; break;
+        default:          name = "Unknown CPU"; break;
     }
+    ksnprintf(info->name, sizeof(info->name), "%s", name);
 }
 
 // Основная функция обнаружения
@@ -255,54 +228,78 @@ void cpu_detect(cpu_info_t* info) {
     }
 }
 
-// Вывод информации
-void cpu_print_info(const cpu_info_t* info, uint8_t x, uint8_t y, uint8_t color) {
-    char buffer[64];
+// Сигнатура процессора CPUID.1:EAX (семейство/модель/степпинг), 0 без CPUID
+uint32_t cpu_signature(void) {
+    uint32_t eax, ebx, ecx, edx;
     
-    // Формируем строку "CPU: [name]"
-    my_strcpy(buffer, "CPU: ");
-    my_strcpy(buffer + 5, info->name);
+    if (!cpu_has_cpuid()) {
+        return 0;
+    }
     
-    // Добавляем частоту если есть
-    if (info->speed_mhz > 0) {
-        int len = my_strlen(buffer);
-        char speed_str[16];
-        char* ptr = speed_str;
-        uint16_t speed = info->speed_mhz;
-        
-        // Конвертируем число в строку
-        if (speed >= 1000) {
-            *ptr++ = (speed / 1000) + '0';
-            speed %= 1000;
-            *ptr++ = (speed / 100) + '0';
-            speed %= 100;
-            *ptr++ = (speed / 10) + '0';
-            *ptr++ = (speed % 10) + '0';
-        } else if (speed >= 100) {
-            *ptr++ = (speed / 100) + '0';
-            speed %= 100;
-            *ptr++ = (speed / 10) + '0';
-            *ptr++ = (speed % 10) + '0';
-        } else if (speed >= 10) {
-            *ptr++ = (speed / 10) + '0';
-            *ptr++ = (speed % 10) + '0';
-        } else {
-            *ptr++ = speed + '0';
-        }
-        *ptr++ = 'M';
-        *ptr++ = 'H';
-        *ptr++ = 'z';
-        *ptr = '\0';
-        
-        // Добавляем к основной строке
-        buffer[len++] = ' ';
-        buffer[len++] = '(';
-        my_strcpy(buffer + len, speed_str);
-        len += my_strlen(speed_str);
-        buffer[len++] = ')';
-        buffer[len] = '\0';
+    __asm__ volatile (
+        ".code32\n"
+        "cpuid\n"
+        : "=a" (eax), "=b" (ebx), "=c" (ecx), "=d" (edx)
+        : "a" (1)
+        : "cc"
+    );
+    
+    return eax;
+}
+
+// MONITOR/MWAIT: CPUID.1:ECX[3]; в substates - CPUID.5:EDX (подсостояния C0..C7 по 4 бита)
+uint8_t cpu_has_mwait(uint32_t* substates) {
+    uint32_t eax, ebx, ecx, edx;
+    
+    *substates = 0;
+    if (!cpu_has_cpuid()) {
+        return 0;
+    }
+    
+    __asm__ volatile ("cpuid" : "=a" (eax), "=b" (ebx), "=c" (ecx), "=d" (edx) : "a" (0) : "cc");
+    if (eax < 5) {
+        return 0;
     }
     
-    // Выводим
-    print_string(buffer, x, y, color);
+    __asm__ volatile ("cpuid" : "=a" (eax), "=b" (ebx), "=c" (ecx), "=d" (edx) : "a" (1) : "cc");
+    if (!(ecx & (1 << 3))) {
+        return 0;
+    }
+    
+    __asm__ volatile ("cpuid" : "=a" (eax), "=b" (ebx), "=c" (ecx), "=d" (edx) : "a" (5) : "cc");
+    *substates = edx;
+    return 1;
+}
+
+// Включение SSE/SSE2 (CR0.EM=0, CR0.MP=1, CR4.OSFXSR, CR4.OSXMMEXCPT)
+uint8_t cpu_enable_sse2(void) {
+    uint32_t eax, ebx, ecx, edx, cr0, cr4;
+    
+    if (!cpu_has_cpuid()) {
+        return 0;
+    }
+    
+    __asm__ volatile ("cpuid" : "=a" (eax), "=b" (ebx), "=c" (ecx), "=d" (edx) : "a" (1) : "cc");
+    if ((edx & 0x07000000) != 0x07000000) {   // FXSR, SSE, SSE2
+        return 0;
+    }
+    
+    __asm__ volatile ("mov %%cr0, %0" : "=r" (cr0));
+    cr0 = (cr0 & ~0x04) | 0x02;
+    __asm__ volatile ("mov %0, %%cr0" : : "r" (cr0));
+    
+    __asm__ volatile ("mov %%cr4, %0" : "=r" (cr4));
+    cr4 |= (1 << 9) | (1 << 10);
+    __asm__ volatile ("mov %0, %%cr4" : : "r" (cr4));
+    
+    return 1;
+}
+
+// Вывод информации
+void cpu_print_info(const cpu_info_t* info, uint8_t x, uint8_t y, uint8_t color) {
+    if (info->speed_mhz > 0) {
+        kprintf(x, y, color, "CPU: %s (%uMHz)", info->name, info->speed_mhz);
+    } else {
+        kprintf(x, y, color, "CPU: %s", info->name);
+    }
 }
@@ -1,10 +1,36 @@
 #include "efficiency.h"
 #include "console.h"
 #include "ports.h" 
+#include "timer.h"
+#include "cpu.h"
+#include "interrupts.h"
+#include "kprintf.h"
 #include <stdint.h>
 
+// Окно для расчета загрузки CPU
+#define STATS_WINDOW_MS 1000
+
 // Определяем глобальные переменные
 power_mode_t current_power_mode = POWER_MODE_BALANCED;
+power_stats_t power_stats;
+
+// Параметры режимов; частота тика задает период пробуждения из простоя
+power_settings_t power_settings[4] = {
+    // имя               CPU  экран вент. USB HDD  экран boost тик   C
+    { "Max Performance", 100, 100,  100,  1,  0,   0,    1,    1000, 1 },
+    { "Balanced",        80,  80,   60,   1,  30,  120,  0,    100,  1 },
+    { "Power Saving",    60,  60,   40,   0,  10,  60,   0,    20,   2 },
+    { "Min Power",       40,  40,   20,   0,  5,   30,   0,    10,   3 }
+};
+
+// Состояние governor'а простоя
+static uint8_t mwait_supported = 0;
+static uint32_t mwait_substates = 0;
+static uint32_t mwait_hint = 0;
+static volatile uint32_t idle_monitor = 0;
+static uint64_t idle_cycles = 0;
+static uint64_t window_start = 0;
+static uint64_t window_idle_start = 0;
 
 // Названия режимов
 const char* power_mode_names[] = {
@@ -22,36 +48,20 @@ const char* power_mode_descriptions[] = {
     "Minimum power, basic functionality only"
 };
 
-// Вспомогательные функции
-static void int_to_str(uint32_t value, char* buffer) {
-    char* ptr = buffer;
-    char* ptr1 = buffer;
-    char tmp_char;
-    
-    // Конвертируем число в строку
-    do {
-        *ptr++ = '0' + (value % 10);
-        value /= 10;
-    } while (value);
-    
-    *ptr-- = '\0';
-    
-    // Разворачиваем строку
-    while(ptr1 < ptr) {
-        tmp_char = *ptr;
-        *ptr-- = *ptr1;
-        *ptr1++ = tmp_char;
-    }
-}
 
 void efficiency_init(void) {
     // Загружаем настройки из CMOS
-    outb(0x70, 0x30);
+    outb(0x70, CMOS_POWER_MODE);
     uint8_t saved_mode = inb(0x71);
     
     if (saved_mode <= POWER_MODE_MIN_POWER) {
         current_power_mode = (power_mode_t)saved_mode;
     }
+    
+    mwait_supported = cpu_has_mwait(&mwait_substates);
+    window_start = cpu_read_tsc();
+    window_idle_start = idle_cycles;
+    apply_power_settings();
 }
 
 void set_power_mode(power_mode_t mode) {
@@ -65,18 +75,71 @@ void set_power_mode(power_mode_t mode) {
 }
 
 void apply_power_settings(void) {
-    // Базовая реализация
-    switch(current_power_mode) {
-        case POWER_MODE_MAX_PERFORMANCE:
-            // Максимальная производительность
-            break;
-        case POWER_MODE_BALANCED:
-            // Сбалансированный режим
-            break;
-        case POWER_MODE_POWER_SAVING:
-        case POWER_MODE_MIN_POWER:
-            // Экономия энергии
+    power_settings_t* settings = &power_settings[current_power_mode];
+    
+    // Период пробуждения: реже тик - дольше сон между прерываниями
+    if (interrupts_active()) {
+        timer_start_tick(settings->idle_tick_hz);
+    }
+    
+    // Самое глубокое C-состояние не глубже целевого, у которого есть подсостояния
+    mwait_hint = 0;
+    for (uint8_t cstate = settings->idle_cstate; cstate > 1; cstate--) {
+        if ((mwait_substates >> (cstate * 4)) & 0x0F) {
+            mwait_hint = (uint32_t)(cstate - 1) << 4;
             break;
+        }
+    }
+}
+
+void power_idle(void) {
+    uint64_t start = cpu_read_tsc();
+    
+    if (mwait_supported) {
+        __asm__ volatile ("monitor" : : "a" (&idle_monitor), "c" (0), "d" (0));
+        __asm__ volatile ("sti; mwait" : : "a" (mwait_hint), "c" (0));
+    } else {
+        __asm__ volatile ("sti; hlt");
+    }
+    
+    idle_cycles += cpu_read_tsc() - start;
+}
+
+void update_power_stats(void) {
+    uint64_t now = cpu_read_tsc();
+    uint32_t window_ms = timer_cycles_to_ms(now - window_start);
+    
+    // TSC считает с момента сброса процессора
+    power_stats.total_uptime = timer_cycles_to_ms(now) / 1000;
+    power_stats.power_save_time = timer_cycles_to_ms(idle_cycles) / 1000;
+    
+    if (window_ms < STATS_WINDOW_MS) return;
+    
+    uint32_t idle_ms = timer_cycles_to_ms(idle_cycles - window_idle_start);
+    power_stats.cpu_usage = idle_ms >= window_ms ? 0 : 100 - idle_ms * 100 / window_ms;
+    
+    window_start = now;
+    window_idle_start = idle_cycles;
+}
+
+uint8_t estimate_cpu_usage(void) {
+    update_power_stats();
+    return power_stats.cpu_usage;
+}
+
+static void show_idle_stats(void) {
+    update_power_stats();
+    kprintf(25, 17, 0x07, "Uptime: %C%-5u%Cs  Idle: %C%-5u%Cs  CPU: %C%3u%C%%      ",
+            0x0F, power_stats.total_uptime, 0x07,
+            0x0F, power_stats.power_save_time, 0x07,
+            0x0F, power_stats.cpu_usage, 0x07);
+    
+    if (mwait_supported) {
+        kprintf(25, 18, 0x07, "Idle: MWAIT C%u  wakeup %C%-4u%CHz          ",
+                1 + (mwait_hint >> 4), 0x0F, power_settings[current_power_mode].idle_tick_hz, 0x07);
+    } else {
+        kprintf(25, 18, 0x07, "Idle: HLT  wakeup %C%-4u%CHz               ",
+                0x0F, power_settings[current_power_mode].idle_tick_hz, 0x07);
     }
 }
 
@@ -89,7 +152,7 @@ void power_management_menu(void) {
     
     while(1) {
         // Отрисовка меню
-        for(int i = 0; i < 4; i++) {
+        for(uint32_t i = 0; i < 4; i++) {
             uint8_t color = (i == selected) ? 0x1F : 0x07;
             if (i == selected) {
                 print_string(">", 25, 5 + i, color);
@@ -118,13 +181,11 @@ void power_management_menu(void) {
                     current_power_mode == POWER_MODE_BALANCED ? 0x0A :
                     current_power_mode == POWER_MODE_POWER_SAVING ? 0x0B : 0x0C);
         
+        show_idle_stats();
+        
         print_string("ENTER: Select  ESC: Return", 20, 20, 0x07);
         
-        uint8_t scancode = keyboard_read();
-        if (scancode == 0) {
-            delay(10000);
-            continue;
-        }
+        uint8_t scancode = keyboard_wait();
         
         if (scancode & 0x80) continue;
         
@@ -138,7 +199,7 @@ void power_management_menu(void) {
             set_power_mode(selected);
             
             // Обновляем галочки
-            for(int i = 0; i < 4; i++) {
+            for(uint32_t i = 0; i < 4; i++) {
                 print_string("    ", 50, 5 + i, 0x07);
                 if (i == current_power_mode) {
                     print_string("[X]", 50, 5 + i, 0x0A);
@@ -166,7 +227,7 @@ void cycle_power_mode(void) {
 }
 
 void auto_power_management(void) {
-    // Можно добавить автоматическое управление позже
+    update_power_stats();
 }
 
 void show_power_info(uint8_t x, uint8_t y) {
@@ -178,12 +239,12 @@ void show_power_info(uint8_t x, uint8_t y) {
 }
 
 void save_power_settings_to_cmos(void) {
-    outb(0x70, 0x30);
+    outb(0x70, CMOS_POWER_MODE);
     outb(0x71, current_power_mode);
 }
 
 void load_power_settings_from_cmos(void) {
-    outb(0x70, 0x30);
+    outb(0x70, CMOS_POWER_MODE);
     uint8_t saved_mode = inb(0x71);
     
     if (saved_mode <= POWER_MODE_MIN_POWER) {
@@ -0,0 +1,121 @@
+#include "eltorito.h"
+#include "ata.h"
+#include "realmode.h"
+#include "trace.h"
+#include "memmap.h"
+
+static uint8_t sector[ATAPI_SECTOR_SIZE] __attribute__((aligned(4)));
+
+static uint8_t match(const uint8_t* data, const char* text) {
+    while (*text) {
+        if (*data++ != (uint8_t)*text++) return 0;
+    }
+    return 1;
+}
+
+static uint8_t usable_entry(const eltorito_entry_t* entry, uint8_t platform) {
+    return entry->indicator == ELTORITO_BOOTABLE && platform == ELTORITO_PLATFORM_X86 &&
+           (entry->media & ELTORITO_MEDIA_MASK) == ELTORITO_MEDIA_NOEMU;
+}
+
+static void take_entry(eltorito_boot_t* boot, const eltorito_entry_t* entry) {
+    boot->load_segment = entry->load_segment ? entry->load_segment : ELTORITO_DEFAULT_SEGMENT;
+    boot->sectors = entry->sectors ? entry->sectors : ELTORITO_DEFAULT_SECTORS;
+    boot->load_rba = entry->load_rba;
+    boot->bytes = 0;
+}
+
+// Каталог обычно занимает один сектор (64 записи); дальше не читаем
+static uint8_t scan_catalog(eltorito_boot_t* boot) {
+    const eltorito_validation_t* validation = (const eltorito_validation_t*)sector;
+    uint16_t sum = 0;
+    uint32_t index = 2;
+
+    for (uint32_t i = 0; i < ELTORITO_ENTRY_SIZE; i += 2) {
+        sum += sector[i] | (sector[i + 1] << 8);
+    }
+    if (validation->header_id != ELTORITO_HEADER_ID || validation->key != ELTORITO_KEY || sum) return 0;
+
+    // Запись по умолчанию сразу за проверочной
+    if (usable_entry((const eltorito_entry_t*)(sector + ELTORITO_ENTRY_SIZE), validation->platform)) {
+        take_entry(boot, (const eltorito_entry_t*)(sector + ELTORITO_ENTRY_SIZE));
+        return 1;
+    }
+
+    while (index < ATAPI_SECTOR_SIZE / ELTORITO_ENTRY_SIZE) {
+        const eltorito_section_t* section = (const eltorito_section_t*)(sector + index * ELTORITO_ENTRY_SIZE);
+        uint16_t entries = section->entries;
+
+        if (section->indicator != ELTORITO_SECTION && section->indicator != ELTORITO_SECTION_LAST) break;
+        index++;
+
+        while (entries-- && index < ATAPI_SECTOR_SIZE / ELTORITO_ENTRY_SIZE) {
+            const eltorito_entry_t* entry = (const eltorito_entry_t*)(sector + index * ELTORITO_ENTRY_SIZE);
+
+            if (usable_entry(entry, section->platform)) {
+                take_entry(boot, entry);
+                return 1;
+            }
+            index++;
+            // Записи-расширения идут за своей записью
+            while (index < ATAPI_SECTOR_SIZE / ELTORITO_ENTRY_SIZE &&
+                   sector[index * ELTORITO_ENTRY_SIZE] == ELTORITO_EXTENSION) {
+                index++;
+            }
+        }
+        if (section->indicator == ELTORITO_SECTION_LAST) break;
+    }
+    return 0;
+}
+
+uint8_t eltorito_probe(uint8_t drive, eltorito_boot_t* boot) {
+    if (!atapi_read_sectors(drive, ELTORITO_BRVD_LBA, 1, sector)) return 0;
+
+    // Тип 0 (Boot Record), "CD001", версия 1
+    if (sector[0] != 0 || !match(sector + 1, "CD001") || sector[6] != 1 ||
+        !match(sector + 7, "EL TORITO SPECIFICATION")) {
+        return 0;
+    }
+
+    boot->drive = drive;
+    boot->catalog_lba = sector[ELTORITO_CATALOG_OFFSET] | (sector[ELTORITO_CATALOG_OFFSET + 1] << 8) |
+                        (sector[ELTORITO_CATALOG_OFFSET + 2] << 16) | (sector[ELTORITO_CATALOG_OFFSET + 3] << 24);
+    if (!atapi_read_sectors(drive, boot->catalog_lba, 1, sector)) return 0;
+    return scan_catalog(boot);
+}
+
+uint8_t eltorito_find(eltorito_boot_t* boot) {
+    for (uint8_t drive = 0; drive < ATA_MAX_DRIVES; drive++) {
+        if (ata_drive_atapi(drive) && eltorito_probe(drive, boot)) return 1;
+    }
+    return 0;
+}
+
+uint8_t eltorito_load(eltorito_boot_t* boot) {
+    uint32_t load = (uint32_t)boot->load_segment << 4;
+    uint32_t bytes = (uint32_t)boot->sectors * 512;
+    uint32_t count = (bytes + ATAPI_SECTOR_SIZE - 1) / ATAPI_SECTOR_SIZE;
+    void* buffer = memmap_scratch(count * ATAPI_SECTOR_SIZE);
+
+    // Образ должен лечь между заглушкой перехода и концом низкой памяти
+    if (load < REALMODE_LOAD_MIN || load + bytes > realmode_load_max()) return 0;
+    if (!buffer) return 0;
+
+    TRACE(BOOT, ELTORITO, boot->load_rba, ((uint32_t)boot->load_segment << 16) | boot->sectors);
+    if (!atapi_read_sectors(boot->drive, boot->load_rba, count, buffer)) return 0;
+    boot->bytes = bytes;
+    return 1;
+}
+
+void eltorito_jump(const eltorito_boot_t* boot) {
+    realmode_regs_t regs = {0};
+
+    regs.cs = boot->load_segment;
+    regs.ip = 0;
+    regs.sp = 0x7C00;
+    regs.edx = ELTORITO_BIOS_DRIVE;
+    regs.move_src = SCRATCH_ADDR;
+    regs.move_dest = (uint32_t)boot->load_segment << 4;
+    regs.move_bytes = boot->bytes;
+    realmode_jump(&regs);
+}
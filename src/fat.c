@@ -0,0 +1,415 @@
+#include "fat.h"
+
+// Сектор каталога или неполный сектор файла
+static uint8_t sector[FAT_SECTOR_SIZE] __attribute__((aligned(4)));
+
+// Окно таблицы FAT: цепочка большого файла проходится за несколько чтений,
+// а не по сектору таблицы на каждые 128 кластеров
+static uint8_t fat_window[FAT_WINDOW_SECTORS * FAT_SECTOR_SIZE] __attribute__((aligned(4)));
+static blockdev_t* window_dev = 0;
+static uint32_t window_lba = 0;
+static uint32_t window_count = 0;
+
+static void copy_bytes(void* dest, const void* src, uint32_t length) {
+    uint8_t* d = (uint8_t*)dest;
+    const uint8_t* s = (const uint8_t*)src;
+
+    while (length--) *d++ = *s++;
+}
+
+static char to_upper(char c) {
+    return (c >= 'a' && c <= 'z') ? c - 'a' + 'A' : c;
+}
+
+// Указатель на байт таблицы FAT со смещением offset; окно подчитывается
+static uint8_t* fat_byte(fat_volume_t* vol, uint32_t offset) {
+    uint32_t lba = vol->fat_start + offset / FAT_SECTOR_SIZE;
+    uint32_t end = vol->fat_start + vol->fat_sectors;
+
+    if (window_dev != vol->dev || lba < window_lba || lba >= window_lba + window_count) {
+        uint32_t count = FAT_WINDOW_SECTORS;
+
+        if (lba >= end) return 0;
+        if (count > end - lba) count = end - lba;
+        window_dev = 0;
+        if (!blockdev_read(vol->dev, lba, count, fat_window)) return 0;
+        window_dev = vol->dev;
+        window_lba = lba;
+        window_count = count;
+    }
+    return &fat_window[(lba - window_lba) * FAT_SECTOR_SIZE + offset % FAT_SECTOR_SIZE];
+}
+
+// Следующий кластер цепочки; 0 - конец цепочки, плохой кластер или ошибка
+static uint32_t fat_next(fat_volume_t* vol, uint32_t cluster) {
+    uint32_t next;
+    uint8_t* low;
+    uint8_t* high;
+    uint8_t low_byte;
+
+    if (cluster < FAT_FIRST_CLUSTER || cluster >= vol->clusters + FAT_FIRST_CLUSTER) return 0;
+
+    switch (vol->type) {
+        case FAT_TYPE_12:
+            // 12 бит на запись: запись может лежать на границе секторов
+            // Младший байт копируется до чтения старшего: тот может
+            // перезагрузить окно, и low будет указывать на другой сектор
+            low = fat_byte(vol, cluster + cluster / 2);
+            if (!low) return 0;
+            low_byte = *low;
+            high = fat_byte(vol, cluster + cluster / 2 + 1);
+            if (!high) return 0;
+            next = low_byte | (*high << 8);
+            next = (cluster & 1) ? next >> 4 : next & 0x0FFF;
+            break;
+        case FAT_TYPE_16:
+            low = fat_byte(vol, cluster * 2);
+            if (!low) return 0;
+            next = *(uint16_t*)low;
+            break;
+        default:
+            low = fat_byte(vol, cluster * 4);
+            if (!low) return 0;
+            next = *(uint32_t*)low & FAT_CLUSTER_MASK;
+            break;
+    }
+
+    // Значения конца цепочки и плохого кластера больше числа кластеров тома
+    if (next < FAT_FIRST_CLUSTER || next >= vol->clusters + FAT_FIRST_CLUSTER) return 0;
+    return next;
+}
+
+static uint32_t cluster_lba(fat_volume_t* vol, uint32_t cluster) {
+    return vol->data_start + (cluster - FAT_FIRST_CLUSTER) * vol->sectors_per_cluster;
+}
+
+uint8_t fat_mount(fat_volume_t* vol, blockdev_t* dev, uint32_t start) {
+    fat_bpb_t* bpb = (fat_bpb_t*)sector;
+    uint32_t fat_size, total, root_sectors, meta;
+
+    if (!dev || !blockdev_read(dev, start, 1, sector)) return 0;
+    if (*(uint16_t*)(sector + 510) != 0xAA55) return 0;
+    if (sector[0] != 0xEB && sector[0] != 0xE9) return 0;
+
+    // Только сектора по 512 байт: так читает blockdev
+    if (bpb->bytes_per_sector != FAT_SECTOR_SIZE || !bpb->reserved_sectors) return 0;
+    if (!bpb->sectors_per_cluster || (bpb->sectors_per_cluster & (bpb->sectors_per_cluster - 1))) return 0;
+    if (bpb->fat_count < 1 || bpb->fat_count > 2) return 0;
+
+    fat_size = bpb->fat_size16 ? bpb->fat_size16 : bpb->fat_size32;
+    total = bpb->total_sectors16 ? bpb->total_sectors16 : bpb->total_sectors32;
+    root_sectors = (bpb->root_entries * FAT_DIR_ENTRY_SIZE + FAT_SECTOR_SIZE - 1) / FAT_SECTOR_SIZE;
+    meta = bpb->reserved_sectors + bpb->fat_count * fat_size + root_sectors;
+    if (!fat_size || total <= meta) return 0;
+
+    vol->dev = dev;
+    vol->start = start;
+    vol->sectors_per_cluster = bpb->sectors_per_cluster;
+    vol->fat_start = start + bpb->reserved_sectors;
+    vol->fat_sectors = fat_size;
+    vol->root_start = vol->fat_start + bpb->fat_count * fat_size;
+    vol->root_sectors = root_sectors;
+    vol->data_start = vol->root_start + root_sectors;
+    vol->clusters = (total - meta) / bpb->sectors_per_cluster;
+    vol->root_cluster = 0;
+
+    if (vol->clusters < FAT12_MAX_CLUSTERS) {
+        vol->type = FAT_TYPE_12;
+    } else if (vol->clusters < FAT16_MAX_CLUSTERS) {
+        vol->type = FAT_TYPE_16;
+    } else {
+        if (bpb->fat_size16 || bpb->root_entries) return 0;
+        vol->type = FAT_TYPE_32;
+        vol->root_cluster = bpb->root_cluster;
+    }
+    return 1;
+}
+
+uint8_t fat_mount_partition(fat_volume_t* vol, const partition_t* part) {
+    return part && fat_mount(vol, part->dev, part->start);
+}
+
+uint8_t fat_mount_device(fat_volume_t* vol, blockdev_t* dev) {
+    for (uint8_t i = 0; i < partition_count(); i++) {
+        const partition_t* part = partition_get(i);
+
+        if (part->dev == dev && fat_mount_partition(vol, part)) return 1;
+    }
+    return fat_mount(vol, dev, 0);
+}
+
+uint8_t fat_mount_first(fat_volume_t* vol) {
+    for (uint8_t i = 0; i < partition_count(); i++) {
+        if (fat_mount_partition(vol, partition_get(i))) return 1;
+    }
+    // Флешки часто форматируют без таблицы разделов
+    for (uint8_t i = 0; i < blockdev_count(); i++) {
+        if (fat_mount(vol, blockdev_get(i), 0)) return 1;
+    }
+    return 0;
+}
+
+// ==================== КАТАЛОГИ ====================
+
+static uint8_t lfn_checksum(const char* name) {
+    uint8_t sum = 0;
+
+    for (int i = 0; i < 11; i++) {
+        sum = ((sum & 1) << 7) + (sum >> 1) + (uint8_t)name[i];
+    }
+    return sum;
+}
+
+// Имя 8.3 в виде записи каталога: "KERNEL  BIN"; 0 - не укладывается в 8.3
+static uint8_t make_short_name(const char* name, uint32_t length, char* out) {
+    uint32_t dot = length;
+    uint32_t i;
+
+    for (i = 0; i < 11; i++) out[i] = ' ';
+
+    // Имена "." и ".." записаны как есть
+    if (name[0] == '.' && (length == 1 || (length == 2 && name[1] == '.'))) {
+        for (i = 0; i < length; i++) out[i] = '.';
+        return 1;
+    }
+
+    for (i = 0; i < length; i++) {
+        if (name[i] == '.') dot = i;
+    }
+    if (dot == 0 || dot > 8 || (dot < length && length - dot - 1 > 3)) return 0;
+
+    for (i = 0; i < dot && i < 8; i++) out[i] = to_upper(name[i]);
+    for (i = dot + 1; i < length; i++) out[8 + i - dot - 1] = to_upper(name[i]);
+    return 1;
+}
+
+static uint8_t short_matches(const char* entry, const char* name) {
+    for (int i = 0; i < 11; i++) {
+        if (to_upper(entry[i]) != name[i]) return 0;
+    }
+    return 1;
+}
+
+// Часть длинного имени из одной записи LFN: 13 символов UCS-2
+static void lfn_collect(const uint8_t* entry, char* lfn) {
+    static const uint8_t offsets[13] = {1, 3, 5, 7, 9, 14, 16, 18, 20, 22, 24, 28, 30};
+    uint32_t base = ((entry[0] & 0x1F) - 1) * 13;
+
+    for (int i = 0; i < 13 && base + i < FAT_LFN_MAX; i++) {
+        uint16_t c = entry[offsets[i]] | (entry[offsets[i] + 1] << 8);
+
+        if (c == 0) {
+            lfn[base + i] = 0;
+            break;
+        }
+        // Вне ASCII - символ, который не совпадет с путем
+        lfn[base + i] = c < 0x80 ? to_upper((char)c) : (char)0xFF;
+    }
+}
+
+static uint8_t lfn_matches(const char* lfn, const char* name, uint32_t length) {
+    for (uint32_t i = 0; i < length; i++) {
+        if (lfn[i] != to_upper(name[i])) return 0;
+    }
+    return lfn[length] == 0;
+}
+
+// Поиск имени в каталоге; dir_cluster 0 - корневой
+static uint8_t find_entry(fat_volume_t* vol, uint32_t dir_cluster, const char* name, uint32_t length,
+                          fat_dirent_t* found) {
+    static char lfn[FAT_LFN_MAX + 1];
+    char short_name[11];
+    uint8_t has_short = make_short_name(name, length, short_name);
+    uint8_t lfn_sum = 0;
+    uint8_t lfn_valid = 0;
+    uint32_t cluster = dir_cluster;
+    uint32_t lba, sectors;
+
+    if (!cluster && vol->type == FAT_TYPE_32) cluster = vol->root_cluster;
+
+    while (1) {
+        if (cluster) {
+            lba = cluster_lba(vol, cluster);
+            sectors = vol->sectors_per_cluster;
+        } else {
+            lba = vol->root_start;
+            sectors = vol->root_sectors;
+        }
+
+        for (uint32_t s = 0; s < sectors; s++) {
+            if (!blockdev_read(vol->dev, lba + s, 1, sector)) return 0;
+
+            for (uint32_t offset = 0; offset < FAT_SECTOR_SIZE; offset += FAT_DIR_ENTRY_SIZE) {
+                uint8_t* raw = sector + offset;
+                fat_dirent_t* entry = (fat_dirent_t*)raw;
+
+                if (raw[0] == FAT_ENTRY_END) return 0;
+                if (raw[0] == FAT_ENTRY_FREE) {
+                    lfn_valid = 0;
+                    continue;
+                }
+                if ((entry->attributes & 0x3F) == FAT_ATTR_LFN) {
+                    // Записи LFN идут от последней к первой
+                    if (raw[0] & FAT_LFN_LAST) {
+                        uint32_t end = (raw[0] & 0x1F) * 13;
+                        lfn[end < FAT_LFN_MAX ? end : FAT_LFN_MAX] = 0;
+                        lfn_sum = raw[13];
+                        lfn_valid = 1;
+                    }
+                    if (lfn_valid && raw[13] == lfn_sum && (raw[0] & 0x1F)) lfn_collect(raw, lfn);
+                    continue;
+                }
+                if (entry->attributes & FAT_ATTR_VOLUME_ID) {
+                    lfn_valid = 0;
+                    continue;
+                }
+
+                if ((lfn_valid && lfn_sum == lfn_checksum(entry->name) && lfn_matches(lfn, name, length)) ||
+                    (has_short && short_matches(entry->name, short_name))) {
+                    copy_bytes(found, entry, sizeof(fat_dirent_t));
+                    return 1;
+                }
+                lfn_valid = 0;
+            }
+        }
+
+        // Корневой каталог FAT12/16 кончается вместе со своей областью
+        if (!cluster) return 0;
+        cluster = fat_next(vol, cluster);
+        if (!cluster) return 0;
+    }
+}
+
+static uint32_t entry_cluster(fat_volume_t* vol, const fat_dirent_t* entry) {
+    uint32_t cluster = entry->cluster_low;
+
+    if (vol->type == FAT_TYPE_32) cluster |= (uint32_t)entry->cluster_high << 16;
+    return cluster;
+}
+
+static uint8_t lookup(fat_volume_t* vol, const char* path, fat_stat_t* stat) {
+    fat_dirent_t entry;
+    uint32_t dir = 0;
+
+    // Сам корневой каталог
+    stat->size = 0;
+    stat->attributes = FAT_ATTR_DIRECTORY;
+    stat->first_cluster = vol->root_cluster;
+
+    while (*path) {
+        uint32_t length = 0;
+
+        while (*path == '/') path++;
+        if (!*path) break;
+        while (path[length] && path[length] != '/') length++;
+        if (length > FAT_LFN_MAX) return 0;
+
+        if (!(stat->attributes & FAT_ATTR_DIRECTORY)) return 0;
+        if (!find_entry(vol, dir, path, length, &entry)) return 0;
+
+        stat->size = entry.size;
+        stat->attributes = entry.attributes;
+        stat->first_cluster = entry_cluster(vol, &entry);
+        dir = stat->first_cluster;     // ".." на корень - кластер 0
+        path += length;
+    }
+    return 1;
+}
+
+uint8_t fat_stat(fat_volume_t* vol, const char* path, fat_stat_t* stat) {
+    return lookup(vol, path, stat);
+}
+
+uint8_t fat_open(fat_volume_t* vol, const char* path, fat_file_t* file) {
+    fat_stat_t stat;
+
+    if (!lookup(vol, path, &stat) || (stat.attributes & FAT_ATTR_DIRECTORY)) return 0;
+
+    file->vol = vol;
+    file->first_cluster = stat.first_cluster;
+    file->size = stat.size;
+    file->attributes = stat.attributes;
+    file->position = 0;
+    file->cluster = stat.first_cluster;
+    file->cluster_index = 0;
+    return 1;
+}
+
+// ==================== ЧТЕНИЕ ====================
+
+// Кластер с номером index в цепочке; вперед - от запомненного места
+static uint8_t seek_cluster(fat_file_t* file, uint32_t index) {
+    if (index < file->cluster_index || file->cluster < FAT_FIRST_CLUSTER) {
+        file->cluster = file->first_cluster;
+        file->cluster_index = 0;
+    }
+    while (file->cluster_index < index) {
+        uint32_t next = fat_next(file->vol, file->cluster);
+
+        if (!next) return 0;
+        file->cluster = next;
+        file->cluster_index++;
+    }
+    return file->cluster >= FAT_FIRST_CLUSTER;
+}
+
+uint32_t fat_read(fat_file_t* file, void* buffer, uint32_t bytes) {
+    fat_volume_t* vol = file->vol;
+    uint32_t cluster_bytes = vol->sectors_per_cluster * FAT_SECTOR_SIZE;
+    uint8_t* dest = (uint8_t*)buffer;
+    uint32_t done = 0;
+
+    if (file->position >= file->size) return 0;
+    if (bytes > file->size - file->position) bytes = file->size - file->position;
+
+    while (bytes) {
+        uint32_t offset = file->position % cluster_bytes;
+        uint32_t in_sector = file->position % FAT_SECTOR_SIZE;
+        uint32_t lba, chunk;
+
+        if (!seek_cluster(file, file->position / cluster_bytes)) break;
+        lba = cluster_lba(vol, file->cluster) + offset / FAT_SECTOR_SIZE;
+
+        if (in_sector || bytes < FAT_SECTOR_SIZE) {
+            // Начало или хвост не по границе сектора - через буфер
+            chunk = FAT_SECTOR_SIZE - in_sector;
+            if (chunk > bytes) chunk = bytes;
+            if (!blockdev_read(vol->dev, lba, 1, sector)) break;
+            copy_bytes(dest, sector + in_sector, chunk);
+        } else {
+            // Целые сектора: слитные кластеры цепочки - одной командой
+            uint32_t wanted = bytes / FAT_SECTOR_SIZE;
+            uint32_t run = vol->sectors_per_cluster - offset / FAT_SECTOR_SIZE;
+            uint32_t last = file->cluster;
+            uint32_t last_index = file->cluster_index;
+
+            while (run < wanted && run < FAT_MAX_RUN_SECTORS) {
+                uint32_t next = fat_next(vol, last);
+
+                if (next != last + 1) break;
+                last = next;
+                last_index++;
+                run += vol->sectors_per_cluster;
+            }
+            if (run > wanted) run = wanted;
+            if (run > FAT_MAX_RUN_SECTORS) run = FAT_MAX_RUN_SECTORS;
+
+            if (!blockdev_read(vol->dev, lba, run, dest)) break;
+            chunk = run * FAT_SECTOR_SIZE;
+            file->cluster = last;
+            file->cluster_index = last_index;
+        }
+
+        file->position += chunk;
+        dest += chunk;
+        bytes -= chunk;
+        done += chunk;
+    }
+    return done;
+}
+
+uint8_t fat_seek(fat_file_t* file, uint32_t position) {
+    if (position > file->size) return 0;
+    file->position = position;
+    return 1;
+}
@@ -0,0 +1,397 @@
+#include "gfx.h"
+#include "pci.h"
+#include "cpu.h"
+#include "timer.h"
+#include "ports.h"
+#include "memmap.h"
+
+// Регистры VGA для доступа к плоскости шрифта
+#define VGA_SEQ_INDEX   0x3C4
+#define VGA_SEQ_DATA    0x3C5
+#define VGA_GC_INDEX    0x3CE
+#define VGA_GC_DATA     0x3CF
+#define VGA_FONT_WINDOW 0xA0000
+#define VGA_FONT_STRIDE 32
+
+// Прогоны бенчмарка
+#define BENCH_FILL_ROUNDS   32
+#define BENCH_BLIT_ROUNDS   32
+#define BENCH_GLYPH_ROUNDS  16
+
+static uint8_t available = 0;
+static uint8_t active = 0;
+static uint8_t sse2_supported = 0;
+static uint8_t sse2_path = 0;
+static uint8_t font_ready = 0;
+static uint32_t* lfb = 0;
+
+// Шрифт 8x16 из ПЗУ адаптера и таблица развертки битов строки в маски пикселей
+static uint8_t font[256][GFX_CELL_HEIGHT];
+static uint32_t expand[256][8] __attribute__((aligned(16)));
+
+// Стандартная палитра текстового режима
+static const uint32_t palette[16] = {
+    0x000000, 0x0000AA, 0x00AA00, 0x00AAAA, 0xAA0000, 0xAA00AA, 0xAA5500, 0xAAAAAA,
+    0x555555, 0x5555FF, 0x55FF55, 0x55FFFF, 0xFF5555, 0xFF55FF, 0xFFFF55, 0xFFFFFF
+};
+
+static void dispi_write(uint16_t index, uint16_t value) {
+    outw(VBE_DISPI_IOPORT_INDEX, index);
+    outw(VBE_DISPI_IOPORT_DATA, value);
+}
+
+static uint16_t dispi_read(uint16_t index) {
+    outw(VBE_DISPI_IOPORT_INDEX, index);
+    return inw(VBE_DISPI_IOPORT_DATA);
+}
+
+static void vga_write(uint16_t index_port, uint8_t index, uint8_t value) {
+    outb(index_port, index);
+    outb(index_port + 1, value);
+}
+
+// Плоскость 2 (шрифт) открывается по адресу A0000 линейно
+static void vga_font_begin(void) {
+    vga_write(VGA_SEQ_INDEX, 0x00, 0x01);  // синхронный сброс
+    vga_write(VGA_SEQ_INDEX, 0x02, 0x04);  // запись только в плоскость 2
+    vga_write(VGA_SEQ_INDEX, 0x04, 0x07);  // последовательная адресация
+    vga_write(VGA_SEQ_INDEX, 0x00, 0x03);
+    vga_write(VGA_GC_INDEX, 0x04, 0x02);   // чтение плоскости 2
+    vga_write(VGA_GC_INDEX, 0x05, 0x00);   // без odd/even
+    vga_write(VGA_GC_INDEX, 0x06, 0x04);   // окно A0000, 64K
+}
+
+// Обратно к текстовому режиму: плоскости 0/1, odd/even, окно B8000
+static void vga_font_end(void) {
+    vga_write(VGA_SEQ_INDEX, 0x00, 0x01);
+    vga_write(VGA_SEQ_INDEX, 0x02, 0x03);
+    vga_write(VGA_SEQ_INDEX, 0x04, 0x03);
+    vga_write(VGA_SEQ_INDEX, 0x00, 0x03);
+    vga_write(VGA_GC_INDEX, 0x04, 0x00);
+    vga_write(VGA_GC_INDEX, 0x05, 0x10);
+    vga_write(VGA_GC_INDEX, 0x06, 0x0E);
+}
+
+static void font_capture(void) {
+    volatile uint8_t* plane = (volatile uint8_t*)VGA_FONT_WINDOW;
+
+    vga_font_begin();
+    for (int ch = 0; ch < 256; ch++) {
+        for (int row = 0; row < GFX_CELL_HEIGHT; row++) {
+            font[ch][row] = plane[ch * VGA_FONT_STRIDE + row];
+        }
+    }
+    vga_font_end();
+}
+
+// Видеопамять общая с линейным буфером - после графики шрифт затерт
+static void font_restore(void) {
+    volatile uint8_t* plane = (volatile uint8_t*)VGA_FONT_WINDOW;
+
+    vga_font_begin();
+    for (int ch = 0; ch < 256; ch++) {
+        for (int row = 0; row < VGA_FONT_STRIDE; row++) {
+            plane[ch * VGA_FONT_STRIDE + row] = row < GFX_CELL_HEIGHT ? font[ch][row] : 0;
+        }
+    }
+    vga_font_end();
+}
+
+uint8_t gfx_init(void) {
+    uint16_t id = dispi_read(VBE_DISPI_INDEX_ID);
+    const pci_device_t* dev;
+
+    if (id < VBE_DISPI_ID0 || id > VBE_DISPI_ID5) {
+        return 0;
+    }
+
+    dev = pci_find_device(BOCHS_VGA_VENDOR, BOCHS_VGA_DEVICE);
+    if (dev) {
+        pci_enable(dev, PCI_COMMAND_MEMORY);
+        lfb = (uint32_t*)pci_bar(dev, 0);
+    } else {
+        lfb = (uint32_t*)BOCHS_DEFAULT_LFB;
+    }
+
+    for (int b = 0; b < 256; b++) {
+        for (int i = 0; i < 8; i++) {
+            expand[b][i] = (b & (0x80 >> i)) ? 0xFFFFFFFF : 0;
+        }
+    }
+
+    sse2_supported = cpu_enable_sse2();
+    sse2_path = sse2_supported;
+    available = 1;
+    return 1;
+}
+
+uint8_t gfx_available(void) {
+    return available;
+}
+
+uint8_t gfx_active(void) {
+    return active;
+}
+
+uint8_t gfx_sse2(void) {
+    return sse2_supported;
+}
+
+uint8_t gfx_enter(void) {
+    if (!available) return 0;
+    if (active) return 1;
+
+    // Шрифт нужен только графическому меню: захват при первом входе,
+    // пока адаптер еще в текстовом режиме
+    if (!font_ready) {
+        font_capture();
+        font_ready = 1;
+    }
+
+    dispi_write(VBE_DISPI_INDEX_ENABLE, 0);
+    dispi_write(VBE_DISPI_INDEX_XRES, GFX_WIDTH);
+    dispi_write(VBE_DISPI_INDEX_YRES, GFX_HEIGHT);
+    dispi_write(VBE_DISPI_INDEX_BPP, GFX_BPP);
+    dispi_write(VBE_DISPI_INDEX_VIRT_WIDTH, GFX_WIDTH);
+    dispi_write(VBE_DISPI_INDEX_ENABLE, VBE_DISPI_ENABLED | VBE_DISPI_LFB_ENABLED);
+
+    active = 1;
+    gfx_fill_rect(0, 0, GFX_WIDTH, GFX_HEIGHT, palette[0]);
+    gfx_sync();
+    return 1;
+}
+
+void gfx_leave(void) {
+    if (!active) return;
+
+    dispi_write(VBE_DISPI_INDEX_ENABLE, 0);
+    font_restore();
+    active = 0;
+}
+
+void gfx_sync(void) {
+    if (sse2_supported) {
+        __asm__ volatile ("sfence" : : : "memory");
+    }
+}
+
+// ==================== СТРОКИ ПИКСЕЛЕЙ ====================
+// Сборка идет без -msse: компилятор xmm не использует, поэтому регистры
+// xmm в списках clobber не перечисляются (для такой цели gcc их не принимает)
+
+static void fill_row_scalar(uint32_t* dst, uint32_t count, uint32_t color) {
+    while (count--) *dst++ = color;
+}
+
+static void fill_row_sse2(uint32_t* dst, uint32_t count, uint32_t color) {
+    // До выравнивания на 16 байт
+    while (((uint32_t)dst & 15) && count) {
+        *dst++ = color;
+        count--;
+    }
+
+    uint32_t blocks = count >> 2;
+    if (blocks) {
+        __asm__ volatile (
+            "movd %[color], %%xmm0\n"
+            "pshufd $0, %%xmm0, %%xmm0\n"
+            "1:\n"
+            "movntdq %%xmm0, (%[dst])\n"
+            "addl $16, %[dst]\n"
+            "decl %[blocks]\n"
+            "jnz 1b\n"
+            : [dst] "+r" (dst), [blocks] "+r" (blocks)
+            : [color] "m" (color)
+            : "memory", "cc"
+        );
+    }
+
+    count &= 3;
+    while (count--) *dst++ = color;
+}
+
+static void blit_row_scalar(uint32_t* dst, const uint32_t* src, uint32_t count) {
+    while (count--) *dst++ = *src++;
+}
+
+static void blit_row_sse2(uint32_t* dst, const uint32_t* src, uint32_t count) {
+    while (((uint32_t)dst & 15) && count) {
+        *dst++ = *src++;
+        count--;
+    }
+
+    uint32_t blocks = count >> 2;
+    if (blocks) {
+        __asm__ volatile (
+            "1:\n"
+            "movdqu (%[src]), %%xmm0\n"
+            "movntdq %%xmm0, (%[dst])\n"
+            "addl $16, %[src]\n"
+            "addl $16, %[dst]\n"
+            "decl %[blocks]\n"
+            "jnz 1b\n"
+            : [dst] "+r" (dst), [src] "+r" (src), [blocks] "+r" (blocks)
+            :
+            : "memory", "cc"
+        );
+    }
+
+    count &= 3;
+    while (count--) *dst++ = *src++;
+}
+
+// ==================== ПРИМИТИВЫ ====================
+
+void gfx_fill_rect(uint32_t x, uint32_t y, uint32_t w, uint32_t h, uint32_t color) {
+    if (!active || x >= GFX_WIDTH || y >= GFX_HEIGHT) return;
+    if (x + w > GFX_WIDTH) w = GFX_WIDTH - x;
+    if (y + h > GFX_HEIGHT) h = GFX_HEIGHT - y;
+
+    uint32_t* row = lfb + y * GFX_WIDTH + x;
+    for (uint32_t i = 0; i < h; i++, row += GFX_WIDTH) {
+        if (sse2_path) {
+            fill_row_sse2(row, w, color);
+        } else {
+            fill_row_scalar(row, w, color);
+        }
+    }
+}
+
+void gfx_blit(uint32_t x, uint32_t y, uint32_t w, uint32_t h, const uint32_t* src, uint32_t src_pitch) {
+    if (!active || x >= GFX_WIDTH || y >= GFX_HEIGHT) return;
+    if (x + w > GFX_WIDTH) w = GFX_WIDTH - x;
+    if (y + h > GFX_HEIGHT) h = GFX_HEIGHT - y;
+
+    uint32_t* row = lfb + y * GFX_WIDTH + x;
+    for (uint32_t i = 0; i < h; i++, row += GFX_WIDTH, src += src_pitch) {
+        if (sse2_path) {
+            blit_row_sse2(row, src, w);
+        } else {
+            blit_row_scalar(row, src, w);
+        }
+    }
+}
+
+// Строка глифа: маска из таблицы, (маска & fg) | (~маска & bg), две записи по 16 байт
+static void glyph_sse2(uint32_t* dst, const uint8_t* rows, uint32_t fg, uint32_t bg) {
+    uint32_t count = GFX_CELL_HEIGHT;
+    uint32_t pitch = GFX_WIDTH * 4;
+
+    __asm__ volatile (
+        "movd %[fg], %%xmm6\n"
+        "pshufd $0, %%xmm6, %%xmm6\n"
+        "movd %[bg], %%xmm7\n"
+        "pshufd $0, %%xmm7, %%xmm7\n"
+        "1:\n"
+        "movzbl (%[rows]), %%eax\n"
+        "shll $5, %%eax\n"
+        "movdqa (%[table],%%eax), %%xmm0\n"
+        "movdqa 16(%[table],%%eax), %%xmm1\n"
+        "movdqa %%xmm0, %%xmm2\n"
+        "movdqa %%xmm1, %%xmm3\n"
+        "pand %%xmm6, %%xmm2\n"
+        "pand %%xmm6, %%xmm3\n"
+        "pandn %%xmm7, %%xmm0\n"
+        "pandn %%xmm7, %%xmm1\n"
+        "por %%xmm2, %%xmm0\n"
+        "por %%xmm3, %%xmm1\n"
+        "movntdq %%xmm0, (%[dst])\n"
+        "movntdq %%xmm1, 16(%[dst])\n"
+        "incl %[rows]\n"
+        "addl %[pitch], %[dst]\n"
+        "decl %[count]\n"
+        "jnz 1b\n"
+        : [dst] "+r" (dst), [rows] "+r" (rows), [count] "+r" (count)
+        : [table] "r" (expand), [fg] "m" (fg), [bg] "m" (bg), [pitch] "m" (pitch)
+        : "eax", "memory", "cc"
+    );
+}
+
+static void glyph_scalar(uint32_t* dst, const uint8_t* rows, uint32_t fg, uint32_t bg) {
+    for (int y = 0; y < GFX_CELL_HEIGHT; y++, dst += GFX_WIDTH) {
+        uint8_t bits = rows[y];
+        for (int x = 0; x < GFX_CELL_WIDTH; x++) {
+            dst[x] = (bits & (0x80 >> x)) ? fg : bg;
+        }
+    }
+}
+
+void gfx_draw_glyph(uint32_t x, uint32_t y, uint8_t ch, uint32_t fg, uint32_t bg) {
+    if (!active || x + GFX_CELL_WIDTH > GFX_WIDTH || y + GFX_CELL_HEIGHT > GFX_HEIGHT) return;
+
+    uint32_t* dst = lfb + y * GFX_WIDTH + x;
+
+    // movntdq требует выравнивания на 16 байт
+    if (sse2_path && !((uint32_t)dst & 15)) {
+        glyph_sse2(dst, font[ch], fg, bg);
+    } else {
+        glyph_scalar(dst, font[ch], fg, bg);
+    }
+}
+
+void gfx_draw_cell(uint8_t col, uint8_t row, uint16_t cell) {
+    uint8_t attr = cell >> 8;
+
+    gfx_draw_glyph(col * GFX_CELL_WIDTH, GFX_TEXT_TOP + row * GFX_CELL_HEIGHT,
+                   cell & 0xFF, palette[attr & 0x0F], palette[attr >> 4]);
+}
+
+// ==================== БЕНЧМАРК ====================
+
+static uint32_t mpps_x10(uint32_t pixels, uint32_t us) {
+    if (us == 0) us = 1;
+    return pixels / us * 10 + (pixels % us) * 10 / us;
+}
+
+void gfx_benchmark(uint8_t use_sse2, gfx_bench_result_t* result) {
+    uint32_t* scratch = memmap_scratch(GFX_WIDTH * GFX_HEIGHT * sizeof(uint32_t));
+    uint8_t saved_path = sse2_path;
+    uint64_t start;
+    uint32_t us;
+
+    result->sse2 = use_sse2 && sse2_supported;
+    if (!active) return;
+    sse2_path = result->sse2;
+
+    // Заливка всего экрана
+    start = cpu_read_tsc();
+    for (int i = 0; i < BENCH_FILL_ROUNDS; i++) {
+        gfx_fill_rect(0, 0, GFX_WIDTH, GFX_HEIGHT, palette[i & 15]);
+    }
+    gfx_sync();
+    us = timer_cycles_to_us(cpu_read_tsc() - start);
+    result->fill_mpps_x10 = mpps_x10(GFX_WIDTH * GFX_HEIGHT * BENCH_FILL_ROUNDS, us);
+
+    // Копирование градиента из ОЗУ; без буфера в RAM тест пропускается
+    result->blit_mpps_x10 = 0;
+    if (scratch) {
+        for (uint32_t y = 0; y < GFX_HEIGHT; y++) {
+            for (uint32_t x = 0; x < GFX_WIDTH; x++) {
+                scratch[y * GFX_WIDTH + x] = ((x * 255 / GFX_WIDTH) << 16) | ((y * 255 / GFX_HEIGHT) << 8) | 0x40;
+            }
+        }
+        start = cpu_read_tsc();
+        for (int i = 0; i < BENCH_BLIT_ROUNDS; i++) {
+            gfx_blit(0, 0, GFX_WIDTH, GFX_HEIGHT, scratch, GFX_WIDTH);
+        }
+        gfx_sync();
+        us = timer_cycles_to_us(cpu_read_tsc() - start);
+        result->blit_mpps_x10 = mpps_x10(GFX_WIDTH * GFX_HEIGHT * BENCH_BLIT_ROUNDS, us);
+    }
+
+    // Полная перерисовка текстовой сетки
+    start = cpu_read_tsc();
+    for (int i = 0; i < BENCH_GLYPH_ROUNDS; i++) {
+        for (int row = 0; row < 25; row++) {
+            for (int col = 0; col < 80; col++) {
+                gfx_draw_cell(col, row, ((0x10 + (i & 7)) << 8) | (uint8_t)('!' + (col + row + i) % 94));
+            }
+        }
+    }
+    gfx_sync();
+    us = timer_cycles_to_us(cpu_read_tsc() - start);
+    result->glyph_mpps_x10 = mpps_x10(80 * 25 * GFX_CELL_WIDTH * GFX_CELL_HEIGHT * BENCH_GLYPH_ROUNDS, us);
+    result->redraw_us = us / BENCH_GLYPH_ROUNDS;
+
+    sse2_path = saved_path;
+}
@@ -0,0 +1,282 @@
+#include "interrupts.h"
+#include "timer.h"
+#include "ports.h"
+#include "efficiency.h"
+#include "screen.h"
+#include "serial.h"
+
+// Порты 8259
+#define PIC1_COMMAND    0x20
+#define PIC1_DATA       0x21
+#define PIC2_COMMAND    0xA0
+#define PIC2_DATA       0xA1
+#define PIC_EOI         0x20
+#define PIC_READ_ISR    0x0B
+
+// Раскладка векторов BIOS для реального режима
+#define BIOS_BASE_MASTER 0x08
+#define BIOS_BASE_SLAVE  0x70
+
+// Порты контроллера клавиатуры
+#define KEYBOARD_DATA_PORT   0x60
+#define KEYBOARD_STATUS_PORT 0x64
+
+#define IDT_ENTRIES     256
+#define EXCEPTION_COUNT 32
+#define STUB_SIZE       16
+#define IDT_INTERRUPT_GATE 0x8E
+
+typedef struct {
+    uint16_t offset_low;
+    uint16_t selector;
+    uint8_t zero;
+    uint8_t type_attr;
+    uint16_t offset_high;
+} __attribute__((packed)) idt_entry_t;
+
+typedef struct {
+    uint16_t limit;
+    uint32_t base;
+} __attribute__((packed)) idt_descriptor_t;
+
+static idt_entry_t idt[IDT_ENTRIES];
+static irq_handler_t irq_handlers[IRQ_COUNT];
+static uint8_t bios_mask_master = 0xFF;
+static uint8_t bios_mask_slave = 0xFF;
+static uint8_t active = 0;
+
+// Очередь скан-кодов: один писатель (IRQ1), один читатель (меню)
+static volatile uint8_t kbd_queue[KBD_QUEUE_SIZE];
+static volatile uint8_t kbd_head = 0;
+static volatile uint8_t kbd_tail = 0;
+
+void exception_handler(uint32_t vector);
+void irq_dispatch(uint32_t irq);
+
+// Заглушки по 16 байт: номер вектора в стек и переход к общему обработчику
+__asm__ (
+    ".pushsection .text\n"
+    ".align 16\n"
+    "exception_stubs:\n"
+    ".set vector, 0\n"
+    ".rept 32\n"
+    ".align 16\n"
+    "    pushl $vector\n"
+    "    jmp exception_common\n"
+    ".set vector, vector + 1\n"
+    ".endr\n"
+    "exception_common:\n"
+    "    cld\n"
+    "    call exception_handler\n"
+    "1:  cli\n"
+    "    hlt\n"
+    "    jmp 1b\n"
+    ".align 16\n"
+    "irq_stubs:\n"
+    ".set irq, 0\n"
+    ".rept 16\n"
+    ".align 16\n"
+    "    pushl $irq\n"
+    "    jmp irq_common\n"
+    ".set irq, irq + 1\n"
+    ".endr\n"
+    "irq_common:\n"
+    "    pusha\n"
+    "    cld\n"
+    "    pushl 32(%esp)\n"
+    "    call irq_dispatch\n"
+    "    addl $4, %esp\n"
+    "    popa\n"
+    "    addl $4, %esp\n"
+    "    iret\n"
+    ".popsection\n"
+);
+
+extern char exception_stubs[];
+extern char irq_stubs[];
+
+static void io_wait(void) {
+    outb(0x80, 0);
+}
+
+static void idt_set_gate(uint8_t vector, uint32_t handler, uint16_t selector) {
+    idt[vector].offset_low = handler & 0xFFFF;
+    idt[vector].selector = selector;
+    idt[vector].zero = 0;
+    idt[vector].type_attr = IDT_INTERRUPT_GATE;
+    idt[vector].offset_high = handler >> 16;
+}
+
+static void pic_remap(uint8_t master_base, uint8_t slave_base) {
+    outb(PIC1_COMMAND, 0x11); io_wait();    // ICW1: каскад, ждем ICW4
+    outb(PIC2_COMMAND, 0x11); io_wait();
+    outb(PIC1_DATA, master_base); io_wait(); // ICW2: базовые векторы
+    outb(PIC2_DATA, slave_base); io_wait();
+    outb(PIC1_DATA, 0x04); io_wait();        // ICW3: ведомый на IRQ2
+    outb(PIC2_DATA, 0x02); io_wait();
+    outb(PIC1_DATA, 0x01); io_wait();        // ICW4: режим 8086
+    outb(PIC2_DATA, 0x01); io_wait();
+}
+
+static void pic_unmask(uint8_t irq) {
+    if (irq < 8) {
+        outb(PIC1_DATA, inb(PIC1_DATA) & ~(1 << irq));
+    } else {
+        outb(PIC2_DATA, inb(PIC2_DATA) & ~(1 << (irq - 8)));
+        outb(PIC1_DATA, inb(PIC1_DATA) & ~(1 << IRQ_CASCADE));
+    }
+}
+
+static uint8_t pic_in_service(uint16_t command_port, uint8_t bit) {
+    outb(command_port, PIC_READ_ISR);
+    return inb(command_port) & (1 << bit);
+}
+
+// Выводим номер исключения прямо в видеопамять и останавливаемся
+void exception_handler(uint32_t vector) {
+    const char hex_chars[] = "0123456789ABCDEF";
+    const char* msg = "CPU EXCEPTION 0x";
+    volatile uint16_t* video = (volatile uint16_t*)0xB8000;
+    int i = 0;
+
+    for (; msg[i]; i++) {
+        video[i] = 0x4F00 | msg[i];
+    }
+    video[i++] = 0x4F00 | hex_chars[(vector >> 4) & 0x0F];
+    video[i] = 0x4F00 | hex_chars[vector & 0x0F];
+}
+
+void irq_dispatch(uint32_t irq) {
+    // Ложные IRQ7/IRQ15 не подтверждаются в PIC
+    if (irq == 7 && !pic_in_service(PIC1_COMMAND, 7)) return;
+    if (irq == 15 && !pic_in_service(PIC2_COMMAND, 7)) {
+        outb(PIC1_COMMAND, PIC_EOI);
+        return;
+    }
+
+    if (irq_handlers[irq]) {
+        irq_handlers[irq]();
+    }
+
+    if (irq >= 8) outb(PIC2_COMMAND, PIC_EOI);
+    outb(PIC1_COMMAND, PIC_EOI);
+}
+
+static void keyboard_irq(void) {
+    // Забираем все байты контроллера
+    while (inb(KEYBOARD_STATUS_PORT) & 0x01) {
+        kbd_queue_push(inb(KEYBOARD_DATA_PORT));
+    }
+}
+
+void kbd_queue_push(uint8_t scancode) {
+    uint8_t next = (kbd_head + 1) & (KBD_QUEUE_SIZE - 1);
+
+    // Переполнение - новый код отбрасывается
+    if (next == kbd_tail) return;
+
+    kbd_queue[kbd_head] = scancode;
+    kbd_head = next;
+}
+
+uint8_t kbd_queue_pop(uint8_t* scancode) {
+    if (kbd_tail == kbd_head) return 0;
+
+    *scancode = kbd_queue[kbd_tail];
+    kbd_tail = (kbd_tail + 1) & (KBD_QUEUE_SIZE - 1);
+    return 1;
+}
+
+// cli/проверка/sti;hlt - прерывание не теряется между проверкой и остановом
+void interrupts_idle(void) {
+    // Перед сном выводим накопленный кадр
+    screen_flush();
+    serial_poll();
+
+    __asm__ volatile ("cli");
+    if (kbd_tail == kbd_head) {
+        power_idle();
+    } else {
+        __asm__ volatile ("sti");
+    }
+}
+
+uint8_t kbd_queue_wait(void) {
+    uint8_t scancode;
+
+    while (!kbd_queue_pop(&scancode)) {
+        interrupts_idle();
+    }
+    return scancode;
+}
+
+void irq_install(uint8_t irq, irq_handler_t handler) {
+    if (irq >= IRQ_COUNT) return;
+
+    irq_handlers[irq] = handler;
+    if (active) pic_unmask(irq);
+}
+
+void interrupts_init(void) {
+    idt_descriptor_t idtr;
+    uint16_t selector;
+
+    if (active) return;
+
+    __asm__ volatile ("cli");
+    __asm__ volatile ("mov %%cs, %0" : "=r" (selector));
+
+    for (int i = 0; i < EXCEPTION_COUNT; i++) {
+        idt_set_gate(i, (uint32_t)exception_stubs + i * STUB_SIZE, selector);
+    }
+    for (int i = 0; i < IRQ_COUNT; i++) {
+        idt_set_gate(IRQ_BASE_MASTER + i, (uint32_t)irq_stubs + i * STUB_SIZE, selector);
+    }
+
+    idtr.limit = sizeof(idt) - 1;
+    idtr.base = (uint32_t)idt;
+    __asm__ volatile ("lidt %0" : : "m" (idtr));
+
+    // Маски BIOS восстанавливаются в interrupts_shutdown()
+    bios_mask_master = inb(PIC1_DATA);
+    bios_mask_slave = inb(PIC2_DATA);
+
+    pic_remap(IRQ_BASE_MASTER, IRQ_BASE_SLAVE);
+    outb(PIC1_DATA, 0xFF);
+    outb(PIC2_DATA, 0xFF);
+
+    // Сбрасываем то, что накопилось в контроллере до включения IRQ1
+    while (inb(KEYBOARD_STATUS_PORT) & 0x01) {
+        inb(KEYBOARD_DATA_PORT);
+    }
+
+    active = 1;
+    irq_install(IRQ_KEYBOARD, keyboard_irq);
+    for (int i = 0; i < IRQ_COUNT; i++) {
+        if (irq_handlers[i]) pic_unmask(i);
+    }
+    timer_start_tick(TIMER_TICK_HZ);
+
+    __asm__ volatile ("sti");
+}
+
+void interrupts_shutdown(void) {
+    idt_descriptor_t ivt = { 0x03FF, 0 };
+
+    if (!active) return;
+
+    __asm__ volatile ("cli");
+    timer_stop_tick();
+
+    pic_remap(BIOS_BASE_MASTER, BIOS_BASE_SLAVE);
+    outb(PIC1_DATA, bios_mask_master);
+    outb(PIC2_DATA, bios_mask_slave);
+
+    // IVT реального режима по адресу 0
+    __asm__ volatile ("lidt %0" : : "m" (ivt));
+    active = 0;
+}
+
+uint8_t interrupts_active(void) {
+    return active;
+}
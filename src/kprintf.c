@@ -0,0 +1,214 @@
+#include "kprintf.h"
+#include "screen.h"
+
+#define FLAG_LEFT   0x01
+#define FLAG_ZERO   0x02
+
+typedef struct {
+    ksink_t sink;
+    void* ctx;
+    uint8_t color;
+    int count;
+} kout_t;
+
+typedef struct {
+    char* buffer;
+    uint32_t size;
+    uint32_t pos;
+} kbuffer_t;
+
+static const char digits_upper[] = "0123456789ABCDEF";
+static const char digits_lower[] = "0123456789abcdef";
+
+static const char spaces[] = "                ";
+static const char zeros[] = "0000000000000000";
+
+static void emit(kout_t* out, const char* str, uint32_t len) {
+    out->sink(out->ctx, str, len, out->color);
+    out->count += len;
+}
+
+static void emit_repeat(kout_t* out, const char* fill, int n) {
+    while (n > 0) {
+        int chunk = n < 16 ? n : 16;
+        emit(out, fill, chunk);
+        n -= chunk;
+    }
+}
+
+static void emit_number(kout_t* out, uint32_t value, uint8_t base, uint8_t upper,
+                        uint8_t negative, int width, uint8_t flags) {
+    const char* digits = upper ? digits_upper : digits_lower;
+    char tmp[10];
+    char* p = tmp + sizeof(tmp);
+
+    // Разряды пишутся с конца, чтобы вывести число одним куском;
+    // шестнадцатеричные - сдвигом, без деления
+    if (base == 16) {
+        do {
+            *--p = digits[value & 0x0F];
+            value >>= 4;
+        } while (value);
+    } else {
+        do {
+            *--p = digits[value % 10];
+            value /= 10;
+        } while (value);
+    }
+
+    int n = tmp + sizeof(tmp) - p;
+    int pad = width - n - negative;
+    if (!(flags & (FLAG_LEFT | FLAG_ZERO))) emit_repeat(out, spaces, pad);
+    if (negative) emit(out, "-", 1);
+    if (flags & FLAG_ZERO && !(flags & FLAG_LEFT)) emit_repeat(out, zeros, pad);
+    emit(out, p, n);
+    if (flags & FLAG_LEFT) emit_repeat(out, spaces, pad);
+}
+
+static void emit_string(kout_t* out, const char* str, int width, int precision, uint8_t flags) {
+    int len = 0;
+
+    if (!str) str = "(null)";
+    while (str[len] && (precision < 0 || len < precision)) len++;
+
+    if (!(flags & FLAG_LEFT)) emit_repeat(out, spaces, width - len);
+    emit(out, str, len);
+    if (flags & FLAG_LEFT) emit_repeat(out, spaces, width - len);
+}
+
+int kvprintf(ksink_t sink, void* ctx, uint8_t color, const char* fmt, va_list args) {
+    kout_t out = { sink, ctx, color, 0 };
+
+    while (*fmt) {
+        // Обычный текст до следующего '%' - одним куском
+        if (*fmt != '%') {
+            const char* run = fmt;
+            while (*fmt && *fmt != '%') fmt++;
+            emit(&out, run, fmt - run);
+            continue;
+        }
+        fmt++;
+
+        uint8_t flags = 0;
+        int width = 0;
+        int precision = -1;
+
+        for (;; fmt++) {
+            if (*fmt == '-') flags |= FLAG_LEFT;
+            else if (*fmt == '0') flags |= FLAG_ZERO;
+            else break;
+        }
+
+        if (*fmt == '*') {
+            width = va_arg(args, int);
+            fmt++;
+        } else {
+            while (*fmt >= '0' && *fmt <= '9') width = width * 10 + (*fmt++ - '0');
+        }
+
+        if (*fmt == '.') {
+            fmt++;
+            precision = 0;
+            while (*fmt >= '0' && *fmt <= '9') precision = precision * 10 + (*fmt++ - '0');
+        }
+
+        while (*fmt == 'l') fmt++;
+
+        switch (*fmt) {
+            case 'd':
+            case 'i': {
+                int32_t value = va_arg(args, int32_t);
+                if (value < 0) {
+                    emit_number(&out, -(uint32_t)value, 10, 0, 1, width, flags);
+                } else {
+                    emit_number(&out, value, 10, 0, 0, width, flags);
+                }
+                break;
+            }
+            case 'u':
+                emit_number(&out, va_arg(args, uint32_t), 10, 0, 0, width, flags);
+                break;
+            case 'x':
+                emit_number(&out, va_arg(args, uint32_t), 16, 0, 0, width, flags);
+                break;
+            case 'X':
+                emit_number(&out, va_arg(args, uint32_t), 16, 1, 0, width, flags);
+                break;
+            case 'c': {
+                char c = (char)va_arg(args, int);
+                if (!(flags & FLAG_LEFT)) emit_repeat(&out, spaces, width - 1);
+                emit(&out, &c, 1);
+                if (flags & FLAG_LEFT) emit_repeat(&out, spaces, width - 1);
+                break;
+            }
+            case 's':
+                emit_string(&out, va_arg(args, const char*), width, precision, flags);
+                break;
+            case 'C':
+                out.color = (uint8_t)va_arg(args, int);
+                break;
+            case '%':
+                emit(&out, "%", 1);
+                break;
+            case '\0':
+                return out.count;
+            default:
+                // Неизвестный формат выводится как есть
+                emit(&out, fmt - 1, 2);
+                break;
+        }
+        fmt++;
+    }
+
+    return out.count;
+}
+
+// ==================== ПРИЕМНИКИ ====================
+
+static void screen_sink(void* ctx, const char* str, uint32_t len, uint8_t color) {
+    uint32_t* pos = (uint32_t*)ctx;
+    screen_write(*pos, str, len, color);
+    *pos += len;
+}
+
+static void buffer_sink(void* ctx, const char* str, uint32_t len, uint8_t color) {
+    kbuffer_t* buf = (kbuffer_t*)ctx;
+    uint32_t room = buf->pos + 1 < buf->size ? buf->size - 1 - buf->pos : 0;
+    uint32_t n = len < room ? len : room;
+    char* dst = buf->buffer + buf->pos;
+    (void)color;
+
+    while (n--) *dst++ = *str++;
+    buf->pos += len;
+}
+
+int kprintf(uint8_t x, uint8_t y, uint8_t color, const char* fmt, ...) {
+    uint32_t pos = y * SCREEN_WIDTH + x;
+    va_list args;
+    int count;
+
+    va_start(args, fmt);
+    count = kvprintf(screen_sink, &pos, color, fmt, args);
+    va_end(args);
+    return count;
+}
+
+int kvsnprintf(char* buffer, uint32_t size, const char* fmt, va_list args) {
+    kbuffer_t buf = { buffer, size, 0 };
+    int count = kvprintf(buffer_sink, &buf, 0, fmt, args);
+
+    if (size > 0) {
+        buffer[buf.pos < size ? buf.pos : size - 1] = '\0';
+    }
+    return count;
+}
+
+int ksnprintf(char* buffer, uint32_t size, const char* fmt, ...) {
+    va_list args;
+    int count;
+
+    va_start(args, fmt);
+    count = kvsnprintf(buffer, size, fmt, args);
+    va_end(args);
+    return count;
+}
@@ -0,0 +1,275 @@
+#include "linux.h"
+#include "image.h"
+#include "memmap.h"
+#include "trace.h"
+
+#define STR(x)  #x
+#define XSTR(x) STR(x)
+
+static uint8_t header[LINUX_HEADER_BYTES] __attribute__((aligned(4)));
+static char config_text[LINUX_CONFIG_MAX];
+static uint32_t entry_point = 0;
+
+static const char* error_names[] = {
+    "OK",
+    "Cannot read kernel",
+    "Not a bzImage (boot protocol 2.03+)",
+    "Not enough memory",
+    "Cannot read initrd",
+    "Command line too long",
+};
+
+static uint8_t* boot_params(uint32_t offset) {
+    return (uint8_t*)(LINUX_BOOT_PARAMS_ADDR + offset);
+}
+
+static uint16_t get16(const uint8_t* data, uint32_t offset) {
+    return data[offset] | (data[offset + 1] << 8);
+}
+
+static uint32_t get32(const uint8_t* data, uint32_t offset) {
+    return get16(data, offset) | ((uint32_t)get16(data, offset + 2) << 16);
+}
+
+static void put32(uint32_t offset, uint32_t value) {
+    *(uint32_t*)boot_params(offset) = value;
+}
+
+// ==================== КОНФИГУРАЦИЯ ====================
+
+static uint8_t is_space(char c) {
+    return c == ' ' || c == '\t';
+}
+
+// Ключевое слово в начале строки, за ним пробел; возвращает значение
+static const char* keyword(const char* line, const char* word) {
+    while (*word) {
+        if (*line++ != *word++) return 0;
+    }
+    if (!is_space(*line)) return 0;
+    while (is_space(*line)) line++;
+    return line;
+}
+
+static uint8_t parse_config(linux_config_t* config, uint32_t length) {
+    uint32_t pos = 0;
+
+    config->kernel[0] = 0;
+    config->initrd[0] = 0;
+    config->cmdline[0] = 0;
+
+    while (pos < length) {
+        const char* line = config_text + pos;
+        const char* value;
+        char* dest;
+        uint32_t size;
+        uint32_t line_length = 0;
+        uint32_t value_length;
+
+        while (pos + line_length < length && line[line_length] != '\n') line_length++;
+        pos += line_length + 1;
+        config_text[pos - 1] = 0;
+        // Строки Windows
+        if (line_length && line[line_length - 1] == '\r') config_text[pos - 2] = 0;
+
+        while (is_space(*line)) line++;
+        if (*line == '#' || !*line) continue;
+
+        if ((value = keyword(line, "kernel")) != 0) {
+            dest = config->kernel;
+            size = sizeof(config->kernel);
+        } else if ((value = keyword(line, "initrd")) != 0) {
+            dest = config->initrd;
+            size = sizeof(config->initrd);
+        } else if ((value = keyword(line, "append")) != 0) {
+            dest = config->cmdline;
+            size = sizeof(config->cmdline);
+        } else {
+            continue;
+        }
+
+        value_length = 0;
+        while (value[value_length]) value_length++;
+        while (value_length && is_space(value[value_length - 1])) value_length--;
+        if (value_length >= size) return 0;
+
+        for (uint32_t i = 0; i < value_length; i++) dest[i] = value[i];
+        dest[value_length] = 0;
+    }
+    return config->kernel[0] != 0;
+}
+
+uint8_t linux_find_config(blockdev_t* dev, fat_volume_t* vol, linux_config_t* config) {
+    fat_file_t file;
+    uint32_t length;
+
+    if (!dev || !fat_mount_device(vol, dev) || !fat_open(vol, LINUX_CONFIG_PATH, &file)) return 0;
+    if (file.size >= LINUX_CONFIG_MAX) return 0;
+
+    length = fat_read(&file, config_text, file.size);
+    if (length != file.size) return 0;
+    config_text[length] = 0;
+    return parse_config(config, length);
+}
+
+// ==================== ЗАГРУЗКА ====================
+
+static void fill_boot_params(uint32_t ram_top) {
+    const boot_handoff_t* handoff = (const boot_handoff_t*)BOOT_HANDOFF_ADDR;
+    const uint8_t* map = (const uint8_t*)BOOT_E820_ADDR;
+    uint8_t* params = boot_params(0);
+    uint32_t header_end = LINUX_HEADER + header[LINUX_JUMP_OFFSET];
+    uint32_t count = handoff->e820_count < BOOT_E820_MAX ? handoff->e820_count : BOOT_E820_MAX;
+    uint32_t ext_mem_k = (ram_top - 0x100000) >> 10;
+
+    for (uint32_t i = 0; i < LINUX_BOOT_PARAMS_SIZE; i++) params[i] = 0;
+
+    // Заголовок настройки копируется как есть, дальше правятся поля загрузчика
+    if (header_end > LINUX_HEADER_BYTES) header_end = LINUX_HEADER_BYTES;
+    for (uint32_t i = LINUX_SETUP_SECTS; i < header_end; i++) params[i] = header[i];
+    params[LINUX_TYPE_OF_LOADER] = LINUX_LOADER_UNDEFINED;
+
+    // Текстовый режим 3, 80x25 - для ранней консоли VGA
+    params[LINUX_BP_VIDEO_MODE] = 0x03;
+    params[LINUX_BP_VIDEO_COLS] = 80;
+    params[LINUX_BP_VIDEO_LINES] = 25;
+    params[LINUX_BP_VIDEO_IS_VGA] = 1;
+    params[LINUX_BP_VIDEO_POINTS] = 16;
+
+    *(uint16_t*)boot_params(LINUX_BP_EXT_MEM_K) = ext_mem_k > 0xFFFF ? 0xFFFF : ext_mem_k;
+    put32(LINUX_BP_ALT_MEM_K, ext_mem_k);
+
+    params[LINUX_BP_E820_ENTRIES] = count;
+    for (uint32_t i = 0; i < count * sizeof(e820_entry_t); i++) {
+        params[LINUX_BP_E820_TABLE + i] = map[i];
+    }
+}
+
+static uint8_t load_initrd(fat_volume_t* vol, const char* path, uint32_t kernel_end, uint32_t ram_top) {
+    fat_file_t file;
+    uint32_t top = ram_top;
+    uint32_t max = get32(header, LINUX_INITRD_ADDR_MAX);
+    uint32_t address;
+
+    if (!fat_open(vol, path, &file) || !file.size) return LINUX_ERR_INITRD;
+
+    // Как можно выше, но не выше initrd_addr_max (0 у ядер, где поле не заполнено)
+    if (!max) max = LINUX_DEFAULT_INITRD_MAX;
+    if (max != 0xFFFFFFFF && top > max + 1) top = max + 1;
+    if (file.size > top - kernel_end) return LINUX_ERR_MEMORY;
+    address = (top - file.size) & ~0xFFF;
+    if (address < kernel_end || memmap_overlaps_payload(address, file.size)) return LINUX_ERR_MEMORY;
+
+    if (fat_read(&file, (void*)address, file.size) != file.size) return LINUX_ERR_INITRD;
+    put32(LINUX_RAMDISK_IMAGE, address);
+    put32(LINUX_RAMDISK_SIZE, file.size);
+    return LINUX_OK;
+}
+
+uint8_t linux_load(fat_volume_t* vol, const linux_config_t* config) {
+    fat_file_t file;
+    uint32_t setup_sects, kernel_offset, kernel_size, kernel_span, kernel_end, ram_top;
+    uint32_t cmdline_max = LINUX_OLD_CMDLINE_MAX;
+    uint16_t version;
+    char* cmdline = (char*)LINUX_CMDLINE_ADDR;
+    uint32_t length = 0;
+    uint8_t result;
+
+    if (!fat_open(vol, config->kernel, &file) || file.size < LINUX_HEADER_BYTES) return LINUX_ERR_KERNEL;
+    if (fat_read(&file, header, LINUX_HEADER_BYTES) != LINUX_HEADER_BYTES) return LINUX_ERR_KERNEL;
+
+    // bzImage: сигнатура загрузочного сектора, "HdrS", ядро выше 1 МБ
+    version = get16(header, LINUX_VERSION);
+    if (get16(header, LINUX_BOOT_FLAG) != 0xAA55 || get32(header, LINUX_HEADER) != LINUX_HDR_MAGIC ||
+        version < LINUX_MIN_VERSION || !(header[LINUX_LOADFLAGS] & LINUX_LOADED_HIGH)) {
+        return LINUX_ERR_FORMAT;
+    }
+
+    setup_sects = header[LINUX_SETUP_SECTS] ? header[LINUX_SETUP_SECTS] : LINUX_DEFAULT_SETUP_SECTS;
+    kernel_offset = (setup_sects + 1) * 512;
+    if (file.size <= kernel_offset) return LINUX_ERR_FORMAT;
+    kernel_size = file.size - kernel_offset;
+    entry_point = get32(header, LINUX_CODE32_START);
+
+    // Ядро распаковывается на месте: ему нужно init_size байт от точки загрузки
+    kernel_span = kernel_size;
+    if (version >= 0x020A && get32(header, LINUX_INIT_SIZE) > kernel_span) {
+        kernel_span = get32(header, LINUX_INIT_SIZE);
+    }
+    ram_top = memmap_ram_end(entry_point);
+    if (!ram_top || kernel_span > ram_top - entry_point) return LINUX_ERR_MEMORY;
+    // Payload, собранный с LOAD_ADDR=0x100000, лежит на месте ядра
+    if (memmap_overlaps_payload(entry_point, kernel_span)) return LINUX_ERR_MEMORY;
+    kernel_end = (entry_point + kernel_span + 0xFFF) & ~0xFFF;
+
+    if (version >= 0x0206) cmdline_max = get32(header, LINUX_CMDLINE_SIZE);
+    while (config->cmdline[length]) length++;
+    if (length > cmdline_max) return LINUX_ERR_CMDLINE;
+
+    // Защищенная часть - прямо на место, слитные кластеры крупными чтениями
+    if (!fat_seek(&file, kernel_offset) ||
+        fat_read(&file, (void*)entry_point, kernel_size) != kernel_size) {
+        return LINUX_ERR_KERNEL;
+    }
+
+    fill_boot_params(ram_top);
+
+    for (uint32_t i = 0; i <= length; i++) cmdline[i] = config->cmdline[i];
+    put32(LINUX_CMD_LINE_PTR, LINUX_CMDLINE_ADDR);
+
+    if (config->initrd[0]) {
+        result = load_initrd(vol, config->initrd, kernel_end, ram_top);
+        if (result != LINUX_OK) return result;
+    }
+
+    TRACE(BOOT, LINUX, kernel_size, get32(boot_params(0), LINUX_RAMDISK_SIZE));
+    return LINUX_OK;
+}
+
+const char* linux_error_name(uint8_t error) {
+    return error < sizeof(error_names) / sizeof(error_names[0]) ? error_names[error] : "Unknown error";
+}
+
+uint32_t linux_entry_point(void) {
+    return entry_point;
+}
+
+// Своя GDT: протокол требует селекторы 0x10 и 0x18, у stage2 они другие
+static const uint32_t linux_gdt[8] __attribute__((aligned(8))) = {
+    0, 0,
+    0, 0,
+    0x0000FFFF, 0x00CF9A00,     // __BOOT_CS: плоский 32-битный код
+    0x0000FFFF, 0x00CF9200,     // __BOOT_DS: плоские данные
+};
+
+static struct {
+    uint16_t limit;
+    uint32_t base;
+} __attribute__((packed)) linux_gdtr;
+
+void linux_jump(void) {
+    linux_gdtr.limit = sizeof(linux_gdt) - 1;
+    linux_gdtr.base = (uint32_t)linux_gdt;
+
+    // EBX, EDI, EBP обнулены, прерывания запрещены
+    __asm__ volatile (
+        "cli\n"
+        "lgdt (%%eax)\n"
+        "ljmp $" XSTR(LINUX_BOOT_CS) ", $1f\n"
+        "1:\n"
+        "movw $" XSTR(LINUX_BOOT_DS) ", %%ax\n"
+        "movw %%ax, %%ds\n"
+        "movw %%ax, %%es\n"
+        "movw %%ax, %%fs\n"
+        "movw %%ax, %%gs\n"
+        "movw %%ax, %%ss\n"
+        "xorl %%ebx, %%ebx\n"
+        "xorl %%edi, %%edi\n"
+        "xorl %%ebp, %%ebp\n"
+        "jmp *%%ecx\n"
+        :
+        : "a" (&linux_gdtr), "c" (entry_point), "S" (LINUX_BOOT_PARAMS_ADDR)
+        : "memory"
+    );
+    __builtin_unreachable();
+}
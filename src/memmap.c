@@ -0,0 +1,74 @@
+#include "memmap.h"
+#include "image.h"
+
+#define HIGH_MEM_START      0x00100000
+#define EXT_MEM2_START      0x01000000
+#define LOW_MEM_END         0x000A0000
+#define RAM_LIMIT           0xFFFFF000ULL
+
+extern uint8_t read_cmos(uint8_t reg);
+extern uint8_t _payload_start[];
+extern uint8_t _end[];
+
+// Без карты E820: базовая память и расширенная из CMOS
+static uint32_t cmos_ram_end(uint32_t start) {
+    uint64_t end;
+
+    if (start < LOW_MEM_END) return LOW_MEM_END;
+    if (start < HIGH_MEM_START) return 0;
+
+    end = HIGH_MEM_START + ((uint64_t)(read_cmos(CMOS_EXT_MEM_LOW) |
+                                       (read_cmos(CMOS_EXT_MEM_HIGH) << 8)) << 10);
+    // 0x30/0x31 насыщаются на 64 МБ - дальше считают 0x34/0x35
+    if (end >= EXT_MEM2_START) {
+        end = EXT_MEM2_START + ((uint64_t)(read_cmos(CMOS_EXT_MEM2_LOW) |
+                                           (read_cmos(CMOS_EXT_MEM2_HIGH) << 8)) << 16);
+    }
+    if (end > RAM_LIMIT) end = RAM_LIMIT;
+    return start < end ? (uint32_t)end : 0;
+}
+
+uint32_t memmap_ram_end(uint32_t start) {
+    const boot_handoff_t* handoff = (const boot_handoff_t*)BOOT_HANDOFF_ADDR;
+    const e820_entry_t* map = (const e820_entry_t*)BOOT_E820_ADDR;
+    uint8_t count = handoff->e820_count < BOOT_E820_MAX ? handoff->e820_count : BOOT_E820_MAX;
+    uint64_t end = start;
+    uint8_t grown = 1;
+
+    if (handoff->magic != BOOT_HANDOFF_MAGIC || count == 0) return cmos_ram_end(start);
+
+    // Соседние записи RAM склеиваются: BIOS может разбить область на части
+    while (grown) {
+        grown = 0;
+        for (uint8_t i = 0; i < count; i++) {
+            uint64_t base = map[i].base;
+            uint64_t limit = base + map[i].length;
+
+            if (map[i].type != E820_TYPE_RAM || base > end || limit <= end) continue;
+            end = limit;
+            grown = 1;
+        }
+    }
+    if (end > RAM_LIMIT) end = RAM_LIMIT;
+    return end > start ? (uint32_t)end : 0;
+}
+
+uint8_t memmap_is_ram(uint32_t start, uint32_t size) {
+    uint32_t end = memmap_ram_end(start);
+
+    return end && size <= end - start;
+}
+
+uint8_t memmap_overlaps_payload(uint32_t start, uint32_t size) {
+    uint32_t first = (uint32_t)_payload_start;
+    uint32_t last = (uint32_t)_end;
+
+    if (!size || start >= last) return 0;
+    return start >= first || size > first - start;
+}
+
+void* memmap_scratch(uint32_t size) {
+    if (size > SCRATCH_SIZE || !memmap_is_ram(SCRATCH_ADDR, size)) return 0;
+    if (memmap_overlaps_payload(SCRATCH_ADDR, size)) return 0;
+    return (void*)SCRATCH_ADDR;
+}
@@ -0,0 +1,336 @@
+#include "nvme.h"
+#include "blockdev.h"
+#include "pci.h"
+#include "timer.h"
+#include "trace.h"
+#include "kprintf.h"
+
+typedef struct {
+    blockdev_t dev;
+    uint32_t nsid;
+} nvme_namespace_t;
+
+// Очередь: кольцо команд или завершений и положение в нем
+typedef struct {
+    volatile void* entries;
+    uint16_t size;
+    uint16_t index;         // хвост SQ или голова CQ
+    uint8_t phase;          // ожидаемый бит фазы CQ
+    uint16_t id;
+} nvme_queue_t;
+
+// Каждая очередь - на своей странице (PC = 1 требует выравнивания)
+static nvme_sqe_t admin_sq[NVME_ADMIN_QUEUE_SIZE] __attribute__((aligned(NVME_PAGE_SIZE)));
+static nvme_cqe_t admin_cq[NVME_ADMIN_QUEUE_SIZE] __attribute__((aligned(NVME_PAGE_SIZE)));
+static nvme_sqe_t io_sq[NVME_IO_QUEUE_SIZE] __attribute__((aligned(NVME_PAGE_SIZE)));
+static nvme_cqe_t io_cq[NVME_IO_QUEUE_SIZE] __attribute__((aligned(NVME_PAGE_SIZE)));
+static uint8_t identify_page[NVME_PAGE_SIZE] __attribute__((aligned(NVME_PAGE_SIZE)));
+// Список PRP на каждый слот очереди отправки
+static uint32_t prp_lists[NVME_IO_QUEUE_SIZE][NVME_PRP_ENTRIES * 2] __attribute__((aligned(256)));
+
+static volatile uint8_t* regs = 0;
+static uint32_t doorbell_stride = 4;
+static uint32_t timeout_ms = NVME_TIMEOUT_MS;
+static uint32_t max_sectors = NVME_MAX_SECTORS;
+static nvme_queue_t admin_sq_state, admin_cq_state, io_sq_state, io_cq_state;
+static nvme_namespace_t namespaces[NVME_MAX_NAMESPACES];
+static uint8_t namespace_count = 0;
+static uint8_t failed = 0;
+// Регистры очереди администратора, которые оставил BIOS
+static uint32_t saved_aqa, saved_asq[2], saved_acq[2], saved_cc;
+static uint8_t claimed = 0;
+
+static uint32_t reg_read(uint32_t reg) {
+    return *(volatile uint32_t*)(regs + reg);
+}
+
+static void reg_write(uint32_t reg, uint32_t value) {
+    *(volatile uint32_t*)(regs + reg) = value;
+}
+
+// Дверные звонки: хвост SQ y - номер 2y, голова CQ y - номер 2y + 1
+static void ring_sq(nvme_queue_t* sq) {
+    // Команда должна лечь в память до звонка
+    __asm__ volatile ("" : : : "memory");
+    reg_write(NVME_REG_DOORBELL + (2 * sq->id) * doorbell_stride, sq->index);
+}
+
+static void ring_cq(nvme_queue_t* cq) {
+    reg_write(NVME_REG_DOORBELL + (2 * cq->id + 1) * doorbell_stride, cq->index);
+}
+
+static void queue_setup(nvme_queue_t* queue, volatile void* entries, uint16_t size, uint16_t id) {
+    queue->entries = entries;
+    queue->size = size;
+    queue->index = 0;
+    queue->phase = 1;
+    queue->id = id;
+}
+
+static nvme_sqe_t* sq_next(nvme_queue_t* sq) {
+    nvme_sqe_t* sqe = (nvme_sqe_t*)sq->entries + sq->index;
+    uint32_t* words = (uint32_t*)sqe;
+
+    for (uint32_t i = 0; i < sizeof(nvme_sqe_t) / 4; i++) words[i] = 0;
+    sqe->cid = sq->index;
+    sq->index = (sq->index + 1) % sq->size;
+    return sqe;
+}
+
+// Следующее завершение, если фаза совпала; голова CQ сдвигается
+static volatile nvme_cqe_t* cq_poll(nvme_queue_t* cq) {
+    volatile nvme_cqe_t* cqe = (volatile nvme_cqe_t*)cq->entries + cq->index;
+
+    if ((cqe->status & 1) != cq->phase) return 0;
+
+    cq->index++;
+    if (cq->index == cq->size) {
+        cq->index = 0;
+        cq->phase ^= 1;
+    }
+    return cqe;
+}
+
+// PRP1 - начало буфера, PRP2 - вторая страница или список остальных страниц
+static void set_prp(nvme_sqe_t* sqe, uint32_t* list, uint32_t address, uint32_t bytes) {
+    uint32_t first = NVME_PAGE_SIZE - (address & (NVME_PAGE_SIZE - 1));
+
+    sqe->prp1[0] = address;
+    if (bytes <= first) return;
+
+    address += first;
+    bytes -= first;
+    if (bytes <= NVME_PAGE_SIZE) {
+        sqe->prp2[0] = address;
+        return;
+    }
+
+    sqe->prp2[0] = (uint32_t)list;
+    for (uint32_t i = 0; bytes; i++) {
+        list[i * 2] = address;
+        list[i * 2 + 1] = 0;
+        address += NVME_PAGE_SIZE;
+        bytes = bytes > NVME_PAGE_SIZE ? bytes - NVME_PAGE_SIZE : 0;
+    }
+}
+
+// Команда администратора с ожиданием завершения
+static uint8_t admin_command(uint8_t opcode, uint32_t nsid, void* buffer, uint32_t cdw10, uint32_t cdw11) {
+    nvme_sqe_t* sqe = sq_next(&admin_sq_state);
+    volatile nvme_cqe_t* cqe;
+    deadline_t deadline = deadline_after_ms(timeout_ms);
+
+    sqe->opcode = opcode;
+    sqe->nsid = nsid;
+    sqe->prp1[0] = (uint32_t)buffer;
+    sqe->cdw10 = cdw10;
+    sqe->cdw11 = cdw11;
+    ring_sq(&admin_sq_state);
+
+    while (!(cqe = cq_poll(&admin_cq_state))) {
+        if (deadline_expired(deadline)) {
+            TRACE_WARNING(NVME, TIMEOUT, opcode, 0);
+            return 0;
+        }
+    }
+    uint16_t status = cqe->status >> 1;
+    ring_cq(&admin_cq_state);
+
+    if (status) {
+        TRACE_WARNING(NVME, ERROR, opcode, status);
+        return 0;
+    }
+    return 1;
+}
+
+// Пакет: очередь заполняется командами Read, звонок - один на пакет;
+// завершения собираются, и освободившиеся слоты сразу заполняются снова
+static uint8_t disk_read(blockdev_t* dev, uint32_t lba, uint32_t count, void* buffer) {
+    nvme_namespace_t* ns = &namespaces[dev->unit];
+    uint32_t address = (uint32_t)buffer;
+    uint32_t inflight = 0;
+    uint32_t depth = io_sq_state.size - 1u;    // один слот пустой - полная очередь
+    uint8_t ok = 1;
+    deadline_t deadline = deadline_after_ms(timeout_ms);
+
+    // PRP требует выравнивания на dword
+    if (failed || (address & 3)) return 0;
+
+    TRACE(NVME, READ, lba, count);
+    while (count || inflight) {
+        uint32_t queued = 0;
+        uint32_t completed = 0;
+        volatile nvme_cqe_t* cqe;
+
+        while (ok && count && inflight < depth) {
+            uint32_t sectors = count < max_sectors ? count : max_sectors;
+            uint16_t slot = io_sq_state.index;
+            nvme_sqe_t* sqe = sq_next(&io_sq_state);
+
+            sqe->opcode = NVME_CMD_READ;
+            sqe->nsid = ns->nsid;
+            set_prp(sqe, prp_lists[slot], address, sectors * BLOCKDEV_SECTOR_SIZE);
+            sqe->cdw10 = lba;
+            sqe->cdw11 = 0;
+            sqe->cdw12 = sectors - 1;
+
+            lba += sectors;
+            address += sectors * BLOCKDEV_SECTOR_SIZE;
+            count -= sectors;
+            inflight++;
+            queued++;
+        }
+        if (queued) ring_sq(&io_sq_state);
+
+        while ((cqe = cq_poll(&io_cq_state)) != 0) {
+            if (cqe->status >> 1) {
+                TRACE_WARNING(NVME, ERROR, cqe->cid, cqe->status >> 1);
+                ok = 0;
+            }
+            inflight--;
+            completed++;
+        }
+
+        if (completed) {
+            ring_cq(&io_cq_state);
+            deadline = deadline_after_ms(timeout_ms);
+        } else if (deadline_expired(deadline)) {
+            // Контроллер завис - очереди больше не используем
+            TRACE_WARNING(NVME, TIMEOUT, NVME_CMD_READ, inflight);
+            failed = 1;
+            return 0;
+        }
+        if (!ok) count = 0;
+    }
+    return ok;
+}
+
+static uint8_t wait_ready(uint32_t ready) {
+    deadline_t deadline = deadline_after_ms(timeout_ms);
+
+    while ((reg_read(NVME_REG_CSTS) & NVME_CSTS_RDY) != ready) {
+        if ((reg_read(NVME_REG_CSTS) & NVME_CSTS_CFS) || deadline_expired(deadline)) return 0;
+    }
+    return 1;
+}
+
+static void probe_namespace(uint32_t nsid) {
+    nvme_namespace_t* ns = &namespaces[namespace_count];
+    const uint32_t* data = (const uint32_t*)identify_page;
+
+    if (!admin_command(NVME_ADMIN_IDENTIFY, nsid, identify_page, NVME_IDENTIFY_NAMESPACE, 0)) return;
+
+    // NSZE - 64 бита; FLBAS (байт 26) выбирает формат из LBAF (с байта 128)
+    uint32_t size_low = data[0];
+    uint32_t size_high = data[1];
+    uint8_t format = identify_page[26] & 0x0F;
+    uint8_t lba_shift = identify_page[128 + format * 4 + 2];
+
+    if (!size_low && !size_high) return;
+    if (lba_shift != 9) {
+        TRACE_WARNING(NVME, FOUND, nsid, 0);
+        return;
+    }
+
+    ns->nsid = nsid;
+    ksnprintf(ns->dev.name, sizeof(ns->dev.name), "NVME%u", nsid);
+    ns->dev.type = BLOCKDEV_NVME;
+    ns->dev.unit = namespace_count;
+    ns->dev.sectors = size_high ? 0xFFFFFFFF : size_low;
+    ns->dev.read = disk_read;
+
+    TRACE(NVME, FOUND, nsid, ns->dev.sectors);
+    if (blockdev_register(&ns->dev)) namespace_count++;
+}
+
+uint8_t nvme_init(void) {
+    const pci_device_t* dev = 0;
+
+    for (uint8_t i = 0; (dev = pci_find_class(NVME_PCI_CLASS, NVME_PCI_SUBCLASS, i)) != 0; i++) {
+        if (dev->prog_if == NVME_PCI_PROG_IF) break;
+    }
+    if (!dev) return 0;
+
+    // 64-битный BAR0 должен лежать ниже 4 ГБ
+    if (pci_read32(dev, PCI_BAR0 + 4)) return 0;
+    regs = (volatile uint8_t*)pci_bar(dev, 0);
+    if (!regs) return 0;
+    pci_enable(dev, PCI_COMMAND_MEMORY | PCI_COMMAND_MASTER);
+
+    // CAP: MQES 15:0, TO 31:24 (по 500 мс), DSTRD 35:32
+    uint32_t cap_low = reg_read(NVME_REG_CAP);
+    uint32_t cap_high = reg_read(NVME_REG_CAP + 4);
+    uint32_t io_size = (cap_low & 0xFFFF) + 1;
+
+    doorbell_stride = 4 << (cap_high & 0x0F);
+    timeout_ms = ((cap_low >> 24) & 0xFF) * 500;
+    if (timeout_ms < NVME_TIMEOUT_MS) timeout_ms = NVME_TIMEOUT_MS;
+    if (io_size > NVME_IO_QUEUE_SIZE) io_size = NVME_IO_QUEUE_SIZE;
+
+    saved_aqa = reg_read(NVME_REG_AQA);
+    saved_asq[0] = reg_read(NVME_REG_ASQ);
+    saved_asq[1] = reg_read(NVME_REG_ASQ + 4);
+    saved_acq[0] = reg_read(NVME_REG_ACQ);
+    saved_acq[1] = reg_read(NVME_REG_ACQ + 4);
+    saved_cc = reg_read(NVME_REG_CC);
+    claimed = 1;
+
+    // Сброс, очередь администратора, запуск
+    reg_write(NVME_REG_CC, reg_read(NVME_REG_CC) & ~NVME_CC_EN);
+    if (!wait_ready(0)) return 0;
+
+    queue_setup(&admin_sq_state, admin_sq, NVME_ADMIN_QUEUE_SIZE, 0);
+    queue_setup(&admin_cq_state, admin_cq, NVME_ADMIN_QUEUE_SIZE, 0);
+    reg_write(NVME_REG_INTMS, 0xFFFFFFFF);
+    reg_write(NVME_REG_AQA, ((NVME_ADMIN_QUEUE_SIZE - 1) << 16) | (NVME_ADMIN_QUEUE_SIZE - 1));
+    reg_write(NVME_REG_ASQ, (uint32_t)admin_sq);
+    reg_write(NVME_REG_ASQ + 4, 0);
+    reg_write(NVME_REG_ACQ, (uint32_t)admin_cq);
+    reg_write(NVME_REG_ACQ + 4, 0);
+    reg_write(NVME_REG_CC, NVME_CC_IOSQES | NVME_CC_IOCQES | NVME_CC_EN);
+    if (!wait_ready(NVME_CSTS_RDY)) return 0;
+
+    // MDTS (байт 77) ограничивает размер одной передачи: 2^MDTS страниц
+    if (!admin_command(NVME_ADMIN_IDENTIFY, 0, identify_page, NVME_IDENTIFY_CONTROLLER, 0)) return 0;
+    uint8_t mdts = identify_page[77];
+    uint32_t namespaces_total = *(const uint32_t*)(identify_page + 516);
+    if (mdts && mdts < 8) {
+        uint32_t mdts_sectors = ((uint32_t)NVME_PAGE_SIZE << mdts) / BLOCKDEV_SECTOR_SIZE;
+        if (mdts_sectors < max_sectors) max_sectors = mdts_sectors;
+    }
+
+    // Пара очередей ввода-вывода: сначала завершения, затем отправка (PC = 1)
+    queue_setup(&io_cq_state, io_cq, io_size, NVME_IO_QUEUE_ID);
+    queue_setup(&io_sq_state, io_sq, io_size, NVME_IO_QUEUE_ID);
+    if (!admin_command(NVME_ADMIN_CREATE_CQ, 0, io_cq, ((io_size - 1) << 16) | NVME_IO_QUEUE_ID, 1)) return 0;
+    if (!admin_command(NVME_ADMIN_CREATE_SQ, 0, io_sq, ((io_size - 1) << 16) | NVME_IO_QUEUE_ID,
+                       (NVME_IO_QUEUE_ID << 16) | 1)) return 0;
+
+    for (uint32_t nsid = 1; nsid <= namespaces_total && nsid <= NVME_SCAN_NAMESPACES &&
+         namespace_count < NVME_MAX_NAMESPACES; nsid++) {
+        probe_namespace(nsid);
+    }
+    return namespace_count;
+}
+
+// Очереди ввода-вывода BIOS пересоздать нельзя: их адреса и позиции
+// известны только ему. Контроллер остается выключенным с его регистрами
+// администратора - INT 13h BIOS завершится ошибкой по таймауту, а не
+// DMA через очереди payload, память которых уже отдана следующей стадии
+void nvme_shutdown(void) {
+    if (!claimed) return;
+
+    reg_write(NVME_REG_CC, reg_read(NVME_REG_CC) & ~NVME_CC_EN);
+    wait_ready(0);
+    reg_write(NVME_REG_AQA, saved_aqa);
+    reg_write(NVME_REG_ASQ, saved_asq[0]);
+    reg_write(NVME_REG_ASQ + 4, saved_asq[1]);
+    reg_write(NVME_REG_ACQ, saved_acq[0]);
+    reg_write(NVME_REG_ACQ + 4, saved_acq[1]);
+    reg_write(NVME_REG_CC, saved_cc & ~NVME_CC_EN);
+    failed = 1;
+}
+
+uint8_t nvme_namespace_count(void) {
+    return namespace_count;
+}
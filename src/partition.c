@@ -0,0 +1,311 @@
+#include "partition.h"
+#include "trace.h"
+#include "kprintf.h"
+
+static partition_t partitions[PARTITION_MAX];
+static uint8_t count = 0;
+static uint8_t bootable_count = 0;
+
+static uint8_t sector[BLOCKDEV_SECTOR_SIZE] __attribute__((aligned(4)));
+static uint8_t array_chunk[GPT_READ_SECTORS * BLOCKDEV_SECTOR_SIZE] __attribute__((aligned(4)));
+
+static uint32_t crc_table[256];
+static uint8_t crc_table_ready = 0;
+
+static void copy_bytes(void* dest, const void* src, uint32_t length) {
+    uint8_t* d = (uint8_t*)dest;
+    const uint8_t* s = (const uint8_t*)src;
+
+    while (length--) *d++ = *s++;
+}
+
+uint32_t crc32(uint32_t crc, const void* data, uint32_t length) {
+    const uint8_t* bytes = (const uint8_t*)data;
+
+    if (!crc_table_ready) {
+        for (uint32_t i = 0; i < 256; i++) {
+            uint32_t value = i;
+            for (int bit = 0; bit < 8; bit++) {
+                value = (value & 1) ? (value >> 1) ^ 0xEDB88320 : value >> 1;
+            }
+            crc_table[i] = value;
+        }
+        crc_table_ready = 1;
+    }
+
+    crc = ~crc;
+    while (length--) {
+        crc = crc_table[(crc ^ *bytes++) & 0xFF] ^ (crc >> 8);
+    }
+    return ~crc;
+}
+
+static uint8_t is_extended(uint8_t type) {
+    return type == MBR_TYPE_EXTENDED || type == MBR_TYPE_EXTENDED_LBA || type == MBR_TYPE_EXTENDED_LINUX;
+}
+
+static const char* mbr_type_name(uint8_t type) {
+    switch (type) {
+        case 0x01: return "FAT12";
+        case 0x04:
+        case 0x06:
+        case 0x0E: return "FAT16";
+        case 0x07: return "NTFS/exFAT";
+        case 0x0B:
+        case 0x0C: return "FAT32";
+        case 0x82: return "Linux swap";
+        case 0x83: return "Linux";
+        case 0xA5: return "FreeBSD";
+        case 0xA6: return "OpenBSD";
+        case 0xA9: return "NetBSD";
+        case 0xEF: return "EFI System";
+    }
+    return 0;
+}
+
+// Тип GPT по первому полю GUID (на диске - little endian)
+static const char* gpt_type_name(const uint8_t* guid) {
+    uint32_t data1 = guid[0] | (guid[1] << 8) | (guid[2] << 16) | ((uint32_t)guid[3] << 24);
+
+    switch (data1) {
+        case 0xC12A7328: return "EFI System";
+        case 0xEBD0A0A2: return "Basic data";
+        case 0x0FC63DAF: return "Linux";
+        case 0x0657FD6D: return "Linux swap";
+        case 0x21686148: return "BIOS boot";
+        case 0xE3C9E316: return "MS reserved";
+    }
+    return "GPT data";
+}
+
+static partition_t* add_partition(blockdev_t* dev, uint8_t number, uint8_t scheme,
+                                  uint32_t start, uint32_t sectors) {
+    partition_t* part;
+
+    if (count >= PARTITION_MAX || !sectors) return 0;
+    if (dev->sectors && (start >= dev->sectors || sectors > dev->sectors - start)) return 0;
+
+    part = &partitions[count++];
+    part->dev = dev;
+    part->number = number;
+    part->scheme = scheme;
+    part->type = 0;
+    part->flags = 0;
+    part->start = start;
+    part->sectors = sectors;
+    part->name[0] = 0;
+    part->entry.status = 0;
+    part->entry.chs_first[0] = 0xFE;
+    part->entry.chs_first[1] = part->entry.chs_first[2] = 0xFF;
+    part->entry.type = MBR_TYPE_GPT;
+    part->entry.chs_last[0] = 0xFE;
+    part->entry.chs_last[1] = part->entry.chs_last[2] = 0xFF;
+    part->entry.lba_first = start;
+    part->entry.sectors = sectors;
+    return part;
+}
+
+static void add_mbr_partition(blockdev_t* dev, uint8_t number, const mbr_entry_t* entry, uint32_t start) {
+    partition_t* part = add_partition(dev, number, PARTITION_SCHEME_MBR, start, entry->sectors);
+    const char* name;
+
+    if (!part) return;
+    part->type = entry->type;
+    if (entry->status & MBR_ACTIVE) part->flags |= PARTITION_ACTIVE;
+    if (number > MBR_ENTRIES) part->flags |= PARTITION_LOGICAL;
+
+    // В записи для загрузочного сектора - абсолютный LBA
+    part->entry = *entry;
+    part->entry.lba_first = start;
+
+    name = mbr_type_name(entry->type);
+    if (name) {
+        ksnprintf(part->name, sizeof(part->name), "%s", name);
+    } else {
+        ksnprintf(part->name, sizeof(part->name), "Type %02X", entry->type);
+    }
+}
+
+// Логические разделы: в каждом EBR запись 0 - раздел (от этого EBR),
+// запись 1 - следующий EBR (от начала расширенного раздела)
+static void scan_ebr_chain(blockdev_t* dev, uint32_t base) {
+    uint32_t ebr = base;
+    uint8_t number = MBR_ENTRIES + 1;
+
+    for (int i = 0; i < MBR_MAX_LOGICAL; i++) {
+        mbr_entry_t entries[2];
+
+        if (!blockdev_read(dev, ebr, 1, sector)) return;
+        if (*(uint16_t*)(sector + 510) != MBR_SIGNATURE) return;
+        copy_bytes(entries, sector + MBR_TABLE_OFFSET, sizeof(entries));
+
+        if (entries[0].type != MBR_TYPE_EMPTY && entries[0].sectors) {
+            add_mbr_partition(dev, number++, &entries[0], ebr + entries[0].lba_first);
+        }
+        if (!is_extended(entries[1].type) || !entries[1].lba_first) return;
+        ebr = base + entries[1].lba_first;
+    }
+    TRACE_WARNING(BOOT, PART_ERROR, base, 0);
+}
+
+// Заголовок GPT: сигнатура, CRC32 (поле CRC при подсчете обнулено), свое место
+static uint8_t read_gpt_header(blockdev_t* dev, uint32_t lba, gpt_header_t* header) {
+    gpt_header_t* raw = (gpt_header_t*)sector;
+    uint32_t stored;
+
+    if (!blockdev_read(dev, lba, 1, sector)) return 0;
+    if (raw->signature[0] != GPT_SIGNATURE_LOW || raw->signature[1] != GPT_SIGNATURE_HIGH) return 0;
+    if (raw->header_size < GPT_HEADER_MIN_SIZE || raw->header_size > BLOCKDEV_SECTOR_SIZE) return 0;
+
+    stored = raw->header_crc32;
+    raw->header_crc32 = 0;
+    if (crc32(0, sector, raw->header_size) != stored) {
+        TRACE_WARNING(BOOT, PART_ERROR, lba, stored);
+        return 0;
+    }
+    raw->header_crc32 = stored;
+
+    if (raw->my_lba != lba || (raw->entries_lba >> 32)) return 0;
+    if (raw->entry_size < GPT_MIN_ENTRY_SIZE || (raw->entry_size & (raw->entry_size - 1)) ||
+        raw->entry_size > BLOCKDEV_SECTOR_SIZE) return 0;
+    if (!raw->entry_count ||
+        raw->entry_count > GPT_MAX_ARRAY_SECTORS * (BLOCKDEV_SECTOR_SIZE / raw->entry_size)) return 0;
+
+    copy_bytes(header, raw, sizeof(gpt_header_t));
+    return 1;
+}
+
+static void add_gpt_partition(blockdev_t* dev, uint32_t index, const gpt_entry_t* entry) {
+    partition_t* part;
+    uint32_t i;
+
+    // Разделы за 2 ТБ недоступны через 32-битный blockdev
+    if ((entry->first_lba >> 32) || (entry->last_lba >> 32) || entry->last_lba < entry->first_lba) return;
+
+    part = add_partition(dev, index + 1, PARTITION_SCHEME_GPT, (uint32_t)entry->first_lba,
+                         (uint32_t)(entry->last_lba - entry->first_lba) + 1);
+    if (!part) return;
+    if ((uint32_t)entry->attributes & GPT_ATTR_LEGACY_BOOT) part->flags |= PARTITION_ACTIVE;
+
+    // Имя UTF-16LE; вне ASCII - '?'
+    for (i = 0; i < sizeof(part->name) - 1 && entry->name[i]; i++) {
+        part->name[i] = entry->name[i] < 0x80 ? (char)entry->name[i] : '?';
+    }
+    part->name[i] = 0;
+    if (!part->name[0]) ksnprintf(part->name, sizeof(part->name), "%s", gpt_type_name(entry->type_guid));
+}
+
+// Один проход по массиву записей: чтение кусками, CRC32 и разбор сразу.
+// Если CRC не сошелся, добавленные разделы откатываются
+static uint8_t scan_gpt_entries(blockdev_t* dev, const gpt_header_t* header) {
+    uint32_t bytes = header->entry_count * header->entry_size;
+    uint32_t lba = (uint32_t)header->entries_lba;
+    uint32_t index = 0;
+    uint32_t crc = 0;
+    uint8_t first = count;
+
+    while (bytes) {
+        uint32_t chunk = bytes < sizeof(array_chunk) ? bytes : sizeof(array_chunk);
+        uint32_t sectors = (chunk + BLOCKDEV_SECTOR_SIZE - 1) / BLOCKDEV_SECTOR_SIZE;
+
+        if (!blockdev_read(dev, lba, sectors, array_chunk)) {
+            count = first;
+            return 0;
+        }
+        crc = crc32(crc, array_chunk, chunk);
+
+        for (uint32_t offset = 0; offset < chunk; offset += header->entry_size, index++) {
+            uint32_t* type = (uint32_t*)(array_chunk + offset);
+
+            // Нулевой GUID типа - запись не используется
+            if (type[0] | type[1] | type[2] | type[3]) {
+                add_gpt_partition(dev, index, (gpt_entry_t*)(array_chunk + offset));
+            }
+        }
+        lba += sectors;
+        bytes -= chunk;
+    }
+
+    if (crc != header->entries_crc32) {
+        TRACE_WARNING(BOOT, PART_ERROR, (uint32_t)header->entries_lba, crc);
+        count = first;
+        return 0;
+    }
+    return 1;
+}
+
+static uint8_t scan_gpt(blockdev_t* dev) {
+    gpt_header_t header;
+
+    if (read_gpt_header(dev, GPT_HEADER_LBA, &header) && scan_gpt_entries(dev, &header)) return 1;
+
+    // Резервная копия в последнем секторе
+    if (dev->sectors > GPT_HEADER_LBA + 1 && read_gpt_header(dev, dev->sectors - 1, &header)) {
+        return scan_gpt_entries(dev, &header);
+    }
+    return 0;
+}
+
+static void scan_device(blockdev_t* dev) {
+    mbr_entry_t entries[MBR_ENTRIES];
+    uint8_t gpt = 0;
+
+    if (!blockdev_read(dev, 0, 1, sector)) return;
+    if (*(uint16_t*)(sector + 510) != MBR_SIGNATURE) return;
+    copy_bytes(entries, sector + MBR_TABLE_OFFSET, sizeof(entries));
+
+    for (int i = 0; i < MBR_ENTRIES; i++) {
+        if (entries[i].type == MBR_TYPE_GPT) gpt = 1;
+    }
+    if (gpt) {
+        scan_gpt(dev);
+        return;
+    }
+
+    for (int i = 0; i < MBR_ENTRIES; i++) {
+        if (entries[i].type == MBR_TYPE_EMPTY || !entries[i].sectors) continue;
+        if (is_extended(entries[i].type)) {
+            scan_ebr_chain(dev, entries[i].lba_first);
+        } else {
+            add_mbr_partition(dev, i + 1, &entries[i], entries[i].lba_first);
+        }
+    }
+}
+
+uint8_t partition_scan(void) {
+    count = 0;
+    bootable_count = 0;
+
+    for (uint8_t i = 0; i < blockdev_count(); i++) {
+        scan_device(blockdev_get(i));
+    }
+
+    // Сектор раздела с 0xAA55 можно передать управление напрямую
+    for (uint8_t i = 0; i < count; i++) {
+        partition_t* part = &partitions[i];
+
+        if (blockdev_read(part->dev, part->start, 1, sector) &&
+            *(uint16_t*)(sector + 510) == MBR_SIGNATURE) {
+            part->flags |= PARTITION_BOOTABLE;
+            bootable_count++;
+        }
+        TRACE(BOOT, PARTITION, part->start, (part->scheme << 16) | (part->flags << 8) | part->type);
+    }
+    return count;
+}
+
+uint8_t partition_count(void) {
+    return count;
+}
+
+const partition_t* partition_get(uint8_t index) {
+    return index < count ? &partitions[index] : 0;
+}
+
+uint8_t partition_bootable_count(void) {
+    return bootable_count;
+}
+
+const char* partition_scheme_name(const partition_t* part) {
+    return part->scheme == PARTITION_SCHEME_GPT ? "GPT" : "MBR";
+}
@@ -0,0 +1,140 @@
+#include "pci.h"
+#include "ports.h"
+
+static pci_device_t devices[PCI_MAX_DEVICES];
+static uint8_t device_count = 0;
+static uint8_t scanned = 0;
+
+static uint32_t config_address(uint8_t bus, uint8_t slot, uint8_t func, uint8_t offset) {
+    return 0x80000000 | ((uint32_t)bus << 16) | ((uint32_t)slot << 11) |
+           ((uint32_t)func << 8) | (offset & 0xFC);
+}
+
+static uint32_t config_read(uint8_t bus, uint8_t slot, uint8_t func, uint8_t offset) {
+    outl(PCI_CONFIG_ADDRESS, config_address(bus, slot, func, offset));
+    return inl(PCI_CONFIG_DATA);
+}
+
+uint32_t pci_read32(const pci_device_t* dev, uint8_t offset) {
+    return config_read(dev->bus, dev->slot, dev->func, offset);
+}
+
+uint16_t pci_read16(const pci_device_t* dev, uint8_t offset) {
+    return pci_read32(dev, offset) >> ((offset & 2) * 8);
+}
+
+uint8_t pci_read8(const pci_device_t* dev, uint8_t offset) {
+    return pci_read32(dev, offset) >> ((offset & 3) * 8);
+}
+
+void pci_write32(const pci_device_t* dev, uint8_t offset, uint32_t value) {
+    outl(PCI_CONFIG_ADDRESS, config_address(dev->bus, dev->slot, dev->func, offset));
+    outl(PCI_CONFIG_DATA, value);
+}
+
+void pci_write16(const pci_device_t* dev, uint8_t offset, uint16_t value) {
+    uint32_t dword = pci_read32(dev, offset);
+    uint8_t shift = (offset & 2) * 8;
+
+    dword = (dword & ~(0xFFFF << shift)) | ((uint32_t)value << shift);
+    pci_write32(dev, offset, dword);
+}
+
+static void scan_function(uint8_t bus, uint8_t slot, uint8_t func) {
+    uint32_t id = config_read(bus, slot, func, PCI_VENDOR_ID);
+    if ((id & 0xFFFF) == 0xFFFF || device_count >= PCI_MAX_DEVICES) return;
+
+    pci_device_t* dev = &devices[device_count++];
+    uint32_t class_reg = config_read(bus, slot, func, 0x08);
+
+    dev->bus = bus;
+    dev->slot = slot;
+    dev->func = func;
+    dev->vendor_id = id & 0xFFFF;
+    dev->device_id = id >> 16;
+    dev->class_code = class_reg >> 24;
+    dev->subclass = (class_reg >> 16) & 0xFF;
+    dev->prog_if = (class_reg >> 8) & 0xFF;
+    dev->irq_line = config_read(bus, slot, func, PCI_INTERRUPT_LINE) & 0xFF;
+}
+
+// Полный перебор шин; функции 1-7 только у многофункциональных устройств
+static void pci_scan(void) {
+    if (scanned) return;
+    scanned = 1;
+
+    for (uint16_t bus = 0; bus < 256; bus++) {
+        for (uint8_t slot = 0; slot < 32; slot++) {
+            uint32_t id = config_read(bus, slot, 0, PCI_VENDOR_ID);
+            if ((id & 0xFFFF) == 0xFFFF) continue;
+
+            scan_function(bus, slot, 0);
+
+            uint8_t header = (config_read(bus, slot, 0, PCI_HEADER_TYPE) >> 16) & 0xFF;
+            if (header & 0x80) {
+                for (uint8_t func = 1; func < 8; func++) {
+                    scan_function(bus, slot, func);
+                }
+            }
+        }
+    }
+}
+
+uint8_t pci_device_count(void) {
+    pci_scan();
+    return device_count;
+}
+
+const pci_device_t* pci_get_device(uint8_t index) {
+    pci_scan();
+    return index < device_count ? &devices[index] : NULL;
+}
+
+const pci_device_t* pci_find_device(uint16_t vendor_id, uint16_t device_id) {
+    pci_scan();
+    for (uint8_t i = 0; i < device_count; i++) {
+        if (devices[i].vendor_id == vendor_id && devices[i].device_id == device_id) {
+            return &devices[i];
+        }
+    }
+    return NULL;
+}
+
+const pci_device_t* pci_find_class(uint8_t class_code, uint8_t subclass, uint8_t index) {
+    pci_scan();
+    for (uint8_t i = 0; i < device_count; i++) {
+        if (devices[i].class_code == class_code && devices[i].subclass == subclass) {
+            if (index == 0) return &devices[i];
+            index--;
+        }
+    }
+    return NULL;
+}
+
+uint32_t pci_bar(const pci_device_t* dev, uint8_t bar) {
+    uint32_t value = pci_read32(dev, PCI_BAR0 + bar * 4);
+
+    if (value & 0x01) {
+        return value & 0xFFFFFFFC;  // IO
+    }
+    return value & 0xFFFFFFF0;      // память
+}
+
+void pci_enable(const pci_device_t* dev, uint16_t command_bits) {
+    pci_write16(dev, PCI_COMMAND, pci_read16(dev, PCI_COMMAND) | command_bits);
+}
+
+uint8_t pci_find_capability(const pci_device_t* dev, uint8_t id, uint8_t offset) {
+    // Ограничение длины защищает от зацикленного списка
+    int limit = 48;
+
+    if (!(pci_read16(dev, PCI_STATUS) & PCI_STATUS_CAP_LIST)) return 0;
+
+    offset = offset ? pci_read8(dev, offset + 1) : pci_read8(dev, PCI_CAPABILITIES);
+    while (offset >= 0x40 && limit--) {
+        offset &= 0xFC;
+        if (pci_read8(dev, offset) == id) return offset;
+        offset = pci_read8(dev, offset + 1);
+    }
+    return 0;
+}
@@ -1,7 +1,13 @@
 #include "../include/post.h"
+#include "../include/timeline.h"
+#include "../include/cpu.h"
+#include "../include/timer.h"
+#include "../include/screen.h"
+#include "../include/trace.h"
 
 // Глобальные переменные для результатов тестов
 static uint8_t post_results = 0;
+static uint8_t fast_boot_active = 0;
 static uint16_t* video_mem = (uint16_t*)0xB8000;
 
 // Вспомогательные функции
@@ -16,7 +22,9 @@ static void outb(uint16_t port, uint8_t value) {
 }
 
 // Объявляем внешние функции из console.h
-extern void delay(uint32_t milliseconds);
+extern uint8_t read_cmos(uint8_t reg);
+extern void print_string(const char* str, uint8_t x, uint8_t y, uint8_t color);
+extern void write_cmos(uint8_t reg, uint8_t value);
 
 // Определения констант
 #define KEYBOARD_STATUS_PORT 0x64
@@ -28,36 +36,147 @@ extern void delay(uint32_t milliseconds);
 #define PIT_CHANNEL2 0x42
 #define SPEAKER_PORT 0x61
 
+// Быстрая загрузка: флаги и отпечаток последнего успешного полного POST
+#define CMOS_FAST_BOOT      0x24
+#define CMOS_FINGERPRINT_0  0x25    // 4 байта, 0x25-0x28
+#define CMOS_HW_ERROR_COUNT 0x23
+#define IDE_STATUS_STABLE   0xE9    // BSY, DRDY, DF, DRQ, ERR (без IDX/DSC)
+
+static uint32_t fingerprint_mix(uint32_t hash, uint32_t value) {
+    // FNV-1a по байтам
+    for (int i = 0; i < 4; i++) {
+        hash ^= value & 0xFF;
+        hash *= 16777619;
+        value >>= 8;
+    }
+    return hash;
+}
+
+// Отпечаток оборудования: сигнатура CPU, размер памяти из CMOS,
+// состояние IDE и счетчик аппаратных ошибок. Только регистры памяти
+// 0x30/0x31 и 0x34/0x35: 0x12-0x19 заняты паролем
+static uint32_t post_fingerprint(void) {
+    static const uint8_t memory_regs[] = { 0x30, 0x31, 0x34, 0x35 };
+    uint32_t hash = 2166136261U;
+    
+    hash = fingerprint_mix(hash, cpu_signature());
+    
+    for (int i = 0; i < (int)sizeof(memory_regs); i++) {
+        hash = fingerprint_mix(hash, read_cmos(memory_regs[i]));
+    }
+    
+    hash = fingerprint_mix(hash, inb(IDE_STATUS) & IDE_STATUS_STABLE);
+    hash = fingerprint_mix(hash, read_cmos(CMOS_HW_ERROR_COUNT));
+    
+    // 0 зарезервирован под "отпечатка нет"
+    return hash ? hash : 1;
+}
+
+static uint32_t post_stored_fingerprint(void) {
+    uint32_t value = 0;
+    for (int i = 3; i >= 0; i--) {
+        value = (value << 8) | read_cmos(CMOS_FINGERPRINT_0 + i);
+    }
+    return value;
+}
+
+static void post_store_fingerprint(uint32_t value) {
+    for (int i = 0; i < 4; i++) {
+        write_cmos(CMOS_FINGERPRINT_0 + i, value & 0xFF);
+        value >>= 8;
+    }
+}
+
+// Звуковой сигнал успешного теста - в быстром режиме пропускаем
+static void post_ok_beep(uint32_t frequency) {
+    if (!fast_boot_active) {
+        beep(frequency, 50);
+    }
+}
+
+uint8_t post_fast_boot_active(void) {
+    return fast_boot_active;
+}
+
+uint8_t post_get_fast_boot(void) {
+    return (read_cmos(CMOS_FAST_BOOT) & POST_FAST_BOOT_ENABLED) != 0;
+}
+
+void post_set_fast_boot(uint8_t enabled) {
+    uint8_t flags = read_cmos(CMOS_FAST_BOOT) & POST_FORCE_FULL;
+    if (enabled) flags |= POST_FAST_BOOT_ENABLED;
+    write_cmos(CMOS_FAST_BOOT, flags);
+}
+
+void post_force_full_next_boot(void) {
+    write_cmos(CMOS_FAST_BOOT, read_cmos(CMOS_FAST_BOOT) | POST_FORCE_FULL);
+}
+
+void post_invalidate_fingerprint(void) {
+    post_store_fingerprint(0);
+}
+
 uint8_t run_post(void) {
     post_results = POST_SUCCESS;
     
+    // Быстрая загрузка, если оборудование не менялось с последнего полного POST
+    uint8_t flags = read_cmos(CMOS_FAST_BOOT);
+    uint32_t fingerprint = post_fingerprint();
+    fast_boot_active = (flags & POST_FAST_BOOT_ENABLED) &&
+                       !(flags & POST_FORCE_FULL) &&
+                       fingerprint == post_stored_fingerprint();
+    TRACE(POST, BEGIN, fast_boot_active, 0);
+    
     // 1. Тест процессора
     post_cpu_test();
+    timeline_mark(TL_POST_CPU);
+    TRACE(POST, TEST, TL_POST_CPU, post_results);
     if (post_results != POST_SUCCESS) return post_results;
     
     // 2. Тест памяти
     post_memory_test();
+    timeline_mark(TL_POST_MEMORY);
+    TRACE(POST, TEST, TL_POST_MEMORY, post_results);
     if (post_results != POST_SUCCESS) return post_results;
     
     // 3. Тест видео
     post_video_test();
+    timeline_mark(TL_POST_VIDEO);
+    TRACE(POST, TEST, TL_POST_VIDEO, post_results);
     if (post_results != POST_SUCCESS) return post_results;
     
+    // Клавиатура, диск и CMOS уже подтверждены отпечатком
+    if (fast_boot_active) {
+        return post_results;
+    }
+    
     // 4. Тест клавиатуры
     post_keyboard_test();
+    timeline_mark(TL_POST_KEYBOARD);
+    TRACE(POST, TEST, TL_POST_KEYBOARD, post_results);
     if (post_results != POST_SUCCESS) return post_results;
     
     // 5. Тест диска
     post_disk_test();
+    timeline_mark(TL_POST_DISK);
+    TRACE(POST, TEST, TL_POST_DISK, post_results);
     if (post_results != POST_SUCCESS) return post_results;
     
     // 6. Тест CMOS
     post_cmos_test();
+    timeline_mark(TL_POST_CMOS);
+    TRACE(POST, TEST, TL_POST_CMOS, post_results);
+    if (post_results != POST_SUCCESS) return post_results;
+    
+    // Запоминаем отпечаток успешного полного POST
+    post_store_fingerprint(fingerprint);
+    write_cmos(CMOS_FAST_BOOT, flags & ~POST_FORCE_FULL);
     
     // Успешный звуковой сигнал
     beep(1000, 100);
-    delay(500); // Используем delay из console.h
+    mdelay(50);
     beep(1500, 100);
+    timeline_mark(TL_POST_DONE);
     
     return post_results;
 }
@@ -88,7 +207,7 @@ void post_cpu_test(void) {
     }
     
     // Успешный звуковой сигнал для CPU
-    beep(800, 50);
+    post_ok_beep(800);
 }
 
 void post_memory_test(void) {
@@ -112,7 +231,7 @@ void post_memory_test(void) {
     }
     
     // Успешный звуковой сигнал для памяти
-    beep(900, 50);
+    post_ok_beep(900);
 }
 
 void post_video_test(void) {
@@ -134,8 +253,11 @@ void post_video_test(void) {
         video_mem[i] = 0x0720;
     }
     
+    // Тест писал в видеопамять напрямую, мимо теневого буфера
+    screen_invalidate();
+    
     // Успешный звуковой сигнал для видео
-    beep(1000, 50);
+    post_ok_beep(1000);
 }
 
 void post_keyboard_test(void) {
@@ -153,7 +275,7 @@ void post_keyboard_test(void) {
     while ((inb(KEYBOARD_STATUS_PORT) & 0x01) && timeout > 0) {
         // Читаем и отбрасываем данные из буфера
         inb(KEYBOARD_DATA_PORT);
-        delay(1); // Используем delay из console.h
+        udelay(50);
         timeout--;
     }
     
@@ -167,7 +289,7 @@ void post_keyboard_test(void) {
     }
     
     // Успешный звуковой сигнал для клавиатуры
-    beep(1100, 50);
+    post_ok_beep(1100);
 }
 
 void post_disk_test(void) {
@@ -189,7 +311,7 @@ void post_disk_test(void) {
     }
     
     // Успешный звуковой сигнал для диска
-    beep(1200, 50);
+    post_ok_beep(1200);
 }
 
 void post_cmos_test(void) {
@@ -214,10 +336,13 @@ void post_cmos_test(void) {
     }
     
     // Успешный звуковой сигнал для CMOS
-    beep(1300, 50);
+    post_ok_beep(1300);
 }
 
 void show_post_error(uint8_t error_code) {
+    // Следующая загрузка - полный POST
+    post_invalidate_fingerprint();
+    
     const char* error_messages[] = {
         "POST: All tests passed",
         "CPU Test Failed",
@@ -229,15 +354,13 @@ void show_post_error(uint8_t error_code) {
     };
     
     // Выводим сообщение об ошибке
-    const char* msg = error_messages[error_code];
-    for (int i = 0; msg[i] != '\0'; i++) {
-        video_mem[i] = 0x4F00 | msg[i]; // Красный фон
-    }
+    print_string(error_messages[error_code], 0, 0, 0x4F); // Красный фон
+    screen_flush();
     
     // Издаем звук ошибки
     for (int i = 0; i < 3; i++) {
         beep(300, 200);
-        delay(100); // Используем delay из console.h
+        mdelay(100);
     }
 }
 
@@ -252,14 +375,14 @@ void beep(uint32_t frequency, uint32_t duration) {
     uint8_t tmp = inb(SPEAKER_PORT);
     outb(SPEAKER_PORT, tmp | 0x03);
     
-    // Ждем
-    delay(duration);
+    // Ждем (duration в миллисекундах)
+    mdelay(duration);
     
     // Выключаем динамик
     tmp = inb(SPEAKER_PORT);
     outb(SPEAKER_PORT, tmp & 0xFC);
 }
 
-void post_delay(uint32_t count) {
-    for (volatile uint32_t i = 0; i < count; i++);
+void post_delay(uint32_t milliseconds) {
+    mdelay(milliseconds);
 }
@@ -0,0 +1,120 @@
+#include "realmode.h"
+
+#define STR(x)  #x
+#define XSTR(x) STR(x)
+#define REG(offset) XSTR(REALMODE_REGS_ADDR + offset)
+
+// Заглушка копируется по REALMODE_STUB_ADDR и выполняется там, поэтому
+// все адреса внутри нее считаются от этого адреса, а не от места сборки
+__asm__ (
+    ".pushsection .text\n"
+    "realmode_stub:\n"
+    // 32-битная часть: перенос образа, payload больше не выполняется
+    "    movl " REG(0x18) ", %esi\n"
+    "    movl " REG(0x1C) ", %edi\n"
+    "    movl " REG(0x20) ", %ecx\n"
+    "    cld\n"
+    "    rep movsb\n"
+    "    ljmp $" XSTR(REALMODE_CODE_SEL) ", $(realmode_stub_pm16 - realmode_stub + " XSTR(REALMODE_STUB_ADDR) ")\n"
+    "realmode_stub_pm16:\n"
+    ".code16\n"
+    // 16-битный защищенный режим: сегменты с лимитом 64 КБ
+    "    movw $" XSTR(REALMODE_DATA_SEL) ", %ax\n"
+    "    movw %ax, %ds\n"
+    "    movw %ax, %es\n"
+    "    movw %ax, %fs\n"
+    "    movw %ax, %gs\n"
+    "    movw %ax, %ss\n"
+    "    movl %cr0, %eax\n"
+    "    andl $0xFFFFFFFE, %eax\n"
+    "    movl %eax, %cr0\n"
+    "    ljmp $0, $(realmode_stub_rm - realmode_stub + " XSTR(REALMODE_STUB_ADDR) ")\n"
+    "realmode_stub_rm:\n"
+    "    xorw %ax, %ax\n"
+    "    movw %ax, %ds\n"
+    "    movw %ax, %fs\n"
+    "    movw %ax, %gs\n"
+    "    movw " REG(0x04) ", %ss\n"
+    "    movw " REG(0x06) ", %sp\n"
+    "    movw " REG(0x0A) ", %es\n"
+    "    movw " REG(0x0C) ", %si\n"
+    "    movw " REG(0x0E) ", %di\n"
+    "    movl " REG(0x10) ", %ebx\n"
+    "    movl " REG(0x14) ", %edx\n"
+    "    pushw " REG(0x02) "\n"
+    "    pushw " REG(0x00) "\n"
+    "    movw " REG(0x08) ", %ax\n"
+    "    movw %ax, %ds\n"
+    "    xorl %eax, %eax\n"
+    "    sti\n"
+    "    lret\n"
+    "realmode_stub_end:\n"
+    ".code32\n"
+    ".popsection\n"
+);
+
+extern char realmode_stub[];
+extern char realmode_stub_end[];
+
+typedef struct {
+    uint16_t limit;
+    uint32_t base;
+} __attribute__((packed)) realmode_gdtr_t;
+
+void realmode_jump(const realmode_regs_t* regs) {
+    uint32_t stub_size = realmode_stub_end - realmode_stub;
+    uint8_t* stub = (uint8_t*)REALMODE_STUB_ADDR;
+    uint32_t* gdt = (uint32_t*)REALMODE_GDT_ADDR;
+    realmode_gdtr_t* gdtr = (realmode_gdtr_t*)REALMODE_GDTR_ADDR;
+
+    if (stub_size > REALMODE_STUB_MAX) return;
+
+    __asm__ volatile ("cli");
+
+    for (uint32_t i = 0; i < stub_size; i++) {
+        stub[i] = realmode_stub[i];
+    }
+    *(realmode_regs_t*)REALMODE_REGS_ADDR = *regs;
+
+    // Пустой, код и данные: база 0, лимит 0xFFFF, 16 бит, байтовая гранулярность;
+    // затем плоский 32-битный код для переноса образа
+    gdt[0] = 0;
+    gdt[1] = 0;
+    gdt[2] = 0x0000FFFF;
+    gdt[3] = 0x00009A00;
+    gdt[4] = 0x0000FFFF;
+    gdt[5] = 0x00009200;
+    gdt[6] = 0x0000FFFF;
+    gdt[7] = 0x00CF9A00;
+    gdtr->limit = 8 * 4 - 1;
+    gdtr->base = REALMODE_GDT_ADDR;
+
+    __asm__ volatile (
+        "lgdt (%0)\n"
+        "pushl %1\n"
+        "pushl %2\n"
+        "lret\n"
+        :
+        : "r" (gdtr), "i" (REALMODE_FLAT_CODE_SEL), "i" (REALMODE_STUB_ADDR)
+        : "memory"
+    );
+    __builtin_unreachable();
+}
+
+uint32_t realmode_load_max(void) {
+    uint32_t end = (uint32_t)*(volatile uint16_t*)REALMODE_BDA_BASE_MEM * 1024;
+
+    // Слово не заполнено - считаем всю низкую память
+    if (end == 0 || end > REALMODE_LOW_MEM_END) end = REALMODE_LOW_MEM_END;
+    return end;
+}
+
+void realmode_boot_sector(uint8_t bios_drive, uint16_t part_entry) {
+    realmode_regs_t regs = {0};
+
+    regs.ip = 0x7C00;
+    regs.sp = 0x7C00;
+    regs.si = part_entry;
+    regs.edx = bios_drive;
+    realmode_jump(&regs);
+}
@@ -1,15 +1,16 @@
 #include "rtc.h"
 #include "console.h"
 #include "cpu.h"
+#include "timer.h"
+#include "kprintf.h"
 
 // Внешние функции
 extern uint8_t read_cmos(uint8_t reg);
 extern void print_string(const char* str, uint8_t x, uint8_t y, uint8_t color);
 extern void print_char(char c, uint8_t x, uint8_t y, uint8_t color);
-extern void delay(uint32_t count);
 
 // Статические переменные для обновления дисплея
-static uint32_t time_update_counter = 0;
+static deadline_t next_display_update = 0;
 static cmos_time_t current_time;
 
 // Конвертация BCD в двоичный формат
@@ -19,9 +20,10 @@ uint8_t cmos_bcd_to_bin(uint8_t bcd) {
 
 // Ожидание обновления CMOS (для безопасного чтения)
 void cmos_wait_for_update(void) {
-    // Ждем, пока не закончится обновление
-    while (read_cmos(CMOS_STATUS_A) & 0x80) {
-        delay(10);
+    // Ждем, пока не закончится обновление (длится не более ~2 мс)
+    deadline_t deadline = deadline_after_ms(CMOS_UPDATE_TIMEOUT_MS);
+    while ((read_cmos(CMOS_STATUS_A) & 0x80) && !deadline_expired(deadline)) {
+        udelay(10);
     }
 }
 
@@ -83,27 +85,13 @@ void cmos_read_time(cmos_time_t *time) {
 
 // Отображение времени
 void cmos_display_time(void) {
-    char time_str[9];
-    
-    // Форматируем время HH:MM:SS
-    time_str[0] = '0' + current_time.hour / 10;
-    time_str[1] = '0' + current_time.hour % 10;
-    time_str[2] = ':';
-    time_str[3] = '0' + current_time.minute / 10;
-    time_str[4] = '0' + current_time.minute % 10;
-    time_str[5] = ':';
-    time_str[6] = '0' + current_time.second / 10;
-    time_str[7] = '0' + current_time.second % 10;
-    time_str[8] = '\0';
-    
-    // Отображаем время в правом нижнем углу
-    print_string("Time: ", 59, 22, 0x0F);
-    print_string(time_str, 65, 22, 0x0F);
+    // Время HH:MM:SS в правом нижнем углу
+    kprintf(59, 22, 0x0F, "Time: %02u:%02u:%02u",
+            current_time.hour, current_time.minute, current_time.second);
 }
 
 // Отображение даты
 void cmos_display_date(void) {
-    char date_str[12];
     const char* month_names[] = {
         "Jan", "Feb", "Mar", "Apr", "May", "Jun",
         "Jul", "Aug", "Sep", "Oct", "Nov", "Dec"
@@ -114,41 +102,16 @@ void cmos_display_date(void) {
     };
     
     // Формат: Wed 15-Jan-2025
-    // День недели (первые 3 буквы)
-    date_str[0] = day_names[current_time.weekday % 7][0];
-    date_str[1] = day_names[current_time.weekday % 7][1];
-    date_str[2] = day_names[current_time.weekday % 7][2];
-    date_str[3] = ' ';
-    
-    // Число
-    date_str[4] = '0' + current_time.day / 10;
-    date_str[5] = '0' + current_time.day % 10;
-    date_str[6] = '-';
-    
-    // Месяц (3 буквы)
-    date_str[7] = month_names[current_time.month - 1][0];
-    date_str[8] = month_names[current_time.month - 1][1];
-    date_str[9] = month_names[current_time.month - 1][2];
-    date_str[10] = '-';
-    
-    // Год
-    date_str[11] = '0' + (current_time.year / 1000) % 10;
-    date_str[12] = '0' + (current_time.year / 100) % 10;
-    date_str[13] = '0' + (current_time.year / 10) % 10;
-    date_str[14] = '0' + current_time.year % 10;
-    date_str[15] = '\0';
-    
-    // Отображаем дату
-    print_string("Date: ", 59, 23, 0x0F);
-    print_string(date_str, 65, 23, 0x0F);
+    kprintf(59, 23, 0x0F, "Date: %s %02u-%s-%04u",
+            day_names[current_time.weekday % 7], current_time.day,
+            month_names[(current_time.month + 11) % 12], current_time.year);
 }
 
 // Обновление дисплея времени
 void cmos_update_display(void) {
-    time_update_counter++;
-    
-    // Обновляем каждые ~500 мс (настраиваемо)
-    if (time_update_counter % 5000 == 0) {
+    // Обновляем каждые CMOS_DISPLAY_PERIOD_MS
+    if (deadline_expired(next_display_update)) {
+        next_display_update = deadline_after_ms(CMOS_DISPLAY_PERIOD_MS);
         cmos_read_time(&current_time);
         cmos_display_time();
         cmos_display_date();
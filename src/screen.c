@@ -0,0 +1,225 @@
+#include "screen.h"
+#include "ports.h"
+#include "gfx.h"
+#include "serial.h"
+
+#define SCREEN_CELLS (SCREEN_WIDTH * SCREEN_HEIGHT)
+
+// Теневой буфер и копия того, что сейчас лежит в видеопамяти
+static uint16_t shadow[SCREEN_CELLS];
+static uint16_t front[SCREEN_CELLS];
+
+// Грязный диапазон столбцов для каждой строки; min > max - строка чистая.
+// Пока front_valid = 0, содержимое видеопамяти неизвестно и flush пишет все.
+static uint8_t dirty_min[SCREEN_HEIGHT];
+static uint8_t dirty_max[SCREEN_HEIGHT];
+static uint8_t front_valid = 0;
+
+static screen_stats_t stats;
+static uint8_t suspended = 0;
+// Графический режим, выключенный на время прямого доступа к видеопамяти
+static uint8_t graphics_on_resume = 0;
+
+// Регистры CRTC
+#define CRTC_INDEX          0x3D4
+#define CRTC_DATA           0x3D5
+#define CRTC_START_HIGH     0x0C
+#define CRTC_START_LOW      0x0D
+
+static void mark_dirty(uint32_t pos) {
+    uint32_t y = pos / SCREEN_WIDTH;
+    uint8_t x = pos % SCREEN_WIDTH;
+
+    if (!front_valid) return;   // все равно будет полный вывод
+
+    if (dirty_min[y] > dirty_max[y]) {
+        dirty_min[y] = x;
+        dirty_max[y] = x;
+    } else if (x < dirty_min[y]) {
+        dirty_min[y] = x;
+    } else if (x > dirty_max[y]) {
+        dirty_max[y] = x;
+    }
+}
+
+static void put_cell(uint32_t pos, uint16_t cell) {
+    stats.cells_drawn++;
+    if (shadow[pos] == cell) return;
+
+    shadow[pos] = cell;
+    mark_dirty(pos);
+}
+
+// Копирование в видеопамять: пары ячеек через rep movsl, остаток - movsw
+static void vga_copy(uint16_t* dst, const uint16_t* src, uint32_t cells) {
+    uint32_t pairs = cells >> 1;
+
+    __asm__ volatile ("rep movsl" : "+D" (dst), "+S" (src), "+c" (pairs) : : "memory");
+    if (cells & 1) {
+        __asm__ volatile ("movsw" : "+D" (dst), "+S" (src) : : "memory");
+    }
+}
+
+// В графическом режиме ячейки рисуются глифами в линейный буфер
+static void gfx_copy(uint32_t start, uint32_t end) {
+    for (uint32_t i = start; i < end; i++) {
+        gfx_draw_cell(i % SCREEN_WIDTH, i / SCREEN_WIDTH, shadow[i]);
+    }
+}
+
+static uint32_t flush_span(uint32_t start, uint32_t end) {
+    // Выравниваем начало на dword для rep movsl
+    if (start & 1) start--;
+
+    if (gfx_active()) {
+        gfx_copy(start, end);
+    } else {
+        vga_copy((uint16_t*)SCREEN_VIDEO_MEMORY + start, shadow + start, end - start);
+    }
+    for (uint32_t i = start; i < end; i++) {
+        front[i] = shadow[i];
+    }
+    serial_console_cells(start, shadow + start, end - start);
+    return end - start;
+}
+
+static uint32_t flush_row(uint32_t y) {
+    uint32_t base = y * SCREEN_WIDTH;
+    uint32_t x = dirty_min[y];
+    uint32_t end = dirty_max[y] + 1;
+    uint32_t cells = 0;
+
+    while (x < end) {
+        // Пропускаем совпадающие ячейки
+        while (x < end && shadow[base + x] == front[base + x]) x++;
+        if (x >= end) break;
+
+        // Отрезок до последнего изменения; короткие совпадения внутри склеиваем
+        uint32_t start = x;
+        uint32_t last = x;
+        while (x < end) {
+            if (shadow[base + x] != front[base + x]) {
+                last = x;
+            } else if (x - last > SCREEN_SPAN_MERGE_GAP) {
+                break;
+            }
+            x++;
+        }
+
+        cells += flush_span(base + start, base + last + 1);
+    }
+
+    dirty_min[y] = SCREEN_WIDTH;
+    dirty_max[y] = 0;
+    return cells;
+}
+
+void screen_flush(void) {
+    uint32_t cells = 0;
+
+    if (suspended) return;
+
+    if (!front_valid) {
+        serial_console_clear();
+        cells = flush_span(0, SCREEN_CELLS);
+        front_valid = 1;
+        for (int y = 0; y < SCREEN_HEIGHT; y++) {
+            dirty_min[y] = SCREEN_WIDTH;
+            dirty_max[y] = 0;
+        }
+    } else {
+        for (int y = 0; y < SCREEN_HEIGHT; y++) {
+            if (dirty_min[y] <= dirty_max[y]) {
+                cells += flush_row(y);
+            }
+        }
+    }
+
+    if (cells == 0) return;
+    if (gfx_active()) gfx_sync();
+
+    stats.frames++;
+    stats.cells_last = cells;
+    stats.cells_total += cells;
+    if (cells > stats.cells_peak) stats.cells_peak = cells;
+}
+
+void screen_invalidate(void) {
+    front_valid = 0;
+}
+
+// Начало отображаемой области видеопамяти (в ячейках)
+void screen_set_start(uint16_t cell_offset) {
+    outb(CRTC_INDEX, CRTC_START_HIGH);
+    outb(CRTC_DATA, cell_offset >> 8);
+    outb(CRTC_INDEX, CRTC_START_LOW);
+    outb(CRTC_DATA, cell_offset & 0xFF);
+}
+
+void screen_suspend(void) {
+    suspended = 1;
+    graphics_on_resume = gfx_active();
+    gfx_leave();
+}
+
+void screen_resume(void) {
+    suspended = 0;
+    screen_set_start(0);
+    if (graphics_on_resume) gfx_enter();
+    screen_invalidate();
+    screen_flush();
+}
+
+// Вывод сетки через графический режим; при ошибке остается текст
+uint8_t screen_use_graphics(uint8_t enable) {
+    if (enable) {
+        if (!gfx_enter()) return 0;
+    } else {
+        gfx_leave();
+    }
+
+    screen_invalidate();
+    screen_flush();
+    return 1;
+}
+
+const screen_stats_t* screen_get_stats(void) {
+    return &stats;
+}
+
+// ==================== ВИДЕОФУНКЦИИ ====================
+
+// Очистка экрана
+void clear_screen(uint8_t color) {
+    uint16_t blank = (color << 8) | ' ';
+    for (int i = 0; i < SCREEN_CELLS; i++) {
+        put_cell(i, blank);
+    }
+}
+
+// Вывод строки (перенос на следующую строку, обрезка по концу экрана)
+void print_string(const char* str, uint8_t x, uint8_t y, uint8_t color) {
+    uint32_t pos = y * SCREEN_WIDTH + x;
+    while (*str && pos < SCREEN_CELLS) {
+        put_cell(pos++, (color << 8) | (uint8_t)*str++);
+    }
+}
+
+// Кусок строки по линейной позиции (kprintf пишет в буфер без промежуточной строки)
+void screen_write(uint32_t pos, const char* str, uint32_t len, uint8_t color) {
+    uint16_t attr = color << 8;
+
+    if (pos >= SCREEN_CELLS) return;
+    if (len > SCREEN_CELLS - pos) len = SCREEN_CELLS - pos;
+    for (uint32_t i = 0; i < len; i++) {
+        put_cell(pos + i, attr | (uint8_t)str[i]);
+    }
+}
+
+// Вывод символа
+void print_char(char c, uint8_t x, uint8_t y, uint8_t color) {
+    uint32_t pos = y * SCREEN_WIDTH + x;
+    if (pos < SCREEN_CELLS) {
+        put_cell(pos, (color << 8) | (uint8_t)c);
+    }
+}
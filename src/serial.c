@@ -0,0 +1,490 @@
+#include "serial.h"
+#include "interrupts.h"
+#include "timer.h"
+#include "ports.h"
+#include "kprintf.h"
+#include "screen.h"
+
+// Регистры 16550 (смещения от базового порта)
+#define UART_DATA       0   // RBR/THR, DLL при DLAB
+#define UART_IER        1   // DLM при DLAB
+#define UART_IIR        2   // FCR при записи
+#define UART_LCR        3
+#define UART_MCR        4
+#define UART_LSR        5
+#define UART_MSR        6
+#define UART_SCRATCH    7
+
+#define IER_RX          0x01
+#define IER_THRE        0x02
+
+#define IIR_NO_INT      0x01
+#define IIR_ID_MASK     0x0E
+#define IIR_THRE        0x02
+#define IIR_RX_DATA     0x04
+#define IIR_LINE_STATUS 0x06
+#define IIR_RX_TIMEOUT  0x0C
+#define IIR_FIFO_ON     0xC0
+
+#define LCR_8N1         0x03
+#define LCR_DLAB        0x80
+#define FCR_ENABLE_14   0xC7    // FIFO вкл., сброс обоих, порог приема 14 байт
+#define MCR_DTR_RTS_OUT2 0x0B   // OUT2 пропускает IRQ на контроллер
+#define LSR_DATA_READY  0x01
+#define LSR_THRE        0x20
+#define LSR_TEMT        0x40
+
+#define EFLAGS_IF       0x200
+
+// Скан-коды для клавиш, приходящих последовательностями
+#define SC_ESC          0x01
+#define SC_BACKSPACE    0x0E
+#define SC_TAB          0x0F
+#define SC_ENTER        0x1C
+#define SC_LEFT_SHIFT   0x2A
+#define SC_F1           0x3B
+#define SC_F6           0x40
+#define SC_HOME         0x47
+#define SC_UP           0x48
+#define SC_PGUP         0x49
+#define SC_LEFT         0x4B
+#define SC_RIGHT        0x4D
+#define SC_END          0x4F
+#define SC_DOWN         0x50
+#define SC_PGDN         0x51
+#define SC_INSERT       0x52
+#define SC_DELETE       0x53
+
+enum { RX_NORMAL, RX_ESC, RX_CSI, RX_SS3 };
+
+static uint16_t base = 0;
+static uint8_t available = 0;
+static uint8_t fifo_depth = 1;
+
+// Кольцо передачи: пишет основной код, читает обработчик IRQ
+static char tx_ring[SERIAL_TX_RING_SIZE];
+static volatile uint32_t tx_head = 0;
+static volatile uint32_t tx_tail = 0;
+
+// Разбор входящих последовательностей
+static uint8_t rx_state = RX_NORMAL;
+static uint8_t rx_param = 0;
+static deadline_t esc_deadline = 0;
+
+// Состояние терминала: позиция курсора (-1 - неизвестна) и текущий атрибут
+static int32_t term_cursor = -1;
+static int16_t term_attr = -1;
+static uint8_t term_blank = 0;
+
+// Цвета CGA в порядке ANSI
+static const uint8_t ansi_color[8] = { 0, 4, 2, 6, 1, 5, 3, 7 };
+
+static uint32_t irq_save(void) {
+    uint32_t flags;
+    __asm__ volatile ("pushfl; popl %0; cli" : "=r" (flags) : : "memory");
+    return flags;
+}
+
+static void irq_restore(uint32_t flags) {
+    if (flags & EFLAGS_IF) __asm__ volatile ("sti" : : : "memory");
+}
+
+// ==================== ПЕРЕДАЧА ====================
+
+// FIFO пуст - дозаполняем его целиком
+static void tx_fill(void) {
+    if (!(inb(base + UART_LSR) & LSR_THRE)) return;
+
+    for (uint8_t n = 0; n < fifo_depth && tx_tail != tx_head; n++) {
+        outb(base + UART_DATA, tx_ring[tx_tail & (SERIAL_TX_RING_SIZE - 1)]);
+        tx_tail++;
+    }
+}
+
+static void tx_update_ier(void) {
+    outb(base + UART_IER, IER_RX | (tx_tail != tx_head ? IER_THRE : 0));
+}
+
+static void tx_kick(void) {
+    uint32_t flags = irq_save();
+    tx_fill();
+    tx_update_ier();
+    irq_restore(flags);
+}
+
+// Кольцо заполнено: с прерываниями его разгружает IRQ, без них - опрос
+static void tx_wait(uint32_t flags) {
+    tx_kick();
+    if (interrupts_active() && (flags & EFLAGS_IF)) {
+        __asm__ volatile ("pause");
+    } else {
+        while (!(inb(base + UART_LSR) & LSR_THRE)) {
+            __asm__ volatile ("pause");
+        }
+    }
+}
+
+void serial_write(const char* data, uint32_t len) {
+    uint32_t flags;
+
+    if (!available) return;
+
+    __asm__ volatile ("pushfl; popl %0" : "=r" (flags));
+    for (uint32_t i = 0; i < len; i++) {
+        while (tx_head - tx_tail >= SERIAL_TX_RING_SIZE) tx_wait(flags);
+        tx_ring[tx_head & (SERIAL_TX_RING_SIZE - 1)] = data[i];
+        tx_head++;
+    }
+    tx_kick();
+}
+
+static void serial_sink(void* ctx, const char* str, uint32_t len, uint8_t color) {
+    (void)ctx;
+    (void)color;
+    serial_write(str, len);
+}
+
+static void serial_printf(const char* fmt, ...) {
+    va_list args;
+
+    va_start(args, fmt);
+    kvprintf(serial_sink, 0, 0, fmt, args);
+    va_end(args);
+}
+
+// ==================== ПРИЕМ ====================
+
+static void push_key(uint8_t scancode) {
+    kbd_queue_push(scancode);
+    kbd_queue_push(scancode | 0x80);
+}
+
+// Символ с Shift приходит как на настоящей клавиатуре:
+// нажатие левого Shift, клавиша, отпускание Shift
+static void push_shifted_key(uint8_t scancode) {
+    kbd_queue_push(SC_LEFT_SHIFT);
+    push_key(scancode);
+    kbd_queue_push(SC_LEFT_SHIFT | 0x80);
+}
+
+// *shifted = 1 для заглавных букв и верхнего ряда символов
+static uint8_t ascii_to_scancode(char c, uint8_t* shifted) {
+    static const char row1[] = "1234567890-=";
+    static const char row2[] = "qwertyuiop[]";
+    static const char row3[] = "asdfghjkl;'`";
+    static const char row4[] = "\\zxcvbnm,./";
+    static const char shift_row1[] = "!@#$%^&*()_+";
+    static const char shift_row2[] = "QWERTYUIOP{}";
+    static const char shift_row3[] = "ASDFGHJKL:\"~";
+    static const char shift_row4[] = "|ZXCVBNM<>?";
+
+    *shifted = 0;
+
+    // '*' и '+' - клавиши цифрового блока, как в get_ascii_char(), без Shift
+    switch (c) {
+        case '*': return 0x37;
+        case '+': return 0x4E;
+    }
+
+    for (uint8_t i = 0; row1[i]; i++) if (row1[i] == c) return 0x02 + i;
+    for (uint8_t i = 0; row2[i]; i++) if (row2[i] == c) return 0x10 + i;
+    for (uint8_t i = 0; row3[i]; i++) if (row3[i] == c) return 0x1E + i;
+    for (uint8_t i = 0; row4[i]; i++) if (row4[i] == c) return 0x2B + i;
+
+    *shifted = 1;
+    for (uint8_t i = 0; shift_row1[i]; i++) if (shift_row1[i] == c) return 0x02 + i;
+    for (uint8_t i = 0; shift_row2[i]; i++) if (shift_row2[i] == c) return 0x10 + i;
+    for (uint8_t i = 0; shift_row3[i]; i++) if (shift_row3[i] == c) return 0x1E + i;
+    for (uint8_t i = 0; shift_row4[i]; i++) if (shift_row4[i] == c) return 0x2B + i;
+    *shifted = 0;
+
+    switch (c) {
+        case ' ': return 0x39;
+        case '\t': return SC_TAB;
+        case '\r': return SC_ENTER;
+        case 0x08:
+        case 0x7F: return SC_BACKSPACE;
+    }
+    return 0;
+}
+
+// Конец CSI-последовательности: ESC [ <param> <final>
+static uint8_t csi_to_scancode(uint8_t param, char final) {
+    switch (final) {
+        case 'A': return SC_UP;
+        case 'B': return SC_DOWN;
+        case 'C': return SC_RIGHT;
+        case 'D': return SC_LEFT;
+        case 'H': return SC_HOME;
+        case 'F': return SC_END;
+        case '~':
+            if (param == 1 || param == 7) return SC_HOME;
+            if (param == 4 || param == 8) return SC_END;
+            if (param == 2) return SC_INSERT;
+            if (param == 3) return SC_DELETE;
+            if (param == 5) return SC_PGUP;
+            if (param == 6) return SC_PGDN;
+            if (param >= 11 && param <= 15) return SC_F1 + param - 11;
+            if (param >= 17 && param <= 21) return SC_F6 + param - 17;
+            break;
+    }
+    return 0;
+}
+
+static void rx_byte(char c) {
+    uint8_t scancode = 0;
+    uint8_t shifted = 0;
+
+    switch (rx_state) {
+        case RX_ESC:
+            rx_state = RX_NORMAL;
+            if (c == '[') {
+                rx_state = RX_CSI;
+                rx_param = 0;
+                return;
+            }
+            if (c == 'O') {
+                rx_state = RX_SS3;
+                return;
+            }
+            // Одиночный ESC, за которым сразу пришел другой символ
+            push_key(SC_ESC);
+            rx_byte(c);
+            return;
+
+        case RX_CSI:
+            if (c >= '0' && c <= '9') {
+                rx_param = rx_param * 10 + (c - '0');
+                return;
+            }
+            if (c == ';') return;
+            rx_state = RX_NORMAL;
+            scancode = csi_to_scancode(rx_param, c);
+            break;
+
+        case RX_SS3:
+            rx_state = RX_NORMAL;
+            if (c >= 'P' && c <= 'S') {
+                scancode = SC_F1 + (c - 'P');
+            } else {
+                scancode = csi_to_scancode(0, c);
+            }
+            break;
+
+        default:
+            if (c == 0x1B) {
+                rx_state = RX_ESC;
+                esc_deadline = deadline_after_ms(SERIAL_ESC_TIMEOUT_MS);
+                return;
+            }
+            scancode = ascii_to_scancode(c, &shifted);
+            break;
+    }
+
+    if (scancode && shifted) {
+        push_shifted_key(scancode);
+    } else if (scancode) {
+        push_key(scancode);
+    }
+}
+
+static void serial_irq(void) {
+    uint8_t iir;
+
+    while (!((iir = inb(base + UART_IIR)) & IIR_NO_INT)) {
+        switch (iir & IIR_ID_MASK) {
+            case IIR_RX_DATA:
+            case IIR_RX_TIMEOUT:
+                while (inb(base + UART_LSR) & LSR_DATA_READY) {
+                    rx_byte(inb(base + UART_DATA));
+                }
+                break;
+            case IIR_THRE:
+                tx_fill();
+                tx_update_ier();
+                break;
+            case IIR_LINE_STATUS:
+                inb(base + UART_LSR);
+                break;
+            default:
+                inb(base + UART_MSR);
+                break;
+        }
+    }
+}
+
+void serial_poll(void) {
+    if (!available || rx_state != RX_ESC || !deadline_expired(esc_deadline)) return;
+
+    uint32_t flags = irq_save();
+    if (rx_state == RX_ESC) {
+        rx_state = RX_NORMAL;
+        push_key(SC_ESC);
+    }
+    irq_restore(flags);
+}
+
+// ==================== ИНИЦИАЛИЗАЦИЯ ====================
+
+static uint8_t serial_probe(uint16_t port) {
+    outb(port + UART_SCRATCH, 0x5A);
+    if (inb(port + UART_SCRATCH) != 0x5A) return 0;
+    outb(port + UART_SCRATCH, 0xA5);
+    return inb(port + UART_SCRATCH) == 0xA5;
+}
+
+uint8_t serial_init(void) {
+    uint8_t irq;
+
+    if (serial_probe(SERIAL_COM1)) {
+        base = SERIAL_COM1;
+        irq = SERIAL_COM1_IRQ;
+    } else if (serial_probe(SERIAL_COM2)) {
+        base = SERIAL_COM2;
+        irq = SERIAL_COM2_IRQ;
+    } else {
+        return 0;
+    }
+
+    outb(base + UART_IER, 0);
+    outb(base + UART_LCR, LCR_DLAB);
+    outb(base + UART_DATA, SERIAL_DIVISOR & 0xFF);
+    outb(base + UART_IER, SERIAL_DIVISOR >> 8);
+    outb(base + UART_LCR, LCR_8N1);
+    outb(base + UART_IIR, FCR_ENABLE_14);
+    outb(base + UART_MCR, MCR_DTR_RTS_OUT2);
+
+    // 8250/16450 без FIFO - по байту на прерывание
+    fifo_depth = (inb(base + UART_IIR) & IIR_FIFO_ON) == IIR_FIFO_ON ? SERIAL_FIFO_DEPTH : 1;
+
+    // Сбрасываем мусор в приемнике
+    while (inb(base + UART_LSR) & LSR_DATA_READY) inb(base + UART_DATA);
+
+    // Линия размаскируется в interrupts_init()
+    irq_install(irq, serial_irq);
+    outb(base + UART_IER, IER_RX);
+
+    available = 1;
+    serial_printf("\x1B[?25l");     // курсор терминала не нужен
+    serial_console_clear();
+    return 1;
+}
+
+uint8_t serial_available(void) {
+    return available;
+}
+
+uint16_t serial_port(void) {
+    return base;
+}
+
+void serial_shutdown(void) {
+    if (!available) return;
+
+    serial_printf("\x1B[0m\x1B[?25h\r\n");
+
+    uint32_t flags = irq_save();
+    while (tx_tail != tx_head) {
+        while (!(inb(base + UART_LSR) & LSR_THRE)) {
+            __asm__ volatile ("pause");
+        }
+        tx_fill();
+    }
+    while (!(inb(base + UART_LSR) & LSR_TEMT)) {
+        __asm__ volatile ("pause");
+    }
+    outb(base + UART_IER, 0);
+    available = 0;
+    irq_restore(flags);
+}
+
+// ==================== ЗЕРКАЛО ЭКРАНА ====================
+
+// Символы CP437 вне ASCII - ближайшие ASCII-замены
+static char ansi_char(uint8_t c) {
+    if (c >= 0x20 && c < 0x7F) return c;
+    if (c == 0x00) return ' ';
+    if (c == 0x04) return '*';
+    if (c == 0x10) return '>';
+    if (c == 0x11) return '<';
+    if (c == 0x18 || c == 0x1E) return '^';
+    if (c == 0x19 || c == 0x1F) return 'v';
+    if ((c >= 0xB0 && c <= 0xB2) || (c >= 0xDB && c <= 0xDF)) return '#';
+    if (c == 0xB3 || c == 0xBA) return '|';
+    if (c == 0xC4 || c == 0xCD) return '-';
+    if (c >= 0xB4 && c <= 0xDA) return '+';
+    return '?';
+}
+
+static void term_set_attr(uint8_t attr) {
+    uint8_t fg = attr & 0x0F;
+    uint8_t bg = (attr >> 4) & 0x0F;
+
+    serial_printf("\x1B[0;%u;%um",
+                  (fg & 0x08 ? 90 : 30) + ansi_color[fg & 0x07],
+                  (bg & 0x08 ? 100 : 40) + ansi_color[bg & 0x07]);
+    term_attr = attr;
+}
+
+void serial_console_clear(void) {
+    if (!available) return;
+
+    serial_printf("\x1B[0m\x1B[2J\x1B[H");
+    term_cursor = 0;
+    term_attr = -1;
+    term_blank = 1;
+}
+
+void serial_console_cells(uint32_t pos, const uint16_t* cells, uint32_t count) {
+    char run[SCREEN_WIDTH];
+    uint32_t run_len = 0;
+
+    if (!available) return;
+
+    for (uint32_t i = 0; i < count; i++, pos++) {
+        uint8_t ch = cells[i] & 0xFF;
+        uint8_t attr = cells[i] >> 8;
+
+        // После очистки терминала пустые ячейки на черном фоне не передаем
+        if (term_blank && (ch == ' ' || ch == 0) && !(attr & 0x70)) continue;
+
+        if (term_cursor != (int32_t)pos) {
+            serial_write(run, run_len);
+            run_len = 0;
+            serial_printf("\x1B[%u;%uH", pos / SCREEN_WIDTH + 1, pos % SCREEN_WIDTH + 1);
+            term_cursor = pos;
+        }
+        if (term_attr != attr) {
+            serial_write(run, run_len);
+            run_len = 0;
+            term_set_attr(attr);
+        }
+
+        run[run_len++] = ansi_char(ch);
+        term_cursor++;
+
+        // Последний столбец: дальше поведение терминала (автоперенос) не угадываем
+        if (pos % SCREEN_WIDTH == SCREEN_WIDTH - 1) {
+            serial_write(run, run_len);
+            run_len = 0;
+            term_cursor = -1;
+        }
+    }
+
+    serial_write(run, run_len);
+    term_blank = 0;
+}
+
+void serial_console_line(const char* text, uint8_t color) {
+    uint32_t len = 0;
+
+    if (!available) return;
+
+    while (len < SCREEN_WIDTH && text[len]) len++;
+    term_set_attr(color);
+    serial_write(text, len);
+    serial_printf("\x1B[0m\r\n");
+    term_cursor = -1;
+    term_attr = -1;
+    term_blank = 0;
+}
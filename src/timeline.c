@@ -0,0 +1,222 @@
+#include "timeline.h"
+#include "console.h"
+#include "cpu.h"
+#include "image.h"
+#include "timer.h"
+#include "kprintf.h"
+
+// Внешние функции
+extern uint8_t read_cmos(uint8_t reg);
+extern void write_cmos(uint8_t reg, uint8_t value);
+
+// Кольцевой буфер отметок
+#define TIMELINE_RING_SIZE   64
+
+// История загрузок в CMOS: TIMELINE_HISTORY записей по 8 байт
+// [сборка, загрузчик, POST, заставка, инициализация, автозагрузка, всего lo, всего hi]
+#define CMOS_TIMELINE_HEAD   0x41
+#define CMOS_TIMELINE_BASE   0x60
+#define TIMELINE_RECORD_SIZE 8
+
+// Единица хранения в CMOS - 2^20 тактов (~1 мс на 1 ГГц)
+#define TIMELINE_UNIT_SHIFT  20
+
+typedef enum {
+    TL_GROUP_LOADER = 0,
+    TL_GROUP_POST,
+    TL_GROUP_SCREEN,
+    TL_GROUP_INIT,
+    TL_GROUP_AUTOBOOT,
+    TL_GROUP_COUNT
+} timeline_group_t;
+
+typedef struct {
+    uint8_t point;
+    uint64_t tsc;
+} timeline_event_t;
+
+static timeline_event_t ring[TIMELINE_RING_SIZE];
+static uint32_t ring_count = 0;     // всего записано отметок
+static uint8_t committed = 0;
+static uint8_t build_tag = 0;
+
+static const char* point_names[TL_POINT_COUNT] = {
+    "Stage2 start",
+    "Protected mode",
+    "Payload loaded",
+    "main()",
+    "POST CPU",
+    "POST memory",
+    "POST video",
+    "POST keyboard",
+    "POST disk",
+    "POST CMOS",
+    "POST beeps",
+    "Boot screen",
+    "Load settings",
+    "Watch init",
+    "Efficiency init",
+    "Auto boot check",
+    "Boot handoff"
+};
+
+static const char* group_names[TL_GROUP_COUNT] = {
+    "Loader",
+    "POST",
+    "Screen",
+    "Init",
+    "AutoBoot"
+};
+
+static timeline_group_t point_group(uint8_t point) {
+    if (point <= TL_MAIN) return TL_GROUP_LOADER;
+    if (point <= TL_POST_DONE) return TL_GROUP_POST;
+    if (point == TL_BOOT_SCREEN) return TL_GROUP_SCREEN;
+    if (point <= TL_EFFICIENCY_INIT) return TL_GROUP_INIT;
+    return TL_GROUP_AUTOBOOT;
+}
+
+// Упаковка в байт: 3 бита порядка, 5 бит мантиссы
+static uint8_t encode_units(uint32_t units) {
+    uint8_t exp = 0;
+    while (units > 31 && exp < 7) {
+        units >>= 1;
+        exp++;
+    }
+    if (units > 31) units = 31;
+    return (exp << 5) | units;
+}
+
+static uint32_t decode_units(uint8_t value) {
+    return (uint32_t)(value & 0x1F) << (value >> 5);
+}
+
+// Перевод единиц истории в миллисекунды по откалиброванной частоте TSC
+static uint32_t units_to_ms(uint32_t units) {
+    return timer_cycles_to_us((uint64_t)units << TIMELINE_UNIT_SHIFT) / 1000;
+}
+
+static void record_event(uint8_t point, uint64_t tsc) {
+    timeline_event_t* ev = &ring[ring_count % TIMELINE_RING_SIZE];
+    ev->point = point;
+    ev->tsc = tsc;
+    ring_count++;
+}
+
+void timeline_init(void) {
+    boot_handoff_t* handoff = (boot_handoff_t*)BOOT_HANDOFF_ADDR;
+
+    ring_count = 0;
+    committed = 0;
+
+    // Отметки загрузчика, если stage2 их оставил
+    if (handoff->magic == BOOT_HANDOFF_MAGIC) {
+        build_tag = handoff->image_checksum & 0xFF;
+        record_event(TL_STAGE2, handoff->tsc_stage2);
+        record_event(TL_PROTECTED_MODE, handoff->tsc_protected_mode);
+        record_event(TL_PAYLOAD, handoff->tsc_payload);
+    }
+
+    timeline_mark(TL_MAIN);
+}
+
+void timeline_mark(timeline_point_t point) {
+    record_event(point, cpu_read_tsc());
+}
+
+// Сохраняем разбивку текущей загрузки в историю CMOS (один раз за загрузку)
+void timeline_commit(void) {
+    uint64_t groups[TL_GROUP_COUNT] = {0};
+    uint64_t total = 0;
+
+    if (committed || ring_count < 2) return;
+    committed = 1;
+
+    uint32_t count = ring_count < TIMELINE_RING_SIZE ? ring_count : TIMELINE_RING_SIZE;
+    uint32_t first = ring_count - count;
+
+    for (uint32_t i = first + 1; i < ring_count; i++) {
+        timeline_event_t* prev = &ring[(i - 1) % TIMELINE_RING_SIZE];
+        timeline_event_t* ev = &ring[i % TIMELINE_RING_SIZE];
+        uint64_t delta = ev->tsc - prev->tsc;
+
+        groups[point_group(ev->point)] += delta;
+        total += delta;
+    }
+
+    uint8_t head = read_cmos(CMOS_TIMELINE_HEAD) % TIMELINE_HISTORY;
+    uint8_t base = CMOS_TIMELINE_BASE + head * TIMELINE_RECORD_SIZE;
+    uint32_t total_units = (uint32_t)(total >> TIMELINE_UNIT_SHIFT);
+    if (total_units > 0xFFFF) total_units = 0xFFFF;
+
+    write_cmos(base, build_tag);
+    for (int g = 0; g < TL_GROUP_COUNT; g++) {
+        write_cmos(base + 1 + g, encode_units((uint32_t)(groups[g] >> TIMELINE_UNIT_SHIFT)));
+    }
+    write_cmos(base + 6, total_units & 0xFF);
+    write_cmos(base + 7, total_units >> 8);
+
+    write_cmos(CMOS_TIMELINE_HEAD, (head + 1) % TIMELINE_HISTORY);
+}
+
+static void show_current_boot(void) {
+    uint32_t count = ring_count < TIMELINE_RING_SIZE ? ring_count : TIMELINE_RING_SIZE;
+    uint32_t shown = count < 18 ? count : 18;
+    uint32_t first = ring_count - shown;
+    uint64_t start = ring[(ring_count - count) % TIMELINE_RING_SIZE].tsc;
+
+    print_string("This boot       Delta us    Total us", 1, 4, 0x0F);
+
+    for (uint32_t i = 0; i < shown; i++) {
+        timeline_event_t* ev = &ring[(first + i) % TIMELINE_RING_SIZE];
+        uint64_t delta = 0;
+        if (first + i > ring_count - count) {
+            delta = ev->tsc - ring[(first + i - 1) % TIMELINE_RING_SIZE].tsc;
+        }
+
+        kprintf(1, 5 + i, 0x07, "%-16s%C%-12u%C%u", point_names[ev->point],
+                0x0B, timer_cycles_to_us(delta), 0x07, timer_cycles_to_us(ev->tsc - start));
+    }
+}
+
+static void show_history(void) {
+    uint8_t head = read_cmos(CMOS_TIMELINE_HEAD) % TIMELINE_HISTORY;
+
+    print_string("History, ms (newest first)", 44, 4, 0x0F);
+    print_string("Build", 44, 6, 0x07);
+    for (int g = 0; g < TL_GROUP_COUNT; g++) {
+        print_string(group_names[g], 44, 7 + g, 0x07);
+    }
+    print_string("Total", 44, 7 + TL_GROUP_COUNT, 0x0F);
+
+    for (int n = 0; n < TIMELINE_HISTORY; n++) {
+        uint8_t slot = (head + TIMELINE_HISTORY - 1 - n) % TIMELINE_HISTORY;
+        uint8_t base = CMOS_TIMELINE_BASE + slot * TIMELINE_RECORD_SIZE;
+        uint8_t x = 53 + n * 7;
+        uint32_t total = read_cmos(base + 6) | (read_cmos(base + 7) << 8);
+
+        if (total == 0) {
+            print_string("-", x, 6, 0x08);
+            continue;
+        }
+
+        kprintf(x, 6, read_cmos(base) == build_tag ? 0x0A : 0x0E, "%02X", read_cmos(base));
+
+        for (int g = 0; g < TL_GROUP_COUNT; g++) {
+            kprintf(x, 7 + g, 0x0B, "%u", units_to_ms(decode_units(read_cmos(base + 1 + g))));
+        }
+        kprintf(x, 7 + TL_GROUP_COUNT, 0x0F, "%u", units_to_ms(total));
+    }
+}
+
+void timeline_show(void) {
+    clear_screen(0x00);
+    print_string("BOOT TIMELINE", 33, 1, 0x0F);
+    print_string("=============", 33, 2, 0x0F);
+
+    show_current_boot();
+    show_history();
+
+    print_string("Press any key...", 1, 24, 0x07);
+    keyboard_wait_press();
+}
@@ -0,0 +1,146 @@
+#include "timer.h"
+#include "cpu.h"
+#include "ports.h"
+#include "interrupts.h"
+#include "screen.h"
+
+// Порты PIT и динамика
+#define PIT_CHANNEL0    0x40
+#define PIT_CHANNEL2    0x42
+#define PIT_COMMAND     0x43
+#define SPEAKER_PORT    0x61
+
+// Калибровка: канал 2 в режиме 0 отсчитывает 10 мс
+#define CALIBRATE_MS    10
+#define CALIBRATE_TICKS (PIT_FREQUENCY * CALIBRATE_MS / 1000)
+#define CALIBRATE_SPINS 100000000
+
+// Если PIT не ответил - считаем, что TSC идет на 1 ГГц
+#define DEFAULT_TSC_KHZ 1000000
+
+static uint32_t tsc_khz = DEFAULT_TSC_KHZ;
+static uint64_t tsc_base = 0;
+static volatile uint32_t tick_count = 0;
+
+// Деление 64/32 без libgcc: два шага divl
+static uint64_t div64_32(uint64_t n, uint32_t d, uint32_t* rem) {
+    uint32_t hi = (uint32_t)(n >> 32);
+    uint32_t lo = (uint32_t)n;
+    uint32_t q_hi = hi / d;
+    uint32_t r = hi % d;
+    uint32_t q_lo;
+
+    __asm__ ("divl %4" : "=a" (q_lo), "=d" (r) : "a" (lo), "d" (r), "rm" (d));
+
+    if (rem) *rem = r;
+    return ((uint64_t)q_hi << 32) | q_lo;
+}
+
+void timer_init(void) {
+    uint8_t speaker = inb(SPEAKER_PORT);
+
+    // Гейт канала 2 включен, динамик выключен
+    outb(SPEAKER_PORT, (speaker & ~0x02) | 0x01);
+
+    // Канал 2, младший/старший байт, режим 0
+    outb(PIT_COMMAND, 0xB0);
+    outb(PIT_CHANNEL2, CALIBRATE_TICKS & 0xFF);
+    outb(PIT_CHANNEL2, CALIBRATE_TICKS >> 8);
+
+    uint64_t start = cpu_read_tsc();
+    uint32_t spins = 0;
+
+    // Ждем выхода OUT2 в 1
+    while (!(inb(SPEAKER_PORT) & 0x20) && spins < CALIBRATE_SPINS) {
+        spins++;
+    }
+
+    uint64_t end = cpu_read_tsc();
+    outb(SPEAKER_PORT, speaker);
+
+    if (spins < CALIBRATE_SPINS) {
+        uint32_t khz = (uint32_t)div64_32(end - start, CALIBRATE_MS, NULL);
+        if (khz > 0) tsc_khz = khz;
+    }
+
+    tsc_base = cpu_read_tsc();
+}
+
+uint32_t timer_tsc_khz(void) {
+    return tsc_khz;
+}
+
+uint64_t now_ns(void) {
+    uint32_t rem;
+    uint64_t ms = div64_32(cpu_read_tsc() - tsc_base, tsc_khz, &rem);
+
+    return ms * 1000000 + div64_32((uint64_t)rem * 1000000, tsc_khz, NULL);
+}
+
+uint32_t timer_cycles_to_us(uint64_t cycles) {
+    uint32_t rem;
+    uint64_t ms = div64_32(cycles, tsc_khz, &rem);
+
+    return (uint32_t)(ms * 1000 + div64_32((uint64_t)rem * 1000, tsc_khz, NULL));
+}
+
+uint32_t timer_cycles_to_ms(uint64_t cycles) {
+    return (uint32_t)div64_32(cycles, tsc_khz, NULL);
+}
+
+deadline_t deadline_after_us(uint32_t us) {
+    return cpu_read_tsc() + div64_32((uint64_t)us * tsc_khz, 1000, NULL);
+}
+
+deadline_t deadline_after_ms(uint32_t ms) {
+    return cpu_read_tsc() + (uint64_t)ms * tsc_khz;
+}
+
+uint8_t deadline_expired(deadline_t deadline) {
+    return cpu_read_tsc() >= deadline;
+}
+
+void udelay(uint32_t us) {
+    deadline_t deadline = deadline_after_us(us);
+    while (!deadline_expired(deadline)) {
+        __asm__ volatile ("pause");
+    }
+}
+
+void mdelay(uint32_t ms) {
+    // Миллисекундные паузы в меню нужны, чтобы показать сообщение - выводим кадр
+    screen_flush();
+
+    deadline_t deadline = deadline_after_ms(ms);
+    while (!deadline_expired(deadline)) {
+        __asm__ volatile ("pause");
+    }
+}
+
+static void timer_irq(void) {
+    tick_count++;
+}
+
+static void pit_set_channel0(uint16_t divisor) {
+    // Канал 0, младший/старший байт, режим 2 (генератор частоты)
+    outb(PIT_COMMAND, 0x34);
+    outb(PIT_CHANNEL0, divisor & 0xFF);
+    outb(PIT_CHANNEL0, divisor >> 8);
+}
+
+void timer_start_tick(uint32_t hz) {
+    uint32_t divisor = PIT_FREQUENCY / hz;
+    if (divisor > 0xFFFF) divisor = 0;   // 0 = 65536, ~18.2 Гц
+
+    pit_set_channel0(divisor);
+    irq_install(IRQ_TIMER, timer_irq);
+}
+
+// Стандартные для BIOS 18.2 Гц
+void timer_stop_tick(void) {
+    pit_set_channel0(0);
+}
+
+uint32_t timer_ticks(void) {
+    return tick_count;
+}
@@ -0,0 +1,110 @@
+#include "trace.h"
+#include "cpu.h"
+#include "timer.h"
+#include "serial.h"
+#include "kprintf.h"
+#include "ports.h"
+
+static trace_record_t ring[TRACE_RING_SIZE];
+static volatile uint32_t head = 0;
+static uint32_t drained = 0;
+
+uint32_t trace_mask = (1 << TRACE_SYS_COUNT) - 1;
+uint8_t trace_level = TRACE_INFO;
+
+static const char* subsystem_names[TRACE_SYS_COUNT] = {
+    "CORE", "POST", "IDE", "USB", "CMOS", "BOOT", "AHCI", "NVME", "VIRTIO"
+};
+
+void trace_event(uint8_t subsystem, uint8_t level, uint16_t event, uint32_t arg0, uint32_t arg1) {
+    uint32_t seq = 1;
+
+    // Один процессор: xadd атомарен относительно прерываний
+    __asm__ volatile ("xaddl %0, %1" : "+r" (seq), "+m" (head) : : "memory");
+
+    trace_record_t* record = &ring[seq & (TRACE_RING_SIZE - 1)];
+    record->tsc = cpu_read_tsc();
+    record->seq = seq;
+    record->event = event;
+    record->subsystem = subsystem;
+    record->level = level;
+    record->arg0 = arg0;
+    record->arg1 = arg1;
+}
+
+uint32_t trace_count(void) {
+    return head;
+}
+
+uint8_t trace_get(uint32_t seq, trace_record_t* record) {
+    uint32_t flags;
+
+    // Запись могла дописываться из IRQ - копируем с запретом прерываний
+    __asm__ volatile ("pushfl; popl %0; cli" : "=r" (flags) : : "memory");
+    *record = ring[seq & (TRACE_RING_SIZE - 1)];
+    if (flags & 0x200) __asm__ volatile ("sti" : : : "memory");
+
+    return record->seq == seq && seq < head;
+}
+
+const char* trace_subsystem_name(uint8_t subsystem) {
+    return subsystem < TRACE_SYS_COUNT ? subsystem_names[subsystem] : "?";
+}
+
+// ==================== ВЫГРУЗКА ====================
+
+// Без -debugcon порт 0xE9 читается как 0xFF
+static uint8_t debugcon_present(void) {
+    return inb(TRACE_DEBUGCON_PORT) == TRACE_DEBUGCON_PORT;
+}
+
+static void drain_line(uint8_t targets, const char* line) {
+    if (targets & TRACE_OUT_SERIAL) {
+        serial_console_line(line, 0x07);
+    }
+    if (targets & TRACE_OUT_DEBUGCON) {
+        while (*line) outb(TRACE_DEBUGCON_PORT, *line++);
+        outb(TRACE_DEBUGCON_PORT, '\n');
+    }
+}
+
+// Текстовые строки "#WXTR ...", которые декодер находит в любом логе:
+//   #WXTR H <версия> <размер записи> <TSC кГц> <записей> <потеряно>
+//   #WXTR R <запись в hex, байты по порядку>
+//   #WXTR E
+uint32_t trace_drain(uint8_t targets) {
+    char line[64];
+    uint32_t end = head;
+    uint32_t start = drained;
+    uint32_t lost = 0;
+
+    if (!serial_available()) targets &= ~TRACE_OUT_SERIAL;
+    if (!debugcon_present()) targets &= ~TRACE_OUT_DEBUGCON;
+
+    if (end - start > TRACE_RING_SIZE) {
+        lost = end - start - TRACE_RING_SIZE;
+        start = end - TRACE_RING_SIZE;
+    }
+
+    ksnprintf(line, sizeof(line), "#WXTR H %u %u %u %u %u", TRACE_FORMAT_VERSION,
+              (uint32_t)sizeof(trace_record_t), timer_tsc_khz(), end - start, lost);
+    drain_line(targets, line);
+
+    for (uint32_t seq = start; seq < end; seq++) {
+        trace_record_t record;
+        const uint8_t* bytes = (const uint8_t*)&record;
+        int pos = ksnprintf(line, sizeof(line), "#WXTR R ");
+
+        if (!trace_get(seq, &record)) continue;
+        for (uint32_t i = 0; i < sizeof(record); i++) {
+            pos += ksnprintf(line + pos, sizeof(line) - pos, "%02X", bytes[i]);
+        }
+        drain_line(targets, line);
+    }
+
+    drain_line(targets, "#WXTR E");
+    drained = end;
+
+    TRACE(CORE, DRAIN, end - start, lost);
+    return end - start;
+}
@@ -0,0 +1,387 @@
+#include "virtio_blk.h"
+#include "blockdev.h"
+#include "pci.h"
+#include "timer.h"
+#include "trace.h"
+#include "kprintf.h"
+#include "ports.h"
+
+typedef struct {
+    blockdev_t dev;
+    uint8_t modern;
+    uint16_t io_base;                   // legacy
+    volatile uint8_t* common;           // modern
+    volatile uint16_t* notify;
+    volatile uint8_t* config;
+    uint16_t queue_size;
+    uint16_t avail_idx;
+    uint16_t batch;                     // запросов в пакете
+    vring_desc_t* desc;
+    vring_avail_t* avail;
+    volatile vring_used_t* used;
+    virtio_blk_req_t requests[VIRTIO_BLK_BATCH];
+    volatile uint8_t status[VIRTIO_BLK_BATCH];
+    // Настройка, которую оставил BIOS: возможности драйвера, очередь 0
+    // (legacy - только PFN в queue[0]), статус
+    uint32_t saved_features[2];
+    uint32_t saved_queue[6];
+    uint16_t saved_queue_size;
+    uint16_t saved_queue_enable;
+    uint8_t saved_status;
+} virtio_disk_t;
+
+static virtio_disk_t disks[VIRTIO_BLK_MAX_DISKS];
+static uint8_t disk_count = 0;
+static uint8_t released = 0;
+static uint8_t ring_mem[VIRTIO_BLK_MAX_DISKS][VIRTIO_RING_BYTES] __attribute__((aligned(VIRTIO_LEGACY_ALIGN)));
+
+static void barrier(void) {
+    __asm__ volatile ("" : : : "memory");
+}
+
+// ==================== ТРАНСПОРТ ====================
+
+static void set_status(virtio_disk_t* disk, uint8_t status) {
+    if (disk->modern) {
+        disk->common[VIRTIO_COMMON_STATUS] = status;
+    } else {
+        outb(disk->io_base + VIRTIO_LEGACY_STATUS, status);
+    }
+}
+
+static uint8_t get_status(virtio_disk_t* disk) {
+    if (disk->modern) return disk->common[VIRTIO_COMMON_STATUS];
+    return inb(disk->io_base + VIRTIO_LEGACY_STATUS);
+}
+
+static void common_write16(virtio_disk_t* disk, uint32_t reg, uint16_t value) {
+    *(volatile uint16_t*)(disk->common + reg) = value;
+}
+
+static uint16_t common_read16(virtio_disk_t* disk, uint32_t reg) {
+    return *(volatile uint16_t*)(disk->common + reg);
+}
+
+static void common_write32(virtio_disk_t* disk, uint32_t reg, uint32_t value) {
+    *(volatile uint32_t*)(disk->common + reg) = value;
+}
+
+static uint32_t common_read32(virtio_disk_t* disk, uint32_t reg) {
+    return *(volatile uint32_t*)(disk->common + reg);
+}
+
+static void notify(virtio_disk_t* disk) {
+    if (disk->modern) {
+        *disk->notify = 0;
+    } else {
+        outw(disk->io_base + VIRTIO_LEGACY_QUEUE_NOTIFY, 0);
+    }
+}
+
+// Область capability в BAR памяти ниже 4 ГБ
+static volatile uint8_t* cap_region(const pci_device_t* dev, uint8_t cap) {
+    uint8_t bar = pci_read8(dev, cap + 4);
+    uint32_t offset = pci_read32(dev, cap + 8);
+
+    if (bar > 5) return 0;
+    uint32_t raw = pci_read32(dev, PCI_BAR0 + bar * 4);
+    if (raw & 1) return 0;
+    if (((raw >> 1) & 3) == 2 && pci_read32(dev, PCI_BAR0 + bar * 4 + 4)) return 0;
+    if (!pci_bar(dev, bar)) return 0;
+
+    return (volatile uint8_t*)(pci_bar(dev, bar) + offset);
+}
+
+static uint8_t find_modern(virtio_disk_t* disk, const pci_device_t* dev, uint32_t* notify_mult) {
+    volatile uint8_t* notify_base = 0;
+
+    for (uint8_t cap = pci_find_capability(dev, VIRTIO_PCI_CAP_ID, 0); cap;
+         cap = pci_find_capability(dev, VIRTIO_PCI_CAP_ID, cap)) {
+        switch (pci_read8(dev, cap + 3)) {
+            case VIRTIO_PCI_CAP_COMMON:
+                disk->common = cap_region(dev, cap);
+                break;
+            case VIRTIO_PCI_CAP_NOTIFY:
+                notify_base = cap_region(dev, cap);
+                *notify_mult = pci_read32(dev, cap + 16);
+                break;
+            case VIRTIO_PCI_CAP_DEVICE:
+                disk->config = cap_region(dev, cap);
+                break;
+        }
+    }
+
+    disk->notify = (volatile uint16_t*)notify_base;
+    return disk->common && notify_base && disk->config;
+}
+
+// Раскладка очереди размера N в ring_mem
+static void ring_layout(virtio_disk_t* disk, uint8_t* mem) {
+    uint32_t n = disk->queue_size;
+    uint32_t used_offset = (16 * n + 6 + 2 * n + VIRTIO_LEGACY_ALIGN - 1) & ~(VIRTIO_LEGACY_ALIGN - 1);
+
+    for (uint32_t i = 0; i < VIRTIO_RING_BYTES; i++) mem[i] = 0;
+    disk->desc = (vring_desc_t*)mem;
+    disk->avail = (vring_avail_t*)(mem + 16 * n);
+    disk->used = (volatile vring_used_t*)(mem + used_offset);
+    disk->avail_idx = 0;
+
+    // Цепочки постоянны: заголовок -> данные -> статус
+    disk->batch = n / VIRTIO_BLK_DESCS;
+    if (disk->batch > VIRTIO_BLK_BATCH) disk->batch = VIRTIO_BLK_BATCH;
+    for (uint16_t i = 0; i < disk->batch; i++) {
+        vring_desc_t* d = &disk->desc[i * VIRTIO_BLK_DESCS];
+
+        d[0].addr = (uint32_t)&disk->requests[i];
+        d[0].len = sizeof(virtio_blk_req_t);
+        d[0].flags = VRING_DESC_F_NEXT;
+        d[0].next = i * VIRTIO_BLK_DESCS + 1;
+        d[1].flags = VRING_DESC_F_WRITE | VRING_DESC_F_NEXT;
+        d[1].next = i * VIRTIO_BLK_DESCS + 2;
+        d[2].addr = (uint32_t)&disk->status[i];
+        d[2].len = 1;
+        d[2].flags = VRING_DESC_F_WRITE;
+    }
+}
+
+// Сброс завершен, когда статус читается нулем
+static uint8_t reset_device(virtio_disk_t* disk) {
+    deadline_t deadline = deadline_after_ms(VIRTIO_TIMEOUT_MS);
+
+    set_status(disk, 0);
+    while (get_status(disk)) {
+        if (deadline_expired(deadline)) return 0;
+    }
+    return 1;
+}
+
+static void save_device(virtio_disk_t* disk) {
+    disk->saved_status = get_status(disk);
+    if (disk->modern) {
+        common_write32(disk, VIRTIO_COMMON_GFSELECT, 0);
+        disk->saved_features[0] = common_read32(disk, VIRTIO_COMMON_GF);
+        common_write32(disk, VIRTIO_COMMON_GFSELECT, 1);
+        disk->saved_features[1] = common_read32(disk, VIRTIO_COMMON_GF);
+        common_write16(disk, VIRTIO_COMMON_Q_SELECT, 0);
+        disk->saved_queue_size = common_read16(disk, VIRTIO_COMMON_Q_SIZE);
+        disk->saved_queue_enable = common_read16(disk, VIRTIO_COMMON_Q_ENABLE);
+        for (uint32_t i = 0; i < 6; i++) {
+            disk->saved_queue[i] = common_read32(disk, VIRTIO_COMMON_Q_DESC + i * 4);
+        }
+    } else {
+        disk->saved_features[0] = inl(disk->io_base + VIRTIO_LEGACY_GUEST_FEATURES);
+        outw(disk->io_base + VIRTIO_LEGACY_QUEUE_SELECT, 0);
+        disk->saved_queue[0] = inl(disk->io_base + VIRTIO_LEGACY_QUEUE_PFN);
+    }
+}
+
+// Сброс и настройка BIOS обратно, но без DRIVER_OK: индексы колец внутри
+// устройства после сброса нулевые, а BIOS продолжит со своих - запросы
+// повторились бы. Его INT 13h с этого диска завершится по таймауту
+static void restore_device(virtio_disk_t* disk) {
+    uint8_t status = disk->saved_status &
+                     (VIRTIO_STATUS_ACKNOWLEDGE | VIRTIO_STATUS_DRIVER | VIRTIO_STATUS_FEATURES_OK);
+
+    if (!reset_device(disk) || !status) return;
+    set_status(disk, status & (VIRTIO_STATUS_ACKNOWLEDGE | VIRTIO_STATUS_DRIVER));
+
+    if (disk->modern) {
+        common_write32(disk, VIRTIO_COMMON_GFSELECT, 0);
+        common_write32(disk, VIRTIO_COMMON_GF, disk->saved_features[0]);
+        common_write32(disk, VIRTIO_COMMON_GFSELECT, 1);
+        common_write32(disk, VIRTIO_COMMON_GF, disk->saved_features[1]);
+        set_status(disk, status);
+        if (!(status & VIRTIO_STATUS_FEATURES_OK)) return;
+
+        common_write16(disk, VIRTIO_COMMON_Q_SELECT, 0);
+        common_write16(disk, VIRTIO_COMMON_Q_SIZE, disk->saved_queue_size);
+        for (uint32_t i = 0; i < 6; i++) {
+            common_write32(disk, VIRTIO_COMMON_Q_DESC + i * 4, disk->saved_queue[i]);
+        }
+        common_write16(disk, VIRTIO_COMMON_Q_ENABLE, disk->saved_queue_enable);
+    } else {
+        outl(disk->io_base + VIRTIO_LEGACY_GUEST_FEATURES, disk->saved_features[0]);
+        outw(disk->io_base + VIRTIO_LEGACY_QUEUE_SELECT, 0);
+        outl(disk->io_base + VIRTIO_LEGACY_QUEUE_PFN, disk->saved_queue[0]);
+        set_status(disk, status);
+    }
+}
+
+static uint8_t init_modern(virtio_disk_t* disk, uint8_t* mem, uint32_t notify_mult) {
+    save_device(disk);
+    if (!reset_device(disk)) return 0;
+    set_status(disk, VIRTIO_STATUS_ACKNOWLEDGE | VIRTIO_STATUS_DRIVER);
+
+    // Из возможностей принимаем только VERSION_1
+    common_write32(disk, VIRTIO_COMMON_DFSELECT, 1);
+    if (!(common_read32(disk, VIRTIO_COMMON_DF) & VIRTIO_F_VERSION_1_HIGH)) return 0;
+    common_write32(disk, VIRTIO_COMMON_GFSELECT, 0);
+    common_write32(disk, VIRTIO_COMMON_GF, 0);
+    common_write32(disk, VIRTIO_COMMON_GFSELECT, 1);
+    common_write32(disk, VIRTIO_COMMON_GF, VIRTIO_F_VERSION_1_HIGH);
+    set_status(disk, get_status(disk) | VIRTIO_STATUS_FEATURES_OK);
+    if (!(get_status(disk) & VIRTIO_STATUS_FEATURES_OK)) return 0;
+
+    // Modern позволяет уменьшить очередь до нашего максимума
+    common_write16(disk, VIRTIO_COMMON_Q_SELECT, 0);
+    disk->queue_size = common_read16(disk, VIRTIO_COMMON_Q_SIZE);
+    if (disk->queue_size < VIRTIO_BLK_DESCS) return 0;
+    if (disk->queue_size > VIRTIO_QUEUE_MAX) {
+        disk->queue_size = VIRTIO_QUEUE_MAX;
+        common_write16(disk, VIRTIO_COMMON_Q_SIZE, VIRTIO_QUEUE_MAX);
+    }
+    ring_layout(disk, mem);
+
+    common_write32(disk, VIRTIO_COMMON_Q_DESC, (uint32_t)disk->desc);
+    common_write32(disk, VIRTIO_COMMON_Q_DESC + 4, 0);
+    common_write32(disk, VIRTIO_COMMON_Q_DRIVER, (uint32_t)disk->avail);
+    common_write32(disk, VIRTIO_COMMON_Q_DRIVER + 4, 0);
+    common_write32(disk, VIRTIO_COMMON_Q_DEVICE, (uint32_t)disk->used);
+    common_write32(disk, VIRTIO_COMMON_Q_DEVICE + 4, 0);
+    disk->notify = (volatile uint16_t*)((volatile uint8_t*)disk->notify +
+                   common_read16(disk, VIRTIO_COMMON_Q_NOFF) * notify_mult);
+    common_write16(disk, VIRTIO_COMMON_Q_ENABLE, 1);
+
+    set_status(disk, get_status(disk) | VIRTIO_STATUS_DRIVER_OK);
+
+    volatile uint32_t* capacity = (volatile uint32_t*)disk->config;
+    disk->dev.sectors = capacity[1] ? 0xFFFFFFFF : capacity[0];
+    return 1;
+}
+
+static uint8_t init_legacy(virtio_disk_t* disk, uint8_t* mem) {
+    uint16_t io = disk->io_base;
+
+    save_device(disk);
+    set_status(disk, 0);
+    set_status(disk, VIRTIO_STATUS_ACKNOWLEDGE | VIRTIO_STATUS_DRIVER);
+    inl(io + VIRTIO_LEGACY_DEVICE_FEATURES);
+    outl(io + VIRTIO_LEGACY_GUEST_FEATURES, 0);
+
+    // Размер очереди legacy задает устройство
+    outw(io + VIRTIO_LEGACY_QUEUE_SELECT, 0);
+    disk->queue_size = inw(io + VIRTIO_LEGACY_QUEUE_SIZE);
+    if (disk->queue_size < VIRTIO_BLK_DESCS || disk->queue_size > VIRTIO_QUEUE_MAX) return 0;
+    ring_layout(disk, mem);
+    outl(io + VIRTIO_LEGACY_QUEUE_PFN, (uint32_t)mem / VIRTIO_LEGACY_ALIGN);
+
+    set_status(disk, get_status(disk) | VIRTIO_STATUS_DRIVER_OK);
+
+    uint32_t capacity_high = inl(io + VIRTIO_LEGACY_CONFIG + 4);
+    disk->dev.sectors = capacity_high ? 0xFFFFFFFF : inl(io + VIRTIO_LEGACY_CONFIG);
+    return 1;
+}
+
+// ==================== ЧТЕНИЕ ====================
+
+// Пакет запросов: один сдвиг avail->idx и одно уведомление на пакет
+static uint8_t disk_read(blockdev_t* dev, uint32_t lba, uint32_t count, void* buffer) {
+    virtio_disk_t* disk = &disks[dev->unit];
+    uint32_t address = (uint32_t)buffer;
+
+    if (released) return 0;
+
+    TRACE(VIRTIO, READ, lba, count);
+    while (count) {
+        uint16_t queued = 0;
+
+        while (count && queued < disk->batch) {
+            uint32_t sectors = count < VIRTIO_BLK_REQ_SECTORS ? count : VIRTIO_BLK_REQ_SECTORS;
+            vring_desc_t* data = &disk->desc[queued * VIRTIO_BLK_DESCS + 1];
+
+            disk->requests[queued].type = VIRTIO_BLK_T_IN;
+            disk->requests[queued].reserved = 0;
+            disk->requests[queued].sector = lba;
+            disk->requests[queued].sector_high = 0;
+            disk->status[queued] = 0xFF;
+            data->addr = address;
+            data->len = sectors * BLOCKDEV_SECTOR_SIZE;
+            disk->avail->ring[(uint16_t)(disk->avail_idx + queued) % disk->queue_size] =
+                queued * VIRTIO_BLK_DESCS;
+
+            lba += sectors;
+            address += sectors * BLOCKDEV_SECTOR_SIZE;
+            count -= sectors;
+            queued++;
+        }
+
+        barrier();
+        disk->avail_idx += queued;
+        disk->avail->idx = disk->avail_idx;
+        barrier();
+        if (!(disk->used->flags & VRING_USED_F_NO_NOTIFY)) notify(disk);
+
+        deadline_t deadline = deadline_after_ms(VIRTIO_TIMEOUT_MS);
+        while (disk->used->idx != disk->avail_idx) {
+            if (deadline_expired(deadline)) {
+                TRACE_WARNING(VIRTIO, TIMEOUT, disk->avail_idx, disk->used->idx);
+                return 0;
+            }
+        }
+        barrier();
+
+        for (uint16_t i = 0; i < queued; i++) {
+            if (disk->status[i] != VIRTIO_BLK_S_OK) {
+                TRACE_WARNING(VIRTIO, ERROR, i, disk->status[i]);
+                return 0;
+            }
+        }
+    }
+    return 1;
+}
+
+static void probe_device(const pci_device_t* dev) {
+    virtio_disk_t* disk = &disks[disk_count];
+    uint8_t* mem = ring_mem[disk_count];
+    uint32_t notify_mult = 0;
+    uint8_t ok = 0;
+
+    disk->common = disk->config = 0;
+    disk->notify = 0;
+    disk->io_base = 0;
+    pci_enable(dev, PCI_COMMAND_IO | PCI_COMMAND_MEMORY | PCI_COMMAND_MASTER);
+
+    // Переходное устройство умеет оба режима - предпочитаем modern
+    disk->modern = find_modern(disk, dev, &notify_mult);
+    if (disk->modern) {
+        ok = init_modern(disk, mem, notify_mult);
+    } else if (dev->device_id == VIRTIO_BLK_LEGACY_ID && (pci_read32(dev, PCI_BAR0) & 1)) {
+        disk->io_base = pci_bar(dev, 0);
+        ok = init_legacy(disk, mem);
+    }
+    if (!ok) {
+        if (disk->modern || disk->io_base) restore_device(disk);
+        return;
+    }
+
+    ksnprintf(disk->dev.name, sizeof(disk->dev.name), "VIRTIO%u", disk_count);
+    disk->dev.type = BLOCKDEV_VIRTIO;
+    disk->dev.unit = disk_count;
+    disk->dev.read = disk_read;
+
+    TRACE(VIRTIO, FOUND, disk->modern, disk->dev.sectors);
+    if (blockdev_register(&disk->dev)) disk_count++;
+}
+
+uint8_t virtio_blk_init(void) {
+    for (uint8_t i = 0; i < pci_device_count() && disk_count < VIRTIO_BLK_MAX_DISKS; i++) {
+        const pci_device_t* dev = pci_get_device(i);
+
+        if (dev->vendor_id != VIRTIO_VENDOR_ID) continue;
+        if (dev->device_id == VIRTIO_BLK_LEGACY_ID || dev->device_id == VIRTIO_BLK_MODERN_ID) {
+            probe_device(dev);
+        }
+    }
+    return disk_count;
+}
+
+void virtio_blk_shutdown(void) {
+    for (uint8_t i = 0; i < disk_count; i++) {
+        restore_device(&disks[i]);
+    }
+    released = 1;
+}
+
+uint8_t virtio_blk_count(void) {
+    return disk_count;
+}
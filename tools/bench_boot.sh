@@ -0,0 +1,45 @@
+#!/bin/bash
+# Сравнение времени загрузки сжатого и несжатого образа в QEMU.
+#
+# stage2 пишет время загрузки payload (такты TSC) в порт 0xE9,
+# QEMU выводит его через -debugcon. Пропускная способность диска
+# ограничивается, чтобы имитировать медленный носитель (USB, IDE).
+#
+# Использование: tools/bench_boot.sh [байт/с] [запусков]
+
+BPS=${1:-1048576}
+RUNS=${2:-5}
+QEMU=${QEMU:-qemu-system-x86_64}
+OUT=$(mktemp -d)
+
+trap 'rm -rf "$OUT"' EXIT
+
+for compress in 0 1; do
+    make -s clean
+    make -s COMPRESS=$compress > /dev/null || exit 1
+    cp bin/bios.img "$OUT/bios-$compress.img"
+    sectors=$(od -An -tu4 -j$((5 * 512 + 0x18)) -N4 bin/bios.img | tr -d ' ')
+
+    echo "=== COMPRESS=$compress ($sectors payload sectors, disk limit $BPS B/s) ==="
+    for run in $(seq 1 "$RUNS"); do
+        rm -f "$OUT/debugcon.log"
+        timeout 10 "$QEMU" -display none -net none \
+            -drive format=raw,file="$OUT/bios-$compress.img",throttling.bps-total="$BPS" \
+            -debugcon file:"$OUT/debugcon.log" > /dev/null 2>&1 &
+        pid=$!
+
+        for i in $(seq 1 100); do
+            grep -q "TSC ticks" "$OUT/debugcon.log" 2>/dev/null && break
+            sleep 0.1
+        done
+        kill "$pid" 2>/dev/null
+        wait "$pid" 2>/dev/null
+
+        ticks=$(grep -o "0x[0-9A-F]*" "$OUT/debugcon.log" 2>/dev/null | head -n 1)
+        if [ -n "$ticks" ]; then
+            echo "run $run: $((ticks)) TSC ticks"
+        else
+            echo "run $run: no output"
+        fi
+    done
+done
@@ -0,0 +1,203 @@
+// bench_kprintf - сравнение kprintf/ksnprintf со старыми помощниками форматирования
+//
+// Собирается на хосте вместе с src/kprintf.c: make bench-kprintf
+// Старые функции (print_hex, int_to_str, log_debug_hex, вывод частоты CPU)
+// скопированы сюда без изменений, вывод на экран заменен записью в массив,
+// как у теневого буфера screen.c.
+
+#include <stdio.h>
+#include <stdint.h>
+#include <string.h>
+#include <time.h>
+#include "kprintf.h"
+#include "screen.h"
+
+#define ITERATIONS 2000000
+
+static uint16_t shadow[SCREEN_WIDTH * SCREEN_HEIGHT];
+static volatile uint32_t sink_guard;
+
+// ==================== ЗАГЛУШКИ ЭКРАНА ====================
+
+void screen_write(uint32_t pos, const char* str, uint32_t len, uint8_t color) {
+    while (len-- && pos < SCREEN_WIDTH * SCREEN_HEIGHT) {
+        shadow[pos++] = (color << 8) | (uint8_t)*str++;
+    }
+}
+
+static void print_string(const char* str, uint8_t x, uint8_t y, uint8_t color) {
+    uint32_t pos = y * SCREEN_WIDTH + x;
+    while (*str && pos < SCREEN_WIDTH * SCREEN_HEIGHT) {
+        shadow[pos++] = (color << 8) | (uint8_t)*str++;
+    }
+}
+
+// ==================== СТАРЫЕ ПОМОЩНИКИ ====================
+
+static void print_hex(uint32_t num, uint8_t x, uint8_t y, uint8_t color) {
+    char hex_chars[] = "0123456789ABCDEF";
+    char buffer[9];
+
+    for(int i = 7; i >= 0; i--) {
+        buffer[i] = hex_chars[num & 0xF];
+        num >>= 4;
+    }
+    buffer[8] = '\0';
+
+    print_string(buffer, x, y, color);
+}
+
+static void int_to_str(uint32_t value, char* buffer) {
+    char* ptr = buffer;
+    char* ptr1 = buffer;
+    char tmp_char;
+
+    do {
+        *ptr++ = '0' + (value % 10);
+        value /= 10;
+    } while (value);
+
+    *ptr-- = '\0';
+
+    while(ptr1 < ptr) {
+        tmp_char = *ptr;
+        *ptr-- = *ptr1;
+        *ptr1++ = tmp_char;
+    }
+}
+
+static void log_debug_hex(const char* label, uint32_t value, char* buffer) {
+    char hex_chars[] = "0123456789ABCDEF";
+    char hex[9];
+
+    for(int i = 7; i >= 0; i--) {
+        hex[i] = hex_chars[value & 0xF];
+        value >>= 4;
+    }
+    hex[8] = '\0';
+
+    int pos = 0;
+    while (*label) buffer[pos++] = *label++;
+    buffer[pos++] = ':';
+    buffer[pos++] = ' ';
+    buffer[pos++] = '0';
+    buffer[pos++] = 'x';
+    for(int i = 0; i < 8; i++) buffer[pos++] = hex[i];
+    buffer[pos] = '\0';
+}
+
+static void my_strcpy(char* dest, const char* src) {
+    while (*src) {
+        *dest++ = *src++;
+    }
+    *dest = '\0';
+}
+
+static int my_strlen(const char* str) {
+    int len = 0;
+    while (*str++) len++;
+    return len;
+}
+
+static void cpu_print_info(const char* name, uint16_t speed, uint8_t x, uint8_t y, uint8_t color) {
+    char buffer[64];
+
+    my_strcpy(buffer, "CPU: ");
+    my_strcpy(buffer + 5, name);
+
+    int len = my_strlen(buffer);
+    char speed_str[16];
+    char* ptr = speed_str;
+
+    if (speed >= 1000) {
+        *ptr++ = (speed / 1000) + '0';
+        speed %= 1000;
+        *ptr++ = (speed / 100) + '0';
+        speed %= 100;
+        *ptr++ = (speed / 10) + '0';
+        *ptr++ = (speed % 10) + '0';
+    } else {
+        *ptr++ = (speed / 100) + '0';
+        speed %= 100;
+        *ptr++ = (speed / 10) + '0';
+        *ptr++ = (speed % 10) + '0';
+    }
+    *ptr++ = 'M';
+    *ptr++ = 'H';
+    *ptr++ = 'z';
+    *ptr = '\0';
+
+    buffer[len++] = ' ';
+    buffer[len++] = '(';
+    my_strcpy(buffer + len, speed_str);
+    len += my_strlen(speed_str);
+    buffer[len++] = ')';
+    buffer[len] = '\0';
+
+    print_string(buffer, x, y, color);
+}
+
+// ==================== ЗАМЕРЫ ====================
+
+static double now_ns(void) {
+    struct timespec ts;
+    clock_gettime(CLOCK_MONOTONIC, &ts);
+    return ts.tv_sec * 1e9 + ts.tv_nsec;
+}
+
+static void report(const char* name, double old_ns, double new_ns) {
+    printf("%-26s old %7.1f ns  kprintf %7.1f ns  (%.2fx)\n",
+           name, old_ns / ITERATIONS, new_ns / ITERATIONS, old_ns / new_ns);
+}
+
+int main(void) {
+    char buffer[96];
+    double start, old_ns, new_ns;
+
+    // Проверка совпадения результатов
+    log_debug_hex("CR0", 0x80000011, buffer);
+    char check[96];
+    ksnprintf(check, sizeof(check), "%s: 0x%08X", "CR0", 0x80000011);
+    if (strcmp(buffer, check) != 0) {
+        printf("mismatch: '%s' vs '%s'\n", buffer, check);
+        return 1;
+    }
+
+    start = now_ns();
+    for (uint32_t i = 0; i < ITERATIONS; i++) print_hex(i * 2654435761u, 10, 5, 0x0E);
+    old_ns = now_ns() - start;
+    start = now_ns();
+    for (uint32_t i = 0; i < ITERATIONS; i++) kprintf(10, 5, 0x0E, "%08X", i * 2654435761u);
+    new_ns = now_ns() - start;
+    report("hex to screen", old_ns, new_ns);
+
+    start = now_ns();
+    for (uint32_t i = 0; i < ITERATIONS; i++) {
+        int_to_str(i, buffer);
+        print_string(buffer, 33, 17, 0x0F);
+    }
+    old_ns = now_ns() - start;
+    start = now_ns();
+    for (uint32_t i = 0; i < ITERATIONS; i++) kprintf(33, 17, 0x0F, "%u", i);
+    new_ns = now_ns() - start;
+    report("decimal to screen", old_ns, new_ns);
+
+    start = now_ns();
+    for (uint32_t i = 0; i < ITERATIONS; i++) log_debug_hex("Cells flushed total", i, buffer);
+    old_ns = now_ns() - start;
+    start = now_ns();
+    for (uint32_t i = 0; i < ITERATIONS; i++) ksnprintf(buffer, sizeof(buffer), "%s: 0x%08X", "Cells flushed total", i);
+    new_ns = now_ns() - start;
+    report("labelled hex to line", old_ns, new_ns);
+
+    start = now_ns();
+    for (uint32_t i = 0; i < ITERATIONS; i++) cpu_print_info("Intel Pentium", 100 + (i & 4095), 2, 4, 0x0F);
+    old_ns = now_ns() - start;
+    start = now_ns();
+    for (uint32_t i = 0; i < ITERATIONS; i++) kprintf(2, 4, 0x0F, "CPU: %s (%uMHz)", "Intel Pentium", 100 + (i & 4095));
+    new_ns = now_ns() - start;
+    report("CPU name + speed", old_ns, new_ns);
+
+    sink_guard = shadow[0] + (uint8_t)buffer[0];
+    return 0;
+}
@@ -0,0 +1,352 @@
+// mkimage - собирает заголовок образа и payload для stage2
+//
+// Использование: mkimage [-z] <biosmenu.elf> <biosmenu.bin> <payload.img>
+//
+// Адрес загрузки, точка входа и размер в памяти (вместе с .bss) берутся
+// из ELF, сам payload - из плоского бинарника objcopy. На выходе сектор
+// заголовка и payload, выровненный до 512 байт.
+//
+// С ключом -z payload сжимается LZ4 (block format). Смещение, по которому
+// stage2 читает сжатые данные для распаковки на месте, подбирается здесь
+// же прогоном распаковки в буфере той же раскладки.
+
+#include <stdio.h>
+#include <stdlib.h>
+#include <string.h>
+#include <stdint.h>
+
+#include "../include/image.h"
+
+#define SHF_ALLOC   0x2
+
+typedef struct {
+    uint8_t  e_ident[16];
+    uint16_t e_type;
+    uint16_t e_machine;
+    uint32_t e_version;
+    uint32_t e_entry;
+    uint32_t e_phoff;
+    uint32_t e_shoff;
+    uint32_t e_flags;
+    uint16_t e_ehsize;
+    uint16_t e_phentsize;
+    uint16_t e_phnum;
+    uint16_t e_shentsize;
+    uint16_t e_shnum;
+    uint16_t e_shstrndx;
+} elf32_ehdr_t;
+
+typedef struct {
+    uint32_t sh_name;
+    uint32_t sh_type;
+    uint32_t sh_flags;
+    uint32_t sh_addr;
+    uint32_t sh_offset;
+    uint32_t sh_size;
+    uint32_t sh_link;
+    uint32_t sh_info;
+    uint32_t sh_addralign;
+    uint32_t sh_entsize;
+} elf32_shdr_t;
+
+static uint8_t* read_file(const char* path, size_t* size) {
+    FILE* f = fopen(path, "rb");
+    if (!f) {
+        perror(path);
+        return NULL;
+    }
+
+    fseek(f, 0, SEEK_END);
+    long len = ftell(f);
+    fseek(f, 0, SEEK_SET);
+
+    uint8_t* data = malloc(len > 0 ? len : 1);
+    if (!data || fread(data, 1, len, f) != (size_t)len) {
+        fprintf(stderr, "%s: read error\n", path);
+        fclose(f);
+        free(data);
+        return NULL;
+    }
+
+    fclose(f);
+    *size = len;
+    return data;
+}
+
+#define LZ4_MIN_MATCH     4
+#define LZ4_LAST_LITERALS 5       // последние 5 байт - всегда литералы
+#define LZ4_MF_LIMIT      12      // матч не начинается ближе 12 байт к концу
+#define LZ4_MAX_OFFSET    65535
+#define LZ4_HASH_BITS     16
+
+static uint32_t read32(const uint8_t* p) {
+    uint32_t v;
+    memcpy(&v, p, 4);
+    return v;
+}
+
+static uint8_t* lz4_put_length(uint8_t* op, size_t len) {
+    while (len >= 255) {
+        *op++ = 255;
+        len -= 255;
+    }
+    *op++ = (uint8_t)len;
+    return op;
+}
+
+static uint8_t* lz4_put_sequence(uint8_t* op, const uint8_t* lit, size_t lit_len,
+                                 size_t offset, size_t match_len) {
+    uint8_t* token = op++;
+    *token = (uint8_t)((lit_len >= 15 ? 15 : lit_len) << 4);
+    if (lit_len >= 15) op = lz4_put_length(op, lit_len - 15);
+
+    memcpy(op, lit, lit_len);
+    op += lit_len;
+
+    if (match_len == 0) return op;  // последняя последовательность
+
+    *op++ = offset & 0xFF;
+    *op++ = (offset >> 8) & 0xFF;
+
+    match_len -= LZ4_MIN_MATCH;
+    *token |= (uint8_t)(match_len >= 15 ? 15 : match_len);
+    if (match_len >= 15) op = lz4_put_length(op, match_len - 15);
+    return op;
+}
+
+// Жадный LZ4 компрессор: хеш-таблица последних позиций 4-байтных последовательностей
+static size_t lz4_compress(const uint8_t* src, size_t n, uint8_t* dst) {
+    static int32_t table[1 << LZ4_HASH_BITS];
+    uint8_t* op = dst;
+    size_t anchor = 0;
+    size_t ip = 0;
+
+    memset(table, 0xFF, sizeof(table));
+
+    if (n > LZ4_MF_LIMIT) {
+        size_t match_limit = n - LZ4_MF_LIMIT;
+        size_t end_limit = n - LZ4_LAST_LITERALS;
+
+        while (ip < match_limit) {
+            uint32_t seq = read32(src + ip);
+            uint32_t h = (seq * 2654435761U) >> (32 - LZ4_HASH_BITS);
+            int32_t ref = table[h];
+            table[h] = (int32_t)ip;
+
+            if (ref < 0 || ip - ref > LZ4_MAX_OFFSET || read32(src + ref) != seq) {
+                ip++;
+                continue;
+            }
+
+            size_t len = LZ4_MIN_MATCH;
+            while (ip + len < end_limit && src[ref + len] == src[ip + len]) len++;
+
+            op = lz4_put_sequence(op, src + anchor, ip - anchor, ip - ref, len);
+            ip += len;
+            anchor = ip;
+        }
+    }
+
+    op = lz4_put_sequence(op, src + anchor, n - anchor, 0, 0);
+    return op - dst;
+}
+
+// Распаковка, повторяющая алгоритм stage2. Возвращает -1, если запись
+// обгоняет чтение (для распаковки на месте) или поток поврежден.
+static int lz4_decompress(uint8_t* buf, size_t src_pos, size_t src_len, size_t dst_len) {
+    size_t ip = src_pos;
+    size_t ip_end = src_pos + src_len;
+    size_t op = 0;
+
+    while (ip < ip_end) {
+        uint8_t token = buf[ip++];
+        size_t len = token >> 4;
+        if (len == 15) {
+            uint8_t b;
+            do {
+                b = buf[ip++];
+                len += b;
+            } while (b == 255);
+        }
+
+        if (op + len > dst_len) return -1;
+        for (size_t i = 0; i < len; i++) {
+            if (op >= ip && op < ip_end) return -1;
+            buf[op++] = buf[ip++];
+        }
+        if (ip >= ip_end) break;
+
+        size_t offset = buf[ip] | (buf[ip + 1] << 8);
+        ip += 2;
+
+        len = token & 0x0F;
+        if (len == 15) {
+            uint8_t b;
+            do {
+                b = buf[ip++];
+                len += b;
+            } while (b == 255);
+        }
+        len += LZ4_MIN_MATCH;
+
+        if (offset == 0 || offset > op || op + len > dst_len) return -1;
+        for (size_t i = 0; i < len; i++) {
+            if (op >= ip && op < ip_end) return -1;
+            buf[op] = buf[op - offset];
+            op++;
+        }
+    }
+
+    return op == dst_len ? 0 : -1;
+}
+
+// Подбираем packed_offset: сжатые сектора лежат в конце буфера так,
+// чтобы распаковка на месте не затирала непрочитанный вход
+static int lz4_place_inplace(const uint8_t* packed, size_t padded, size_t packed_size,
+                             const uint8_t* original, size_t size, uint32_t* offset) {
+    size_t margin = (size >> 8) + 32;
+
+    for (int attempt = 0; attempt < 16; attempt++, margin *= 2) {
+        size_t end = (size + margin + 15) & ~(size_t)15;
+        size_t pos = end > padded ? end - padded : 0;
+        pos = (pos + 15) & ~(size_t)15;
+
+        uint8_t* buf = calloc(1, pos + padded + size);
+        memcpy(buf + pos, packed, padded);
+
+        int ok = lz4_decompress(buf, pos, packed_size, size) == 0 &&
+                 memcmp(buf, original, size) == 0;
+        free(buf);
+
+        if (ok) {
+            *offset = pos;
+            return 0;
+        }
+    }
+
+    return -1;
+}
+
+// Границы образа в памяти по секциям SHF_ALLOC
+static int elf_layout(const uint8_t* elf, size_t size, image_header_t* hdr) {
+    const elf32_ehdr_t* eh = (const elf32_ehdr_t*)elf;
+
+    if (size < sizeof(*eh) || memcmp(eh->e_ident, "\177ELF", 4) != 0 || eh->e_ident[4] != 1) {
+        fprintf(stderr, "mkimage: not an ELF32 file\n");
+        return -1;
+    }
+    if (eh->e_shoff + (uint32_t)eh->e_shnum * sizeof(elf32_shdr_t) > size) {
+        fprintf(stderr, "mkimage: truncated section table\n");
+        return -1;
+    }
+
+    const elf32_shdr_t* sh = (const elf32_shdr_t*)(elf + eh->e_shoff);
+    uint32_t start = 0xFFFFFFFF;
+    uint32_t end = 0;
+
+    for (int i = 0; i < eh->e_shnum; i++) {
+        if (!(sh[i].sh_flags & SHF_ALLOC) || sh[i].sh_size == 0) continue;
+        if (sh[i].sh_addr < start) start = sh[i].sh_addr;
+        if (sh[i].sh_addr + sh[i].sh_size > end) end = sh[i].sh_addr + sh[i].sh_size;
+    }
+
+    if (start >= end) {
+        fprintf(stderr, "mkimage: no loadable sections\n");
+        return -1;
+    }
+
+    hdr->load_addr = start;
+    hdr->entry = eh->e_entry;
+    hdr->mem_size = end - start;
+    return 0;
+}
+
+int main(int argc, char** argv) {
+    int compress = 0;
+    if (argc > 1 && strcmp(argv[1], "-z") == 0) {
+        compress = 1;
+        argc--;
+        argv++;
+    }
+
+    if (argc != 4) {
+        fprintf(stderr, "usage: mkimage [-z] <biosmenu.elf> <biosmenu.bin> <payload.img>\n");
+        return 1;
+    }
+
+    size_t elf_size, bin_size;
+    uint8_t* elf = read_file(argv[1], &elf_size);
+    uint8_t* bin = read_file(argv[2], &bin_size);
+    if (!elf || !bin) return 1;
+
+    image_header_t hdr;
+    memset(&hdr, 0, sizeof(hdr));
+    hdr.magic = IMAGE_MAGIC;
+    hdr.version = IMAGE_VERSION;
+    if (elf_layout(elf, elf_size, &hdr) != 0) return 1;
+
+    hdr.file_size = bin_size;
+    if (hdr.mem_size < hdr.file_size) hdr.mem_size = hdr.file_size;
+
+    // Наихудший размер LZ4 - чуть больше исходного
+    size_t bound = bin_size + bin_size / 255 + 16;
+    uint8_t* payload = NULL;
+    size_t stored = bin_size;
+    size_t padded = 0;
+
+    if (compress) {
+        uint8_t* packed = calloc(1, bound + IMAGE_SECTOR_SIZE);
+        size_t packed_size = lz4_compress(bin, bin_size, packed);
+        padded = (packed_size + IMAGE_SECTOR_SIZE - 1) / IMAGE_SECTOR_SIZE * IMAGE_SECTOR_SIZE;
+
+        uint32_t packed_offset = 0;
+
+        if (packed_size < bin_size &&
+            lz4_place_inplace(packed, padded, packed_size, bin, bin_size, &packed_offset) == 0) {
+            hdr.flags |= IMAGE_FLAG_LZ4;
+            hdr.packed_offset = packed_offset;
+            hdr.packed_size = packed_size;
+            stored = packed_size;
+            payload = packed;
+        } else {
+            fprintf(stderr, "mkimage: compression not beneficial, storing raw payload\n");
+            free(packed);
+        }
+    }
+
+    if (!payload) {
+        padded = (bin_size + IMAGE_SECTOR_SIZE - 1) / IMAGE_SECTOR_SIZE * IMAGE_SECTOR_SIZE;
+        payload = calloc(1, padded ? padded : 1);
+        memcpy(payload, bin, bin_size);
+    }
+
+    hdr.sectors = padded / IMAGE_SECTOR_SIZE;
+
+    for (size_t i = 0; i < padded; i += 4) {
+        uint32_t word;
+        memcpy(&word, payload + i, 4);
+        hdr.checksum += word;
+    }
+
+    uint8_t sector[IMAGE_SECTOR_SIZE];
+    memset(sector, 0, sizeof(sector));
+    memcpy(sector, &hdr, sizeof(hdr));
+
+    FILE* out = fopen(argv[3], "wb");
+    if (!out) {
+        perror(argv[3]);
+        return 1;
+    }
+    fwrite(sector, 1, sizeof(sector), out);
+    fwrite(payload, 1, padded, out);
+    fclose(out);
+
+    printf("mkimage: load 0x%08X entry 0x%08X size %u (mem %u) stored %zu%s sectors %u checksum 0x%08X\n",
+           hdr.load_addr, hdr.entry, hdr.file_size, hdr.mem_size, stored,
+           (hdr.flags & IMAGE_FLAG_LZ4) ? " lz4" : "", hdr.sectors, hdr.checksum);
+
+    free(payload);
+    free(elf);
+    free(bin);
+    return 0;
+}
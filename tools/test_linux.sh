@@ -0,0 +1,90 @@
+#!/bin/bash
+# Загрузка Linux прямо из прошивки в QEMU: bzImage и initramfs на втором
+# диске с FAT, LINUX.CFG в корне. Успех - оболочка initramfs ответила
+# на команду через COM1.
+#
+# Нужны: qemu-system-x86_64, mtools (mformat, mcopy), cpio, gzip и
+# статически собранный busybox.
+#
+# Использование: tools/test_linux.sh [bzImage] [busybox]
+
+KERNEL=${1:-${KERNEL:-/boot/vmlinuz-$(uname -r)}}
+BUSYBOX=${2:-${BUSYBOX:-$(command -v busybox)}}
+QEMU=${QEMU:-qemu-system-x86_64}
+TIMEOUT=${TIMEOUT:-120}
+OUT=$(mktemp -d)
+
+trap 'exec 3>&- 2>/dev/null; kill "$pid" 2>/dev/null; rm -rf "$OUT"' EXIT
+
+if [ ! -r "$KERNEL" ] || [ ! -x "$BUSYBOX" ]; then
+    echo "usage: $0 [bzImage] [static busybox]" >&2
+    exit 2
+fi
+
+make -s > /dev/null || exit 1
+
+# initramfs: busybox и /init, который сообщает о старте и запускает оболочку
+mkdir -p "$OUT/root/bin" "$OUT/root/proc" "$OUT/root/sys" "$OUT/root/dev"
+cp "$BUSYBOX" "$OUT/root/bin/busybox"
+cat > "$OUT/root/init" << 'EOF'
+#!/bin/busybox sh
+/bin/busybox --install -s /bin
+mount -t proc proc /proc
+mount -t sysfs sysfs /sys
+mount -t devtmpfs devtmpfs /dev
+echo "WEXIB-LINUX-OK"
+exec setsid cttyhack sh
+EOF
+chmod +x "$OUT/root/init"
+(cd "$OUT/root" && find . | cpio -o -H newc --quiet | gzip -9) > "$OUT/initrd.img" || exit 1
+
+cat > "$OUT/LINUX.CFG" << 'EOF'
+# tools/test_linux.sh
+kernel /bzImage
+initrd /initrd.img
+append console=ttyS0 rdinit=/init panic=-1
+EOF
+
+# Диск без таблицы разделов (FAT на всем диске)
+dd if=/dev/zero of="$OUT/disk.img" bs=1M count=64 status=none
+mformat -i "$OUT/disk.img" -v WEXIBTEST :: || exit 1
+mcopy -i "$OUT/disk.img" "$KERNEL" ::/bzImage || exit 1
+mcopy -i "$OUT/disk.img" "$OUT/initrd.img" ::/initrd.img || exit 1
+mcopy -i "$OUT/disk.img" "$OUT/LINUX.CFG" ::/LINUX.CFG || exit 1
+
+mkfifo "$OUT/input"
+timeout "$TIMEOUT" "$QEMU" -m 256 -display none -net none -no-reboot \
+    -drive format=raw,file=bin/bios.img \
+    -drive format=raw,file="$OUT/disk.img" \
+    -serial stdio < "$OUT/input" > "$OUT/serial.log" 2>&1 &
+pid=$!
+exec 3> "$OUT/input"
+
+# Ожидание строки в выводе COM1
+wait_for() {
+    for i in $(seq 1 $(($2 * 10))); do
+        grep -q "$1" "$OUT/serial.log" 2>/dev/null && return 0
+        kill -0 "$pid" 2>/dev/null || return 1
+        sleep 0.1
+    done
+    return 1
+}
+
+# Окно автозагрузки "Boot OS? [Y]" - ответ через консоль COM1
+wait_for "Boot OS" 30
+printf "y" >&3
+
+if ! wait_for "WEXIB-LINUX-OK" "$TIMEOUT"; then
+    echo "FAIL: kernel did not reach /init"
+    tail -n 20 "$OUT/serial.log"
+    exit 1
+fi
+
+printf 'echo SHELL-$((6 * 7))\n' >&3
+if ! wait_for "SHELL-42" 20; then
+    echo "FAIL: no shell"
+    tail -n 20 "$OUT/serial.log"
+    exit 1
+fi
+
+echo "PASS: Linux booted to a shell"
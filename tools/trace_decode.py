@@ -0,0 +1,113 @@
+#!/usr/bin/env python3
+# Декодер выгрузки трассировки (src/trace.c) в читаемую временную шкалу.
+#
+# Строки "#WXTR" ищутся в любом логе: вывод -serial stdio (вместе с ANSI),
+# файл -debugcon file:trace.log. Имена подсистем и событий берутся из
+# include/trace.h, поэтому новые события не требуют правки скрипта.
+#
+# Формат выгрузки:
+#   #WXTR H <версия> <размер записи> <TSC кГц> <записей> <потеряно>
+#   #WXTR R <запись в hex>   (tsc u64, seq u32, event u16, subsystem u8,
+#                             level u8, arg0 u32, arg1 u32; little-endian)
+#   #WXTR E
+#
+# Использование: tools/trace_decode.py [-H include/trace.h] <лог>...
+
+import argparse
+import os
+import re
+import struct
+import sys
+
+RECORD = struct.Struct("<QIHBBII")
+LEVELS = ["ERROR", "WARN", "INFO", "DEBUG"]
+ANSI = re.compile(r"\x1b\[[0-9;?]*[A-Za-z]")
+
+
+def load_names(header):
+    subsystems = {}
+    events = {}
+    text = open(header, encoding="utf-8").read()
+
+    for name, value in re.findall(r"#define\s+TRACE_SYS_(\w+)\s+(\d+)", text):
+        if name != "COUNT":
+            subsystems[int(value)] = name
+
+    prefixes = sorted(subsystems.items(), key=lambda item: -len(item[1]))
+    for name, value in re.findall(r"#define\s+TRACE_(\w+)\s+(0x[0-9A-Fa-f]+)", text):
+        for number, sys_name in prefixes:
+            if name.startswith(sys_name + "_"):
+                events[(number, int(value, 16))] = name[len(sys_name) + 1:]
+                break
+
+    return subsystems, events
+
+
+def read_dumps(paths):
+    dumps = []
+    current = None
+
+    for path in paths:
+        with open(path, "rb") as f:
+            data = f.read().decode("latin-1")
+        for line in ANSI.sub("", data).splitlines():
+            pos = line.find("#WXTR ")
+            if pos < 0:
+                continue
+            fields = line[pos:].split()
+            if fields[1] == "H":
+                version, size, khz, count, lost = (int(x) for x in fields[2:7])
+                if version != 1 or size != RECORD.size:
+                    sys.exit(f"{path}: unsupported trace format {version}/{size}")
+                current = {"khz": khz, "lost": lost, "records": []}
+                dumps.append(current)
+            elif fields[1] == "R" and current is not None:
+                raw = bytes.fromhex(fields[2])
+                if len(raw) == RECORD.size:
+                    current["records"].append(RECORD.unpack(raw))
+            elif fields[1] == "E":
+                current = None
+
+    return dumps
+
+
+def main():
+    root = os.path.join(os.path.dirname(os.path.abspath(__file__)), "..")
+    parser = argparse.ArgumentParser(description="Decode WexIB trace dumps")
+    parser.add_argument("-H", "--header", default=os.path.join(root, "include", "trace.h"))
+    parser.add_argument("logs", nargs="+")
+    args = parser.parse_args()
+
+    subsystems, events = load_names(args.header)
+    dumps = read_dumps(args.logs)
+    if not dumps:
+        sys.exit("no #WXTR dump found")
+
+    # Соседние выгрузки продолжают друг друга - склеиваем по seq
+    records = {}
+    khz = dumps[-1]["khz"] or 1
+    lost = 0
+    for dump in dumps:
+        lost += dump["lost"]
+        for record in dump["records"]:
+            records[record[1]] = record
+
+    ordered = [records[seq] for seq in sorted(records)]
+    if not ordered:
+        sys.exit("dump contains no records")
+
+    start = ordered[0][0]
+    previous = start
+    print(f"{len(ordered)} events, {lost} lost, TSC {khz} kHz")
+    print(f"{'time ms':>12} {'delta us':>10}  {'sys':<5} {'level':<5} {'event':<16} args")
+    for tsc, seq, event, subsystem, level, arg0, arg1 in ordered:
+        sys_name = subsystems.get(subsystem, f"#{subsystem}")
+        ev_name = events.get((subsystem, event), f"0x{event:04X}")
+        level_name = LEVELS[level] if level < len(LEVELS) else str(level)
+        print(f"{(tsc - start) / khz:12.3f} {(tsc - previous) * 1000 / khz:10.1f}  "
+              f"{sys_name:<5} {level_name:<5} {ev_name:<16} 0x{arg0:08X} 0x{arg1:08X}")
+        previous = tsc
+
+
+if __name__ == "__main__":
+    main()